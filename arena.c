@@ -0,0 +1,119 @@
+/*******************************************************************************
+*      Filename: arena.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains a bump allocator used to hold everything parsed from
+*                a line of input, so that a command is released with a single
+*                reset rather than one free() per argument.
+*******************************************************************************/
+
+#include "arena.h"
+
+/* Global allocation counters. */
+struct AllocStats ALLOC_STATS = {0};
+
+/*******************************************************************************
+*    Function: _newChunk()
+*  Parameters: size_t size - The minimum number of usable bytes.
+* Description: Allocates an arena chunk.
+*     Returns: A pointer to the chunk.
+*******************************************************************************/
+
+struct ArenaChunk *_newChunk(size_t size) {
+    struct ArenaChunk *chunk;
+
+    if (size < ARENA_CHUNK_SIZE) {
+        size = ARENA_CHUNK_SIZE;
+    }
+    if ((chunk = malloc(sizeof(struct ArenaChunk) + size)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    ALLOC_STATS.mallocs++;
+    ALLOC_STATS.bytes += size;
+    return chunk;
+}
+
+/*******************************************************************************
+*    Function: arenaAlloc()
+*  Parameters: struct Arena *arena - A pointer to the arena.
+*              size_t size - The number of bytes to allocate.
+* Description: Allocates memory from an arena. Chunks retained from before the
+*              last reset are reused before a new chunk is allocated.
+*     Returns: A pointer to the uninitialized memory.
+*******************************************************************************/
+
+void *arenaAlloc(struct Arena *arena, size_t size) {
+    struct ArenaChunk *chunk = arena->current;
+    struct ArenaChunk *fresh;
+    void *ptr;
+
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+    ALLOC_STATS.allocs++;
+
+    /* Move through the retained chunks until one has enough room. */
+    while (chunk != NULL && chunk->size - chunk->used < size) {
+        chunk = chunk->next;
+        if (chunk != NULL) {
+            chunk->used = 0;
+        }
+    }
+
+    /* Otherwise, allocate a chunk and link it after the current one. */
+    if (chunk == NULL) {
+        fresh = _newChunk(size);
+        if (arena->current == NULL) {
+            arena->head = fresh;
+        } else {
+            fresh->next = arena->current->next;
+            arena->current->next = fresh;
+        }
+        chunk = fresh;
+    }
+
+    arena->current = chunk;
+    ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+/*******************************************************************************
+*    Function: arenaReset()
+*  Parameters: struct Arena *arena - A pointer to the arena.
+* Description: Releases everything allocated from an arena. Its chunks are
+*              kept for reuse.
+*     Returns: None.
+*******************************************************************************/
+
+void arenaReset(struct Arena *arena) {
+    arena->current = arena->head;
+    if (arena->head != NULL) {
+        arena->head->used = 0;
+    }
+    ALLOC_STATS.resets++;
+}
+
+/*******************************************************************************
+*    Function: arenaFree()
+*  Parameters: struct Arena *arena - A pointer to the arena.
+* Description: Deallocates every chunk of an arena.
+*     Returns: None.
+*******************************************************************************/
+
+void arenaFree(struct Arena *arena) {
+    struct ArenaChunk *chunk = arena->head;
+    struct ArenaChunk *next;
+
+    while (chunk != NULL) {
+        next = chunk->next;
+        ALLOC_STATS.bytes -= chunk->size;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+}
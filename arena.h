@@ -0,0 +1,57 @@
+/*******************************************************************************
+*      Filename: arena.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for arena.c. See arena.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Minimum size of an arena chunk in bytes. */
+#define ARENA_CHUNK_SIZE 16384
+/* Alignment of arena allocations in bytes. */
+#define ARENA_ALIGN      16
+
+/* A struct to hold one chunk of arena memory. Chunks are kept across resets
+ * so that a warmed-up arena satisfies every allocation without malloc().
+ */
+struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;
+    size_t used;
+    char   data[];
+};
+
+/* A struct to hold a bump allocator. Everything allocated from it is released
+ * at once by arenaReset().
+ */
+struct Arena {
+    struct ArenaChunk *head;
+    struct ArenaChunk *current;
+};
+
+/* A struct to hold allocation counters shared by all arenas. mallocs counts
+ * the chunks obtained from malloc(); it stops growing once the arenas have
+ * warmed up.
+ */
+struct AllocStats {
+    unsigned long allocs;
+    unsigned long mallocs;
+    unsigned long resets;
+    size_t        bytes;
+};
+
+/* Global allocation counters. */
+extern struct AllocStats ALLOC_STATS;
+
+void *arenaAlloc(struct Arena *, size_t);
+void arenaReset(struct Arena *);
+void arenaFree(struct Arena *);
+
+#endif
@@ -0,0 +1,690 @@
+/*******************************************************************************
+*      Filename: bench.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Microbenchmarks of the shell's internals. Each benchmark
+*                prints one line of the form "name value unit". The parser,
+*                spawn, reaping and dispatch benchmarks call the shell's
+*                objects directly; the script benchmarks run the shell itself.
+*******************************************************************************/
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "arena.h"
+#include "builtins.h"
+#include "input.h"
+#include "script.h"
+#include "signal_proc.h"
+
+/* Minimum duration of each benchmark in nanoseconds. */
+#define BENCH_MIN_NS 300000000LL
+/* Number of arguments on the long argument list lines. */
+#define LONG_ARGS    500
+/* Path of the shell executable used by the whole-shell benchmarks. */
+#define SHELL_PATH   "./main"
+/* Number of lines in the script benchmarks. */
+#define SCRIPT_LINES 100000
+/* Number of commands in the command benchmarks. Commands that spawn a
+ * process are run fewer times.
+ */
+#define BUILTIN_COMMANDS  100000
+#define EXTERNAL_COMMANDS 2000
+/* Number of runs of each whole-shell benchmark; the fastest is reported. */
+#define SHELL_RUNS   3
+/* Number of processes in each spawn benchmark run, and the number of runs;
+ * the fastest run is reported.
+ */
+#define SPAWN_COMMANDS 1000
+#define SPAWN_RUNS     3
+/* Number of $$ expansions on the PID-heavy lines. */
+#define PID_ARGS       100
+/* Size of the memory touched before the spawn engine benchmarks, standing in
+ * for a shell that has grown.
+ */
+#define BALLAST_BYTES  (128 << 20)
+/* Number of files in the directory of the pattern benchmarks. */
+#define GLOB_FILES     20000
+/* Size of the output captured by the substitution throughput benchmark. */
+#define SUBST_BYTES    (16 << 20)
+/* Number of iterations of the loop benchmarks. */
+#define LOOP_ITERATIONS 1000000
+/* Number of commands, and commands per line, of the list benchmarks. */
+#define LIST_COMMANDS  200000
+#define LIST_LENGTH    10
+
+/*******************************************************************************
+*    Function: _now()
+*  Parameters: None.
+* Description: Reads the monotonic clock.
+*     Returns: The time in nanoseconds.
+*******************************************************************************/
+
+long long _now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*******************************************************************************
+*    Function: benchParse()
+*  Parameters: char *name - The name of the benchmark.
+*              char *line - The line of input to be parsed.
+* Description: Measures processInput() on a line, releasing the command after
+*              each iteration as the main loop does. Prints the time per line
+*              and the input throughput.
+*     Returns: None.
+*******************************************************************************/
+
+void benchParse(char *name, char *line) {
+    struct CommandInfo command;
+    struct Arena arena = {0};
+    long long start, elapsed;
+    long iterations = 0;
+    size_t len = strlen(line);
+
+    start = _now();
+    do {
+        processInput(line, len, &command, &arena);
+        arenaReset(&arena);
+        iterations++;
+        elapsed = _now() - start;
+    } while (elapsed < BENCH_MIN_NS);
+
+    printf("%s_ns %.1f ns/line\n", name, (double) elapsed / iterations);
+    printf("%s_mbps %.1f MB/s\n", name,
+           (double) len * iterations * 1000.0 / elapsed);
+    arenaFree(&arena);
+}
+
+/*******************************************************************************
+*    Function: _repeatArgs()
+*  Parameters: char *arg - The argument to be repeated.
+*              int count - The number of repetitions.
+* Description: Builds a command line of the form "cmd arg arg ... arg".
+*     Returns: The allocated line.
+*******************************************************************************/
+
+char *_repeatArgs(char *arg, int count) {
+    size_t argLen = strlen(arg);
+    char *line = malloc(4 + count * (argLen + 1) + 1);
+    char *c = line;
+    int i;
+
+    memcpy(c, "cmd", 3);
+    c += 3;
+    for (i = 0; i < count; i++) {
+        *c++ = ' ';
+        memcpy(c, arg, argLen);
+        c += argLen;
+    }
+    *c = '\0';
+    return line;
+}
+
+/*******************************************************************************
+*    Function: _writeScript()
+*  Parameters: char *line - The line to be repeated, including its newline.
+*              int count - The number of repetitions.
+* Description: Writes a temporary script file.
+*     Returns: The allocated path of the file.
+*******************************************************************************/
+
+char *_writeScript(char *line, int count) {
+    char *path = strdup("/tmp/shell_bench_XXXXXX");
+    FILE *script = fdopen(mkstemp(path), "w");
+    int i;
+
+    for (i = 0; i < count; i++) {
+        fputs(line, script);
+    }
+    fclose(script);
+    return path;
+}
+
+/*******************************************************************************
+*    Function: _runShell()
+*  Parameters: char *scriptPath - The script to be executed.
+*              int asArgument - Set to pass the script as an argument (script
+*                               mode), clear to feed it to standard input
+*                               (interactive mode).
+* Description: Runs the shell on a script with its output discarded.
+*     Returns: The elapsed time in nanoseconds.
+*******************************************************************************/
+
+long long _runShell(char *scriptPath, int asArgument) {
+    long long start = _now();
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0) {
+        dup2(open("/dev/null", O_WRONLY), 1);
+        if (asArgument) {
+            execl(SHELL_PATH, SHELL_PATH, scriptPath, (char *) NULL);
+        } else {
+            dup2(open(scriptPath, O_RDONLY), 0);
+            execl(SHELL_PATH, SHELL_PATH, (char *) NULL);
+        }
+        perror(SHELL_PATH);
+        _exit(127);
+    }
+    waitpid(pid, &status, 0);
+    return _now() - start;
+}
+
+/*******************************************************************************
+*    Function: benchScript()
+*  Parameters: char *name - The name of the benchmark.
+*              char *line - The line the script consists of.
+*              int count - The number of lines in the script.
+*              int asArgument - Set for script mode, clear for interactive
+*                               mode.
+* Description: Measures the throughput of the whole shell on a script. Prints
+*              the lines executed per second.
+*     Returns: None.
+*******************************************************************************/
+
+void benchScript(char *name, char *line, int count, int asArgument) {
+    char *path = _writeScript(line, count);
+    long long elapsed, best = 0;
+    int i;
+
+    for (i = 0; i < SHELL_RUNS; i++) {
+        elapsed = _runShell(path, asArgument);
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    printf("%s_lps %.0f lines/s\n", name, count * 1000000000.0 / best);
+
+    unlink(path);
+    free(path);
+}
+
+/*******************************************************************************
+*    Function: _silenceStdout()
+*  Parameters: None.
+* Description: Redirects standard output to /dev/null, so that the notices of
+*              the shell's functions don't mix with the results.
+*     Returns: A copy of the original standard output.
+*******************************************************************************/
+
+int _silenceStdout() {
+    int saved, devNull;
+
+    fflush(stdout);
+    saved = dup(1);
+    devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+/*******************************************************************************
+*    Function: _restoreStdout()
+*  Parameters: int saved - The copy returned by _silenceStdout().
+* Description: Restores standard output.
+*     Returns: None.
+*******************************************************************************/
+
+void _restoreStdout(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+/*******************************************************************************
+*    Function: benchSpawn()
+*  Parameters: char *name - The name of the benchmark.
+*              char *line - The command line to be executed.
+*              int isForeground - Set to execute the command in the
+*                                 foreground, clear to execute it in the
+*                                 background.
+* Description: Measures the rate at which handleNonBuiltIn() executes a
+*              command. Foreground commands are waited for one at a time.
+*              Background commands are launched back to back, reaping with
+*              backgroundCleanup() between launches as the main loop does,
+*              and the run ends once every process has been reaped. Prints the
+*              processes executed per second.
+*     Returns: None.
+*******************************************************************************/
+
+void benchSpawn(char *name, char *line, int isForeground) {
+    struct CommandInfo command;
+    struct ForegroundStatus fs;
+    struct BackgroundProcesses bp;
+    struct Arena arena = {0};
+    struct pollfd reaper = {REAPER_FD, POLLIN, 0};
+    long long start, elapsed, best = 0;
+    int i, run, saved;
+
+    processInput(line, strlen(line), &command, &arena);
+    command.isForeground = isForeground;
+    initForegroundStatus(&fs);
+    initBackgroundProcesses(&bp);
+
+    saved = _silenceStdout();
+    for (run = 0; run < SPAWN_RUNS; run++) {
+        start = _now();
+        for (i = 0; i < SPAWN_COMMANDS; i++) {
+            handleNonBuiltIn(&command, &fs, &bp);
+            if (bp.size > 0) {
+                backgroundCleanup(&bp);
+            }
+        }
+        while (bp.size > 0) {
+            poll(&reaper, 1, -1);
+            backgroundCleanup(&bp);
+        }
+        elapsed = _now() - start;
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    _restoreStdout(saved);
+
+    printf("%s_rate %.0f procs/s\n", name,
+           SPAWN_COMMANDS * 1000000000.0 / best);
+    freeBackgroundProcesses(&bp);
+    arenaFree(&arena);
+}
+
+/*******************************************************************************
+*    Function: benchDispatch()
+*  Parameters: char *name - The name of the benchmark.
+*              char *line - A command line naming a builtin.
+* Description: Measures executeCommand() on a parsed builtin command, which
+*              covers the registry lookup and the builtin itself. Prints the
+*              time per command.
+*     Returns: None.
+*******************************************************************************/
+
+void benchDispatch(char *name, char *line) {
+    struct CommandInfo command;
+    struct ForegroundStatus fs;
+    struct BackgroundProcesses bp;
+    struct Arena arena = {0};
+    long long start, elapsed;
+    long iterations = 0;
+    int saved;
+
+    processInput(line, strlen(line), &command, &arena);
+    initForegroundStatus(&fs);
+    initBackgroundProcesses(&bp);
+
+    saved = _silenceStdout();
+    start = _now();
+    do {
+        executeCommand(&command, &fs, &bp);
+        iterations++;
+        elapsed = _now() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    _restoreStdout(saved);
+
+    printf("%s_ns %.1f ns/command\n", name, (double) elapsed / iterations);
+    freeBackgroundProcesses(&bp);
+    arenaFree(&arena);
+}
+
+/*******************************************************************************
+*    Function: benchLookup()
+*  Parameters: char *name - The name of the benchmark.
+*              char *command - The command name to be looked up.
+* Description: Measures findBuiltin() alone. Prints the time per lookup.
+*     Returns: None.
+*******************************************************************************/
+
+void benchLookup(char *name, char *command) {
+    long long start, elapsed;
+    long iterations = 0, found = 0;
+
+    start = _now();
+    do {
+        found += findBuiltin(command) != NULL;
+        iterations++;
+        elapsed = _now() - start;
+    } while (elapsed < BENCH_MIN_NS);
+
+    printf("%s_ns %.1f ns/lookup\n", name, (double) elapsed / iterations);
+    /* Keep the lookups from being optimized away. */
+    if (found < 0) {
+        printf("%ld\n", found);
+    }
+}
+
+/*******************************************************************************
+*    Function: benchSpawnEngines()
+*  Parameters: None.
+* Description: Measures the foreground spawn rate of each spawn engine once the
+*              benchmark process has grown by BALLAST_BYTES of touched memory.
+*              The default engine is selected again afterwards.
+*     Returns: None.
+*******************************************************************************/
+
+void benchSpawnEngines() {
+    char *modeNames[NUM_SPAWN_MODES] = SPAWN_MODE_NAMES_INIT;
+    char name[64];
+    char *ballast = malloc(BALLAST_BYTES);
+    int i;
+
+    memset(ballast, 1, BALLAST_BYTES);
+    for (i = 0; i < NUM_SPAWN_MODES; i++) {
+        if (selectSpawnMode(modeNames[i]) == -1) {
+            perror(modeNames[i]);
+            continue;
+        }
+        snprintf(name, sizeof(name), "spawn_%s_ballast", modeNames[i]);
+        benchSpawn(name, "/bin/true", 1);
+    }
+    selectSpawnMode(modeNames[SPAWN_POSIX]);
+    free(ballast);
+}
+
+/*******************************************************************************
+*    Function: benchGlob()
+*  Parameters: None.
+* Description: Measures processInput() on a pattern over a directory of
+*              GLOB_FILES files, first with the directory listing cached and
+*              then with the cache emptied before each line. The directory is
+*              left to settle first, so that its listing can be trusted.
+*     Returns: None.
+*******************************************************************************/
+
+void benchGlob() {
+    char dir[] = "/tmp/bench_globXXXXXX";
+    char path[PATH_MAX], line[PATH_MAX];
+    struct CommandInfo command;
+    struct Arena arena = {0};
+    long long start, elapsed;
+    long iterations;
+    int i, fd, isCached;
+
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return;
+    }
+    for (i = 0; i < GLOB_FILES; i++) {
+        snprintf(path, sizeof(path), "%s/file_%d.log", dir, i);
+        if ((fd = open(path, O_WRONLY | O_CREAT, 0644)) != -1) {
+            close(fd);
+        }
+    }
+    usleep(GLOB_CACHE_SETTLE_NS * 2 / 1000);
+    snprintf(line, sizeof(line), "ls %s/file_*7.log", dir);
+
+    for (isCached = 1; isCached >= 0; isCached--) {
+        iterations = 0;
+        start = _now();
+        do {
+            if (!isCached) {
+                clearGlobCache();
+            }
+            processInput(line, strlen(line), &command, &arena);
+            arenaReset(&arena);
+            iterations++;
+            elapsed = _now() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        printf("glob_%s_ns %.1f ns/line\n", isCached ? "cached" : "uncached",
+               (double) elapsed / iterations);
+    }
+
+    for (i = 0; i < GLOB_FILES; i++) {
+        snprintf(path, sizeof(path), "%s/file_%d.log", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+    clearGlobCache();
+    arenaFree(&arena);
+}
+
+/*******************************************************************************
+*    Function: benchSubstitution()
+*  Parameters: char *name - The name of the benchmark.
+*              char *command - The command whose output is substituted.
+* Description: Measures processInput() on a line with a quoted command
+*              substitution, which executes the command and captures its
+*              output. Prints the time per line and the capture throughput.
+*     Returns: None.
+*******************************************************************************/
+
+void benchSubstitution(char *name, char *command) {
+    struct CommandInfo ci;
+    struct Arena arena = {0};
+    long long start, elapsed;
+    long iterations = 0;
+    size_t captured = 0;
+    char line[PATH_MAX];
+
+    snprintf(line, sizeof(line), "x \"$(%s)\"", command);
+    start = _now();
+    do {
+        processInput(line, strlen(line), &ci, &arena);
+        captured += strlen(ci.args[1]);
+        arenaReset(&arena);
+        iterations++;
+        elapsed = _now() - start;
+    } while (elapsed < BENCH_MIN_NS);
+
+    printf("%s_ns %.1f ns/line\n", name, (double) elapsed / iterations);
+    printf("%s_mbps %.1f MB/s\n", name, (double) captured * 1000.0 / elapsed);
+    arenaFree(&arena);
+}
+
+/*******************************************************************************
+*    Function: benchSubstitutions()
+*  Parameters: None.
+* Description: Measures command substitution of a builtin utility and of an
+*              external command with a short output, and the capture of a
+*              file of SUBST_BYTES.
+*     Returns: None.
+*******************************************************************************/
+
+void benchSubstitutions() {
+    char path[] = "/tmp/bench_substXXXXXX";
+    char command[PATH_MAX];
+    char *block = malloc(SUBST_BYTES);
+    int fd;
+
+    benchSubstitution("substitute_builtin_echo", "echo hello");
+    benchSubstitution("substitute_external_echo", "/bin/echo hello");
+
+    if ((fd = mkstemp(path)) == -1) {
+        perror("mkstemp");
+        free(block);
+        return;
+    }
+    memset(block, 'x', SUBST_BYTES);
+    if (write(fd, block, SUBST_BYTES) != SUBST_BYTES) {
+        perror("write");
+    }
+    close(fd);
+    snprintf(command, sizeof(command), "cat %s", path);
+    benchSubstitution("substitute_large_output", command);
+
+    unlink(path);
+    free(block);
+}
+
+/*******************************************************************************
+*    Function: _bestShellRun()
+*  Parameters: char *path - The script to be fed to the shell's standard
+*                           input.
+* Description: Runs the shell on a script SHELL_RUNS times.
+*     Returns: The fastest elapsed time in nanoseconds.
+*******************************************************************************/
+
+long long _bestShellRun(char *path) {
+    long long elapsed, best = 0;
+    int i;
+
+    for (i = 0; i < SHELL_RUNS; i++) {
+        elapsed = _runShell(path, 0);
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+/*******************************************************************************
+*    Function: benchLoop()
+*  Parameters: char *name - The name of the benchmark.
+*              char *body - The body of the loop.
+* Description: Measures LOOP_ITERATIONS iterations of a loop body, run by a
+*              for loop, which parses the body once, and by lexing the body
+*              for each iteration, as a script of one line per iteration
+*              would. Both are measured in the benchmark process, setting the
+*              loop variable i, and in the whole shell, reading its input.
+*     Returns: None.
+*******************************************************************************/
+
+void benchLoop(char *name, char *body) {
+    struct CommandInfo command;
+    struct ForegroundStatus fs;
+    struct BackgroundProcesses bp;
+    struct ScriptContext ctx = {NULL, 0, &fs, &bp};
+    struct Arena arena = {0};
+    char loop[256], line[256], value[16];
+    char *loopPath, *linesPath;
+    long long start, elapsed;
+    int i;
+
+    initForegroundStatus(&fs);
+    initBackgroundProcesses(&bp);
+
+    snprintf(loop, sizeof(loop), "for i in $(seq 1 %d); do %s; done",
+             LOOP_ITERATIONS, body);
+    start = _now();
+    executeCompound(loop, strlen(loop), LIST_SEQ, &ctx);
+    elapsed = _now() - start;
+    printf("%s_compiled_ns %.1f ns/iteration\n", name,
+           (double) elapsed / LOOP_ITERATIONS);
+
+    start = _now();
+    for (i = 1; i <= LOOP_ITERATIONS; i++) {
+        snprintf(value, sizeof(value), "%d", i);
+        setVariable("i", value, 0);
+        processInput(body, strlen(body), &command, &arena);
+        executeCommand(&command, &fs, &bp);
+        arenaReset(&arena);
+    }
+    elapsed = _now() - start;
+    printf("%s_reparsed_ns %.1f ns/iteration\n", name,
+           (double) elapsed / LOOP_ITERATIONS);
+
+    strcat(loop, "\n");
+    snprintf(line, sizeof(line), "%s\n", body);
+    loopPath = _writeScript(loop, 1);
+    linesPath = _writeScript(line, LOOP_ITERATIONS);
+    printf("%s_shell_compiled_ns %.1f ns/iteration\n", name,
+           (double) _bestShellRun(loopPath) / LOOP_ITERATIONS);
+    printf("%s_shell_reparsed_ns %.1f ns/iteration\n", name,
+           (double) _bestShellRun(linesPath) / LOOP_ITERATIONS);
+
+    unlink(loopPath);
+    unlink(linesPath);
+    free(loopPath);
+    free(linesPath);
+    unsetVariable("i");
+    arenaFree(&arena);
+    freeBackgroundProcesses(&bp);
+}
+
+/*******************************************************************************
+*    Function: benchList()
+*  Parameters: char *name - The name of the benchmark.
+*              char *command - The command the scripts consist of.
+*              char *op - The list operator joining the commands.
+* Description: Measures the whole shell in interactive mode on LIST_COMMANDS
+*              commands, written one per line and LIST_LENGTH per line as a
+*              list, which saves a prompt and a read per command. Prints the
+*              commands executed per second.
+*     Returns: None.
+*******************************************************************************/
+
+void benchList(char *name, char *command, char *op) {
+    char line[256] = "", single[256];
+    char *linesPath, *listPath;
+    int i;
+
+    for (i = 0; i < LIST_LENGTH; i++) {
+        strcat(line, command);
+        strcat(line, i < LIST_LENGTH - 1 ? op : "\n");
+    }
+    snprintf(single, sizeof(single), "%s\n", command);
+    linesPath = _writeScript(single, LIST_COMMANDS);
+    listPath = _writeScript(line, LIST_COMMANDS / LIST_LENGTH);
+    printf("%s_lines_cps %.0f commands/s\n", name,
+           LIST_COMMANDS * 1000000000.0 / _bestShellRun(linesPath));
+    printf("%s_list_cps %.0f commands/s\n", name,
+           LIST_COMMANDS * 1000000000.0 / _bestShellRun(listPath));
+
+    unlink(linesPath);
+    unlink(listPath);
+    free(linesPath);
+    free(listPath);
+}
+
+/*******************************************************************************
+*    Function: main()
+*  Parameters: Main function parameters.
+* Description: Runs every benchmark. Like the shell, the benchmark runs
+*              itself with FORK_SERVER_FLAG to start the fork server.
+*     Returns: Exit status.
+*******************************************************************************/
+
+int main(int argc, char * argv[]) {
+    char *longPlain, *longQuoted, *pidHeavy, *variableHeavy;
+
+    if (argc > 1 && strcmp(argv[1], FORK_SERVER_FLAG) == 0) {
+        return runForkServer();
+    }
+    longPlain = _repeatArgs("argument_value", LONG_ARGS);
+    longQuoted = _repeatArgs("\"quoted arg\"\\ x'y z'", LONG_ARGS);
+    pidHeavy = _repeatArgs("$$_\"$$\"", PID_ARGS);
+    variableHeavy = _repeatArgs("${HOME}/\"$PATH\"", PID_ARGS);
+
+    /* The process benchmarks reap through the signalfd, as the shell does,
+     * and the parser expands the shell's variables.
+     */
+    initReaper();
+    initVariables();
+
+    benchParse("parse_short", "ls -la < in_file > out_file &");
+    benchParse("parse_long_args", longPlain);
+    benchParse("parse_long_quoted_args", longQuoted);
+    benchParse("parse_pid_expansion", pidHeavy);
+    benchParse("parse_variable_expansion", variableHeavy);
+    benchGlob();
+    benchSubstitutions();
+    benchLoop("loop_static", "true");
+    benchLoop("loop_variable", "X=$i");
+    benchList("list_sequence", "true", "; ");
+    benchList("list_and", "true", " && ");
+    benchLookup("lookup_builtin", "true");
+    benchLookup("lookup_external", "ls");
+    benchDispatch("dispatch_true", "true");
+    benchDispatch("dispatch_cd", "cd .");
+    benchSpawn("spawn_foreground_true", "/bin/true", 1);
+    benchSpawn("spawn_background_true", "/bin/true", 0);
+    benchSpawnEngines();
+    benchScript("script_mode", "cd .\n", SCRIPT_LINES, 1);
+    benchScript("interactive_mode", "cd .\n", SCRIPT_LINES, 0);
+
+    /* Each pair runs a utility as a builtin, then as an external command. */
+    benchScript("builtin_true", "true\n", BUILTIN_COMMANDS, 1);
+    benchScript("external_true", "/bin/true\n", EXTERNAL_COMMANDS, 1);
+    benchScript("builtin_echo", "echo hello\n", BUILTIN_COMMANDS, 1);
+    benchScript("external_echo", "/bin/echo hello\n", EXTERNAL_COMMANDS, 1);
+    benchScript("builtin_test", "[ -d / ]\n", BUILTIN_COMMANDS, 1);
+    benchScript("external_test", "/usr/bin/[ -d / ]\n", EXTERNAL_COMMANDS,
+                1);
+
+    free(longPlain);
+    free(longQuoted);
+    free(pidHeavy);
+    free(variableHeavy);
+    return 0;
+}
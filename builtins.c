@@ -2,12 +2,144 @@
 *      Filename: builtins.c
 *        Author: Maxwell Goldberg
 * Last Modified: 03.03.17
-*   Description: Contains a method for determining if a character string is the
-*                name of a builtin command as well as methods for selecting a
-*                builtin command and executing each builtin.
+*   Description: Contains the table of builtin commands, which finds a builtin
+*                with a single hash lookup, a method for running a builtin
+*                with its redirects, and methods for executing each of the
+*                shell's own builtins.
 *******************************************************************************/
 
 #include "builtins.h"
+#include "script.h"
+
+/* Global builtin table. */
+struct BuiltinTable BUILTIN_TABLE = {0};
+
+/*******************************************************************************
+*    Function: _hashBuiltin()
+*  Parameters: char *name - The builtin name.
+* Description: Computes the FNV-1a hash of a builtin name.
+*     Returns: The hash value.
+*******************************************************************************/
+
+unsigned int _hashBuiltin(char *name) {
+    unsigned int hash = 2166136261u;
+
+    while (*name != '\0') {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*******************************************************************************
+*    Function: _findBuiltinSlot()
+*  Parameters: struct BuiltinTable *table - The builtin table.
+*              char *name - The builtin name.
+* Description: Finds the bucket of a builtin name with linear probing.
+*     Returns: The bucket index holding the name, or the index of the empty
+*              bucket where it would be inserted.
+*******************************************************************************/
+
+int _findBuiltinSlot(struct BuiltinTable *table, char *name) {
+    int mask = table->capacity - 1;
+    int i = _hashBuiltin(name) & mask;
+
+    while (table->buckets[i].name != NULL &&
+           strcmp(table->buckets[i].name, name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*******************************************************************************
+*    Function: _initBuiltins()
+*  Parameters: None.
+* Description: Allocates the builtin table and registers the builtins of
+*              BUILTINS_LIST_INIT.
+*     Returns: None.
+*******************************************************************************/
+
+void _initBuiltins() {
+    struct Builtin builtins[] = BUILTINS_LIST_INIT;
+    int i;
+
+    BUILTIN_TABLE.capacity = BUILTIN_TABLE_INIT_SIZE;
+    BUILTIN_TABLE.buckets = calloc(BUILTIN_TABLE.capacity,
+                                   sizeof(struct Builtin));
+    if (BUILTIN_TABLE.buckets == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        registerBuiltin(builtins[i].name, builtins[i].handler,
+                        builtins[i].flags);
+    }
+}
+
+/*******************************************************************************
+*    Function: registerBuiltin()
+*  Parameters: char *name - The builtin name. The string must outlive the
+*                           table.
+*              BuiltinHandler handler - The function executing the builtin.
+*              int flags - The builtin flags.
+* Description: Adds a builtin to the table, replacing any builtin of the same
+*              name. The table doubles once the load factor would exceed 0.5.
+*     Returns: None.
+*******************************************************************************/
+
+void registerBuiltin(char *name, BuiltinHandler handler, int flags) {
+    struct BuiltinTable grown;
+    int i;
+
+    if (BUILTIN_TABLE.buckets == NULL) {
+        _initBuiltins();
+    }
+
+    /* Rehash into a table twice the size if needed. */
+    if ((BUILTIN_TABLE.size + 1) * 2 > BUILTIN_TABLE.capacity) {
+        grown.capacity = BUILTIN_TABLE.capacity * 2;
+        grown.size = BUILTIN_TABLE.size;
+        grown.buckets = calloc(grown.capacity, sizeof(struct Builtin));
+        if (grown.buckets == NULL) {
+            perror("calloc");
+            exit(1);
+        }
+        for (i = 0; i < BUILTIN_TABLE.capacity; i++) {
+            if (BUILTIN_TABLE.buckets[i].name != NULL) {
+                grown.buckets[_findBuiltinSlot(&grown,
+                    BUILTIN_TABLE.buckets[i].name)] = BUILTIN_TABLE.buckets[i];
+            }
+        }
+        free(BUILTIN_TABLE.buckets);
+        BUILTIN_TABLE = grown;
+    }
+
+    i = _findBuiltinSlot(&BUILTIN_TABLE, name);
+    if (BUILTIN_TABLE.buckets[i].name == NULL) {
+        BUILTIN_TABLE.size++;
+    }
+    BUILTIN_TABLE.buckets[i].name = name;
+    BUILTIN_TABLE.buckets[i].handler = handler;
+    BUILTIN_TABLE.buckets[i].flags = flags;
+}
+
+/*******************************************************************************
+*    Function: findBuiltin()
+*  Parameters: char *name - The command name.
+* Description: Looks up a command name in the builtin table.
+*     Returns: A pointer to the builtin, or NULL if the name isn't a builtin.
+*              The pointer remains valid until the next registration.
+*******************************************************************************/
+
+struct Builtin *findBuiltin(char *name) {
+    struct Builtin *builtin;
+
+    if (BUILTIN_TABLE.buckets == NULL) {
+        _initBuiltins();
+    }
+    builtin = &BUILTIN_TABLE.buckets[_findBuiltinSlot(&BUILTIN_TABLE, name)];
+    return builtin->name != NULL ? builtin : NULL;
+}
 
 /*******************************************************************************
 *    Function: isBuiltIn()
@@ -18,20 +150,7 @@
 *******************************************************************************/
 
 int isBuiltIn(char *arg) {
-    /* Form an array of all valid names */
-    char *builtins[NUM_BUILTINS] = BUILTINS_LIST_INIT;
-    int i;
-
-    /* Iterate through each element of the array. If the argument has the same
-     * value, return 1.
-     */
-    for (i = 0; i < NUM_BUILTINS; i++) {
-        if (strcmp(arg, builtins[i]) == 0) {
-            return 1;
-        }     
-    }
-    /* Otherwise, return 0 */
-    return 0;
+    return findBuiltin(arg) != NULL;
 }
 
 /*******************************************************************************
@@ -39,39 +158,333 @@ int isBuiltIn(char *arg) {
 *  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
 *              struct ForegroundStatus *fs - The status struct ptr to be used in 
 *                                            executeStatus().
-*              struct BackgroundProcess *bp - The array of background PIDs.
-* Description: Selects a builtin function to execute based on the values of the
-*              CommandInfo struct.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Looks up the builtin named by the first argument and executes
+*              it.
+*     Returns: The exit status of the builtin, or -1 if the first argument
+*              isn't a builtin.
+*******************************************************************************/
+
+int handleBuiltIn(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                  struct BackgroundProcesses *bp) {
+    struct Builtin *builtin = findBuiltin(ci->args[0]);
+
+    if (builtin == NULL) {
+        return -1;
+    }
+    return builtin->handler(ci, fs, bp);
+}
+
+/*******************************************************************************
+*    Function: _swapFD()
+*  Parameters: int fd - The descriptor to be installed, or -1.
+*              int target - The standard descriptor it replaces.
+* Description: Installs a redirect in the shell itself, keeping a copy of the
+*              descriptor it replaces. The installed descriptor is closed.
+*     Returns: The copy of the replaced descriptor, or -1 if there is none.
+*******************************************************************************/
+
+int _swapFD(int fd, int target) {
+    int saved;
+
+    if (fd == -1) {
+        return -1;
+    }
+    saved = fcntl(target, F_DUPFD_CLOEXEC, 10);
+    dup2(fd, target);
+    close(fd);
+    return saved;
+}
+
+/*******************************************************************************
+*    Function: _restoreFD()
+*  Parameters: int saved - The copy returned by _swapFD(), or -1.
+*              int target - The standard descriptor to be restored.
+* Description: Reinstalls a descriptor replaced by _swapFD().
 *     Returns: None.
 *******************************************************************************/
 
-void handleBuiltIn(struct CommandInfo *ci, struct ForegroundStatus *fs,
+void _restoreFD(int saved, int target) {
+    if (saved != -1) {
+        dup2(saved, target);
+        close(saved);
+    }
+}
+
+/*******************************************************************************
+*    Function: runBuiltin()
+*  Parameters: struct Builtin *builtin - The builtin to be executed.
+*              struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - The last foreground status.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Executes a builtin in the shell process. The redirects of a
+*              builtin with BUILTIN_REDIRECTS are installed over the shell's
+*              own standard input and output for the duration of the builtin,
+*              and the status of a builtin with BUILTIN_SETS_STATUS is stored
+*              as the foreground status. Such a builtin has no resource usage
+*              of its own unless it sets one.
+*     Returns: The exit status of the builtin.
+*******************************************************************************/
+
+int runBuiltin(struct Builtin *builtin, struct CommandInfo *ci,
+               struct ForegroundStatus *fs, struct BackgroundProcesses *bp) {
+    int inFD = -1, outFD = -1, savedIn, savedOut, status;
+
+    if (builtin->flags & BUILTIN_SETS_STATUS) {
+        fs->hasUsage = 0;
+    }
+
+    /* A redirect that can't be opened fails the command, as it would for an
+     * external command.
+     */
+    if ((builtin->flags & BUILTIN_REDIRECTS) &&
+        openRedirects(ci, -1, -1, &inFD, &outFD) == -1) {
+        status = 1;
+    } else {
+        fflush(stdout);
+        savedIn = _swapFD(inFD, 0);
+        savedOut = _swapFD(outFD, 1);
+        status = builtin->handler(ci, fs, bp);
+        fflush(stdout);
+        _restoreFD(savedIn, 0);
+        _restoreFD(savedOut, 1);
+    }
+
+    if (builtin->flags & BUILTIN_SETS_STATUS) {
+        fs->statusNum = status;
+        fs->isSignal = 0;
+    }
+    return status;
+}
+
+/*******************************************************************************
+*    Function: runBuiltinStage()
+*  Parameters: void *arg - The struct BuiltinStage of the stage.
+* Description: Runs a builtin as a pipeline stage, in a forked copy of the
+*              shell whose standard input and output, including redirects,
+*              are already in place. The copy's jobs, fork server connection,
+*              job cgroups, and input belong to the shell, so it lists the
+*              jobs but doesn't terminate them if the builtin is exit, and
+*              reads only its own standard input.
+*     Returns: The exit status of the builtin.
+*******************************************************************************/
+
+int runBuiltinStage(void *arg) {
+    struct BuiltinStage *stage = arg;
+    struct CommandInfo ci = *stage->ci;
+    struct BackgroundProcesses noJobs, *bp = stage->bp;
+    int status;
+
+    detachSpawnEngine();
+    forgetJobCgroups();
+    SHELL_INPUT = NULL;
+    if (stage->builtin->flags & BUILTIN_EXITS) {
+        initBackgroundProcesses(&noJobs);
+        bp = &noJobs;
+    }
+
+    ci.inRedirFile = NULL;
+    ci.outRedirFile = NULL;
+    ci.next = NULL;
+    status = runBuiltin(stage->builtin, &ci, stage->fs, bp);
+    fflush(stdout);
+    return status;
+}
+
+/*******************************************************************************
+*    Function: _countAssignments()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+* Description: Counts the variable assignments, words of the form NAME=value,
+*              that begin a command.
+*     Returns: The number of assignments.
+*******************************************************************************/
+
+int _countAssignments(struct CommandInfo *ci) {
+    char *equals;
+    int i;
+
+    for (i = 0; i < ci->numArgs; i++) {
+        if ((equals = strchr(ci->args[i], '=')) == NULL ||
+            !isValidName(ci->args[i], equals - ci->args[i])) {
+            break;
+        }
+    }
+    return i;
+}
+
+/*******************************************************************************
+*    Function: _executeAssignments()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              int numAssignments - The number of assignments beginning it.
+*              struct ForegroundStatus *fs - The last foreground status.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Executes variable assignments. Assignments alone set shell
+*              variables, which keep their export attribute. Assignments
+*              preceding a command are exported for the duration of the
+*              command only, and apply to every stage of a pipeline. The
+*              status of assignments alone is that of the last command
+*              substitution expanded in them, or 0 if there was none.
+*     Returns: 1 if the shell should exit, 0 otherwise.
+*******************************************************************************/
+
+int _executeAssignments(struct CommandInfo *ci, int numAssignments,
+                        struct ForegroundStatus *fs,
+                        struct BackgroundProcesses *bp) {
+    struct CommandInfo command = *ci;
+    struct SavedVariable saved[numAssignments];
+    int i, isTemporary = numAssignments < ci->numArgs, isExit;
+    char *equals;
+
+    for (i = 0; i < numAssignments; i++) {
+        equals = strchr(ci->args[i], '=');
+        *equals = '\0';
+        if (isTemporary) {
+            saveVariable(ci->args[i], &saved[i]);
+        }
+        setVariable(ci->args[i], equals + 1, isTemporary);
+        *equals = '=';
+    }
+    syncEnvironment();
+    if (!isTemporary) {
+        if (!ci->hasSubstitution) {
+            setLastStatus(0);
+        }
+        return 0;
+    }
+
+    command.args += numAssignments;
+    command.numArgs -= numAssignments;
+    isExit = executeCommand(&command, fs, bp);
+
+    for (i = numAssignments - 1; i >= 0; i--) {
+        restoreVariable(&saved[i]);
+    }
+    syncEnvironment();
+    return isExit;
+}
+
+/*******************************************************************************
+*    Function: executeCommand()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct of
+*                                       the first pipeline stage.
+*              struct ForegroundStatus *fs - The last foreground status.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Executes a parsed command line: nothing for an empty line or a
+*              comment, a builtin in the shell process, or a pipeline. A
+*              prefix builtin applies to the whole pipeline following it; any
+*              other builtin in a pipeline of several stages runs in a forked
+*              copy of the shell, except that builtin utilities run as
+*              external commands there, as they do in the background.
+*     Returns: 1 if the shell should exit, 0 otherwise.
+*******************************************************************************/
+
+int executeCommand(struct CommandInfo *ci, struct ForegroundStatus *fs,
                    struct BackgroundProcesses *bp) {
-    /* Find the name of the builtin command to be executed. Note that the
-     * CommandInfo struct will contain a builtin command name as its first
-     * argument by virtue of a call to isBuiltIn() within main() and prior
-     * checks for no arguments and comments.
+    struct Builtin *builtin, *prefixed;
+    struct timespec phaseStart;
+    int numAssignments;
+
+    /* Case: No arguments or comment string. Do nothing... */
+    if (ci->numArgs <= 0 || ci->args[0][0] == '#') {
+        return 0;
+    }
+    /* Case: Variable assignments, alone or preceding a command */
+    if ((numAssignments = _countAssignments(ci)) > 0) {
+        return _executeAssignments(ci, numAssignments, fs, bp);
+    }
+
+    /* Look the command up. The dispatch phase ends once the command is handed
+     * to a builtin or to the spawn path.
      */
-    char *commandName = ci->args[0]->value;
-   
-    /* Find the argument name, and execute its corresponding function. */ 
-    if (strcmp(commandName, "cd") == 0) {
-        executeCd(ci);
-    } else if (strcmp(commandName, "exit") == 0) {
-        executeExit(bp);
-    } else if (strcmp(commandName, "status") == 0) {
-        executeStatus(fs);
+    STATS_START(phaseStart);
+    builtin = findBuiltin(ci->args[0]);
+    STATS_RECORD(STATS_DISPATCH, phaseStart);
+
+    /* Case: Builtin function call */
+    if (builtin != NULL &&
+        (ci->next == NULL || (builtin->flags & BUILTIN_PREFIX)) &&
+        (ci->isForeground || !(builtin->flags & BUILTIN_EXTERNAL))) {
+        setLastStatus(runBuiltin(builtin, ci, fs, bp));
+        if (builtin->flags & BUILTIN_PREFIX) {
+            prefixed = ci->numArgs > 1 ? findBuiltin(ci->args[1]) : NULL;
+            return prefixed != NULL && (prefixed->flags & BUILTIN_EXITS);
+        }
+        return (builtin->flags & BUILTIN_EXITS) != 0;
+    /* Case: Non-builtin function call or pipeline */
+    } else {
+        handleNonBuiltIn(ci, fs, bp);
+        setLastStatus(ci->isForeground ? exitCode(fs) : 0);
     }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: executeLine()
+*  Parameters: char *line - The command line, a list of pipelines.
+*              size_t len - The length of the line.
+*              int listOp - The list operator preceding the line: LIST_SEQ,
+*                           or the operator that followed a pipeline already
+*                           executed.
+*              struct ForegroundStatus *fs - The last foreground status.
+*              struct BackgroundProcess *bp - The background process table.
+*              struct Arena *arena - The arena each pipeline is lexed into.
+* Description: Executes a list of pipelines separated by ';', '&', "&&", and
+*              "||", in a single pass over the line. Each pipeline is lexed
+*              just before it executes, so that it sees the effects of the
+*              ones before it. A pipeline after "&&" executes only if the
+*              status of the last one executed is 0, and one after "||" only
+*              if it isn't; a pipeline that doesn't execute is skipped
+*              without being expanded. In foreground-only mode, every
+*              pipeline is in the foreground. The rest of a list beginning
+*              with a compound command is executed by executeCompound().
+*     Returns: 1 if the shell should exit, 0 otherwise.
+*******************************************************************************/
+
+int executeLine(char *line, size_t len, int listOp,
+                struct ForegroundStatus *fs, struct BackgroundProcesses *bp,
+                struct Arena *arena) {
+    struct ScriptContext script = {NULL, 0, fs, bp};
+    struct CommandInfo command, *stage;
+    struct timespec phaseStart;
+    int isExit = 0;
+    size_t used;
+
+    while (!isExit && listOp != LIST_END) {
+        if (isCompoundStart(line, len)) {
+            return executeCompound(line, len, listOp, &script);
+        }
+        if (listOp == LIST_SEQ || (listOp == LIST_AND) == (LAST_STATUS == 0)) {
+            STATS_START(phaseStart);
+            used = processInput(line, len, &command, arena);
+            STATS_RECORD(STATS_PARSE, phaseStart);
+            if (FOREGROUND_FLAG) {
+                for (stage = &command; stage != NULL; stage = stage->next) {
+                    stage->isForeground = 1;
+                }
+            }
+            isExit = executeCommand(&command, fs, bp);
+            listOp = command.listOp;
+            arenaReset(arena);
+        } else {
+            used = skipInput(line, len, &listOp);
+        }
+        line += used;
+        len -= used;
+    }
+    return isExit;
 }
 
 /*******************************************************************************
 *    Function: executeCd()
 *  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
 * Description: Executes the cd builtin command.
-*     Returns: None.
+*     Returns: 0 on success, 1 on failure.
 *******************************************************************************/
 
-void executeCd(struct CommandInfo *ci) {
+int executeCd(struct CommandInfo *ci, struct ForegroundStatus *fs,
+              struct BackgroundProcesses *bp) {
     int status;
     char pathBuffer[PATH_MAX];
     /* Place the default directory to navigate to in the pathBuffer
@@ -81,35 +494,74 @@ void executeCd(struct CommandInfo *ci) {
      */
     memset(pathBuffer, '\0', sizeof(pathBuffer));
     if (ci->numArgs == 1) {
-        strcpy(pathBuffer, getenv("HOME"));
-        strcat(pathBuffer, "/");
+        if (getVariable("HOME") == NULL) {
+            fprintf(stderr, "cd: HOME not set\n");
+            fflush(stderr);
+            return 1;
+        }
+        snprintf(pathBuffer, PATH_MAX - 1, "%s/", getVariable("HOME"));
     }
 
     /* Check for an erroneous number of arguments. */
     if (ci->numArgs > 2) {
         fprintf(stderr, "Warning: More than one arg passed to cd\n");
         fflush(stderr);
+        return 1;
     /* If a second arg is provided, add it to the path */
     } else if (ci->numArgs == 2) {
-        strncat(pathBuffer, ci->args[1]->value, 
-                PATH_MAX - 1 - strlen(ci->args[1]->value));
+        strncat(pathBuffer, ci->args[1], 
+                PATH_MAX - 1 - strlen(ci->args[1]));
         pathBuffer[PATH_MAX-1] ='\0';
     }
     /* Attempt to change directories. Display an error if it occurs. */
     if ((status = chdir(pathBuffer)) != 0) {
         perror("chdir");
+        return 1;
     }
+    return 0;
 }
 
 /*******************************************************************************
-*    Function: executeStatus()
-*  Parameters: struct ForegroundStatus *fs - A pointer to the last foreground
-*              process status.
-* Description: Executes the status builtin command.
+*    Function: _printUsage()
+*  Parameters: FILE *out - The stream to print to.
+*              struct ForegroundStatus *fs - A status.
+* Description: Prints the resource usage recorded in a status.
 *     Returns: None.
 *******************************************************************************/
 
-void executeStatus(struct ForegroundStatus *fs) {
+void _printUsage(FILE *out, struct ForegroundStatus *fs) {
+    struct rusage *usage = &fs->usage;
+
+    if (!fs->hasUsage) {
+        fprintf(out, "no resource usage recorded\n");
+        return;
+    }
+    fprintf(out, "wall time: %.3f s\n", fs->wallSeconds);
+    fprintf(out, "user time: %ld.%03ld s\n", (long) usage->ru_utime.tv_sec,
+            (long) usage->ru_utime.tv_usec / 1000);
+    fprintf(out, "system time: %ld.%03ld s\n", (long) usage->ru_stime.tv_sec,
+            (long) usage->ru_stime.tv_usec / 1000);
+    fprintf(out, "max rss: %ld KB\n", usage->ru_maxrss);
+    fprintf(out, "page faults: %ld major, %ld minor\n", usage->ru_majflt,
+            usage->ru_minflt);
+    fprintf(out, "context switches: %ld voluntary, %ld involuntary\n",
+            usage->ru_nvcsw, usage->ru_nivcsw);
+}
+
+/*******************************************************************************
+*    Function: executeStatus()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct, or
+*                                       NULL.
+*              struct ForegroundStatus *fs - A pointer to the last foreground
+*                                            process status.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the status builtin command. With "-v", the resource
+*              usage of the last foreground command is displayed as well.
+*     Returns: 0 if a foreground process has been executed, 1 otherwise.
+*******************************************************************************/
+
+int executeStatus(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                  struct BackgroundProcesses *bp) {
     /* This function generates output based on the values in the ForegroundStatus
      * struct. This means that this struct must have correct values prior to
      * the calling of this function. */
@@ -131,30 +583,786 @@ void executeStatus(struct ForegroundStatus *fs) {
     }
     /* Print the generated string. */
     fprintf(stdout, "%s\n", outputBuffer);
+
+    if (ci != NULL && ci->numArgs > 1 && strcmp(ci->args[1], "-v") == 0 &&
+        fs->statusNum != -1) {
+        _printUsage(stdout, fs);
+    }
     fflush(stdout);
+    return fs->statusNum == -1;
 }
 
 /*******************************************************************************
 *    Function: executeExit()
-*  Parameters: struct BackgroundProcess *bp - The background PIDs array.
-* Description: Kills all background processes, and cleans them up. The caller
-*              will handle setting the exit status for the program.
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct,
+*                                       or NULL at the end of input.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Terminates all background jobs, and cleans them up. Jobs are
+*              given the number of milliseconds in EXIT_GRACE_ENV, or
+*              EXIT_GRACE_MS, to finish before they are killed. Their cgroups
+*              are removed afterwards. The caller will handle setting the exit
+*              status for the program, which is the argument, if one is given,
+*              and otherwise the status of the last command.
+*     Returns: The exit status.
+*******************************************************************************/
+
+int executeExit(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    char *value = getenv(EXIT_GRACE_ENV), *end;
+    long graceMs = EXIT_GRACE_MS, status = LAST_STATUS;
+
+    if (ci != NULL && ci->numArgs > 1) {
+        errno = 0;
+        status = strtol(ci->args[1], &end, 10);
+        if (errno != 0 || end == ci->args[1] || *end != '\0' ||
+            status < 0 || status > 255) {
+            fprintf(stderr, "Warning: Invalid exit status %s\n", ci->args[1]);
+            fflush(stderr);
+            status = 2;
+        }
+    }
+
+    if (value != NULL) {
+        errno = 0;
+        graceMs = strtol(value, &end, 10);
+        if (errno != 0 || end == value || *end != '\0' || graceMs < 0 ||
+            graceMs > INT_MAX) {
+            fprintf(stderr, "Warning: Invalid %s %s, using %d ms\n",
+                    EXIT_GRACE_ENV, value, EXIT_GRACE_MS);
+            fflush(stderr);
+            graceMs = EXIT_GRACE_MS;
+        }
+    }
+    terminateBackground(bp, graceMs);
+    closeJobCgroups();
+    return status;
+}
+
+/*******************************************************************************
+*    Function: executeSpawn()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the spawn builtin command. With no arguments, the
+*              selected spawn engine and the spawn latency of each engine are
+*              displayed. An engine name selects that engine, and "reset"
+*              clears the latency statistics.
+*     Returns: 0 on success, 1 on an invalid argument or if the engine can't
+*              be started.
+*******************************************************************************/
+
+int executeSpawn(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                 struct BackgroundProcesses *bp) {
+    char *modeNames[NUM_SPAWN_MODES] = SPAWN_MODE_NAMES_INIT;
+    struct SpawnStats stats;
+    int i;
+
+    /* Check for an erroneous number of arguments. */
+    if (ci->numArgs > 2) {
+        fprintf(stderr, "Warning: More than one arg passed to spawn\n");
+        fflush(stderr);
+        return 1;
+    }
+
+    /* Select an engine or reset the statistics. */
+    if (ci->numArgs == 2) {
+        if (strcmp(ci->args[1], "reset") == 0) {
+            resetSpawnStats();
+            return 0;
+        }
+        if (selectSpawnMode(ci->args[1]) == -1) {
+            if (errno == EINVAL) {
+                fprintf(stderr, "spawn: unknown engine %s\n", ci->args[1]);
+            } else {
+                perror("spawn");
+            }
+            fflush(stderr);
+            return 1;
+        }
+        return 0;
+    }
+
+    /* Display the selected engine followed by the latency of each engine in
+     * microseconds.
+     */
+    fprintf(stdout, "spawn engine: %s\n", modeNames[SPAWN_MODE]);
+    for (i = 0; i < NUM_SPAWN_MODES; i++) {
+        getSpawnStats(i, &stats);
+        if (stats.count == 0) {
+            fprintf(stdout, "%s: 0 spawns\n", modeNames[i]);
+        } else {
+            fprintf(stdout, "%s: %lu spawns, avg %.1f us, min %.1f us, "
+                    "max %.1f us\n", modeNames[i], stats.count,
+                    stats.totalNs / (stats.count * 1000.0),
+                    stats.minNs / 1000.0, stats.maxNs / 1000.0);
+        }
+    }
+    fflush(stdout);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _printPhasesJSON()
+*  Parameters: None.
+* Description: Prints the phase histograms as a single JSON object. Each phase
+*              lists its summary values and its non-empty buckets as pairs of
+*              the bucket's highest value and its count.
 *     Returns: None.
 *******************************************************************************/
 
-void executeExit(struct BackgroundProcesses *bp) {
+void _printPhasesJSON() {
+    char *phaseNames[NUM_STATS_PHASES] = STATS_PHASE_NAMES_INIT;
+    struct PhaseHistogram *stats;
+    int i, j, isFirst;
+
+    fprintf(stdout, "{\"unit\":\"ns\",\"phases\":{");
+    for (i = 0; i < NUM_STATS_PHASES; i++) {
+        stats = getPhaseStats(i);
+        fprintf(stdout, "%s\"%s\":{\"count\":%lu,\"mean\":%lld,\"min\":%lld,"
+                "\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"max\":%lld,"
+                "\"buckets\":[", i > 0 ? "," : "", phaseNames[i],
+                stats->count,
+                stats->count ? stats->totalNs / (long long) stats->count : 0,
+                stats->minNs, phasePercentile(stats, 50),
+                phasePercentile(stats, 90), phasePercentile(stats, 99),
+                stats->maxNs);
+        for (j = 0, isFirst = 1; j < STATS_NUM_BUCKETS; j++) {
+            if (stats->counts[j] != 0) {
+                fprintf(stdout, "%s[%lld,%lu]", isFirst ? "" : ",",
+                        bucketValue(j), stats->counts[j]);
+                isFirst = 0;
+            }
+        }
+        fprintf(stdout, "]}");
+    }
+    fprintf(stdout, "}}\n");
+}
+
+/*******************************************************************************
+*    Function: executeShellStats()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the shellstats builtin command. With no arguments, the
+*              latency distribution of each phase of the shell's handling of a
+*              command line is displayed in microseconds. "-j" displays the
+*              histograms as JSON, and "-r" clears them.
+*     Returns: 0 on success, 1 on an invalid argument or if the
+*              instrumentation is disabled.
+*******************************************************************************/
+
+int executeShellStats(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                      struct BackgroundProcesses *bp) {
+    char *phaseNames[NUM_STATS_PHASES] = STATS_PHASE_NAMES_INIT;
+    struct PhaseHistogram *stats;
     int i;
 
-    /* Iterate through the entire array. Given that there are no guarantees
-     * that certain processes will finish before others, we must check
-     * the entire array in order to find and send SIGTERM signals to all
-     * extant background processes. 
+    /* Check for an erroneous number of arguments. */
+    if (ci->numArgs > 2) {
+        fprintf(stderr, "Warning: More than one arg passed to shellstats\n");
+        fflush(stderr);
+        return 1;
+    }
+    if (!STATS_ENABLED) {
+        fprintf(stderr, "shellstats: disabled; start the shell with %s=1\n",
+                SHELL_STATS_ENV);
+        fflush(stderr);
+        return 1;
+    }
+
+    if (ci->numArgs == 2) {
+        if (strcmp(ci->args[1], "-r") == 0) {
+            resetShellStats();
+            return 0;
+        } else if (strcmp(ci->args[1], "-j") == 0) {
+            _printPhasesJSON();
+            fflush(stdout);
+            return 0;
+        }
+        fprintf(stderr, "shellstats: unknown option %s\n", ci->args[1]);
+        fflush(stderr);
+        return 1;
+    }
+
+    fprintf(stdout, "%-9s %9s %10s %10s %10s %10s %10s\n", "phase", "count",
+            "mean us", "p50 us", "p90 us", "p99 us", "max us");
+    for (i = 0; i < NUM_STATS_PHASES; i++) {
+        stats = getPhaseStats(i);
+        fprintf(stdout, "%-9s %9lu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                phaseNames[i], stats->count,
+                stats->count ? stats->totalNs / (stats->count * 1000.0) : 0,
+                phasePercentile(stats, 50) / 1000.0,
+                phasePercentile(stats, 90) / 1000.0,
+                phasePercentile(stats, 99) / 1000.0, stats->maxNs / 1000.0);
+    }
+    fflush(stdout);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: executeExport()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the export builtin command. Each argument NAME=value
+*              sets and exports a variable, and each NAME exports an existing
+*              variable. With no arguments, the exported variables are
+*              displayed.
+*     Returns: 0 on success, 1 if a name is invalid.
+*******************************************************************************/
+
+int executeExport(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                  struct BackgroundProcesses *bp) {
+    int i, status = 0;
+    char *equals;
+    size_t nameLen;
+
+    if (ci->numArgs == 1) {
+        printExports(stdout);
+        fflush(stdout);
+        return 0;
+    }
+
+    for (i = 1; i < ci->numArgs; i++) {
+        equals = strchr(ci->args[i], '=');
+        nameLen = equals ? equals - ci->args[i] : strlen(ci->args[i]);
+        if (!isValidName(ci->args[i], nameLen)) {
+            fprintf(stderr, "export: %s: not a valid identifier\n",
+                    ci->args[i]);
+            fflush(stderr);
+            status = 1;
+        } else if (equals != NULL) {
+            *equals = '\0';
+            setVariable(ci->args[i], equals + 1, 1);
+            *equals = '=';
+        } else {
+            exportVariable(ci->args[i]);
+        }
+    }
+    syncEnvironment();
+    return status;
+}
+
+/*******************************************************************************
+*    Function: executeUnset()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the unset builtin command, which removes each named
+*              variable.
+*     Returns: 0 on success, 1 if a name is invalid.
+*******************************************************************************/
+
+int executeUnset(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                 struct BackgroundProcesses *bp) {
+    int i, status = 0;
+
+    for (i = 1; i < ci->numArgs; i++) {
+        if (!isValidName(ci->args[i], strlen(ci->args[i]))) {
+            fprintf(stderr, "unset: %s: not a valid identifier\n",
+                    ci->args[i]);
+            fflush(stderr);
+            status = 1;
+        } else {
+            unsetVariable(ci->args[i]);
+        }
+    }
+    syncEnvironment();
+    return status;
+}
+
+/*******************************************************************************
+*    Function: _printCgroups()
+*  Parameters: None.
+* Description: Displays the state of job cgroup placement and each limit.
+*     Returns: None.
+*******************************************************************************/
+
+void _printCgroups() {
+    char *limitNames[NUM_CGROUP_LIMITS] = CGROUP_LIMIT_NAMES_INIT;
+    int i;
+
+    if (JOB_CGROUPS.isUnavailable) {
+        fprintf(stdout, "cgroups unavailable\n");
+    } else if (JOB_CGROUPS.dirFD == -1) {
+        fprintf(stdout, "cgroups off\n");
+    } else {
+        fprintf(stdout, "cgroups %s %s\n", JOB_CGROUPS.isEnabled ? "on" : "off",
+                JOB_CGROUPS.path);
+    }
+    for (i = 0; i < NUM_CGROUP_LIMITS; i++) {
+        fprintf(stdout, "%-10s %s\n", limitNames[i],
+                JOB_CGROUPS.limits[i] != NULL ? JOB_CGROUPS.limits[i] :
+                                                "default");
+    }
+    fflush(stdout);
+}
+
+/*******************************************************************************
+*    Function: executeCgroup()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the cgroup builtin command. With no arguments, the
+*              state of job cgroup placement and the limits are displayed.
+*              "on" and "off" enable and disable the placement of later
+*              background jobs in cgroups of their own, "-r" clears the
+*              limits, and each argument of the form name=value sets a limit
+*              for later jobs, enabling placement.
+*     Returns: 0 on success, 1 on an invalid argument or if a limit can't be
+*              set.
+*******************************************************************************/
+
+int executeCgroup(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                  struct BackgroundProcesses *bp) {
+    char *equals;
+    int i, result, status = 0;
+
+    if (ci->numArgs == 1) {
+        _printCgroups();
+        return 0;
+    }
+    if (ci->numArgs == 2 && strcmp(ci->args[1], "on") == 0) {
+        return enableJobCgroups() == -1;
+    } else if (ci->numArgs == 2 && strcmp(ci->args[1], "off") == 0) {
+        JOB_CGROUPS.isEnabled = 0;
+        return 0;
+    } else if (ci->numArgs == 2 && strcmp(ci->args[1], "-r") == 0) {
+        clearCgroupLimits();
+        return 0;
+    }
+
+    for (i = 1; i < ci->numArgs; i++) {
+        if ((equals = strchr(ci->args[i], '=')) == NULL) {
+            fprintf(stderr, "Usage: cgroup [on | off | -r | name=value ...]\n");
+            fflush(stderr);
+            return 1;
+        }
+        /* The argument may belong to a compiled command, so it is restored. */
+        *equals = '\0';
+        if ((result = setCgroupLimit(ci->args[i], equals + 1)) == -1) {
+            if (errno == EINVAL) {
+                fprintf(stderr, "cgroup: unknown limit %s\n", ci->args[i]);
+            } else if (errno == EOPNOTSUPP) {
+                fprintf(stderr, "cgroup: %s isn't available in %s\n",
+                        ci->args[i], JOB_CGROUPS.path);
+            } else {
+                fprintf(stderr, "cgroup: unavailable\n");
+            }
+            fflush(stderr);
+            status = 1;
+        }
+        *equals = '=';
+    }
+    return status;
+}
+
+/*******************************************************************************
+*    Function: executeHash()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the hash builtin command. With no arguments, the cached
+*              command paths are displayed. "-r" clears the cache, "-d" removes
+*              the named commands from it, and any other names are searched for
+*              in PATH and added to it.
+*     Returns: 0 on success, 1 if a named command wasn't found.
+*******************************************************************************/
+
+int executeHash(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    int i, status = 0;
+
+    /* Display the cache if no names are given. */
+    if (ci->numArgs == 1) {
+        printPathCache(stdout);
+        fflush(stdout);
+        return 0;
+    }
+
+    /* Clear the cache. */
+    if (strcmp(ci->args[1], "-r") == 0) {
+        clearPathCache();
+        return 0;
+    }
+
+    /* Remove or add each named command. */
+    if (strcmp(ci->args[1], "-d") == 0) {
+        for (i = 2; i < ci->numArgs; i++) {
+            invalidatePath(ci->args[i]);
+        }
+        return 0;
+    }
+    for (i = 1; i < ci->numArgs; i++) {
+        if (hashPath(ci->args[i]) == NULL) {
+            fprintf(stderr, "hash: %s: not found\n", ci->args[i]);
+            fflush(stderr);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/*******************************************************************************
+*    Function: executeSet()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the set builtin command. "-o pipefail" enables the
+*              pipefail option and "+o pipefail" disables it. With no
+*              arguments, or with "-o" alone, the state of each option is
+*              displayed.
+*     Returns: 0 on success, 1 on an invalid argument.
+*******************************************************************************/
+
+int executeSet(struct CommandInfo *ci, struct ForegroundStatus *fs,
+               struct BackgroundProcesses *bp) {
+    char *flag;
+
+    /* Display the options. */
+    if (ci->numArgs == 1 ||
+        (ci->numArgs == 2 && strcmp(ci->args[1], "-o") == 0)) {
+        fprintf(stdout, "pipefail\t%s\n", PIPEFAIL_FLAG ? "on" : "off");
+        fflush(stdout);
+        return 0;
+    }
+
+    /* Check for an erroneous number of arguments. */
+    if (ci->numArgs != 3) {
+        fprintf(stderr, "Usage: set -o|+o option\n");
+        fflush(stderr);
+        return 1;
+    }
+
+    flag = ci->args[1];
+    if (strcmp(ci->args[2], "pipefail") != 0) {
+        fprintf(stderr, "set: %s: invalid option name\n", ci->args[2]);
+        fflush(stderr);
+        return 1;
+    } else if (strcmp(flag, "-o") == 0) {
+        PIPEFAIL_FLAG = 1;
+    } else if (strcmp(flag, "+o") == 0) {
+        PIPEFAIL_FLAG = 0;
+    } else {
+        fprintf(stderr, "set: %s: invalid option\n", flag);
+        fflush(stderr);
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: executeMemstats()
+*  Parameters: struct CommandInfo *ci - Unused.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the memstats builtin command. Displays the allocation
+*              counters of the arenas that hold parsed commands. Once the
+*              arenas have warmed up, the number of mallocs stays constant
+*              while the number of resets grows by one per line.
+*     Returns: 0.
+*******************************************************************************/
+
+int executeMemstats(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                    struct BackgroundProcesses *bp) {
+    fprintf(stdout, "arena allocs: %lu\n", ALLOC_STATS.allocs);
+    fprintf(stdout, "arena mallocs: %lu\n", ALLOC_STATS.mallocs);
+    fprintf(stdout, "arena resets: %lu\n", ALLOC_STATS.resets);
+    fprintf(stdout, "arena bytes: %lu\n", (unsigned long) ALLOC_STATS.bytes);
+    fflush(stdout);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _compareJobs()
+*  Parameters: const void *a, const void *b - Pointers to BackgroundProcess
+*                                             pointers.
+* Description: Orders background processes by job ID, then by PID.
+*     Returns: A negative, zero or positive value, as qsort() expects.
+*******************************************************************************/
+
+int _compareJobs(const void *a, const void *b) {
+    struct BackgroundProcess *procA = *(struct BackgroundProcess **) a;
+    struct BackgroundProcess *procB = *(struct BackgroundProcess **) b;
+
+    if (procA->jobId != procB->jobId) {
+        return procA->jobId - procB->jobId;
+    }
+    return procA->pid - procB->pid;
+}
+
+/*******************************************************************************
+*    Function: executeJobs()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Executes the jobs builtin command. Each live background job is
+*              displayed with its job ID, PIDs, running time and command, and
+*              the CPU time and memory of its cgroup if it has one. With "-p",
+*              only the PIDs are displayed.
+*     Returns: 0 on success, 1 on an invalid argument.
+*******************************************************************************/
+
+int executeJobs(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    struct BackgroundProcess *procs[bp->size + 1];
+    struct timespec now;
+    int i, numProcs = 0, isPidOnly = 0;
+    double seconds, cpuSeconds;
+    long long memoryBytes;
+
+    if (ci->numArgs > 2 ||
+        (ci->numArgs == 2 && !(isPidOnly = strcmp(ci->args[1], "-p") == 0))) {
+        fprintf(stderr, "Usage: jobs [-p]\n");
+        fflush(stderr);
+        return 1;
+    }
+
+    /* Gather the live processes in job order. */
+    for (i = 0; i < bp->capacity; i++) {
+        if (bp->slots[i].pid != -1) {
+            procs[numProcs++] = &bp->slots[i];
+        }
+    }
+    qsort(procs, numProcs, sizeof(procs[0]), _compareJobs);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (i = 0; i < numProcs; i++) {
+        if (isPidOnly) {
+            fprintf(stdout, "%d\n", procs[i]->pid);
+            continue;
+        }
+        /* Display the job ID before the first process of each job, and the
+         * running time and command after the last.
+         */
+        if (i == 0 || procs[i - 1]->jobId != procs[i]->jobId) {
+            fprintf(stdout, "[%d]", procs[i]->jobId);
+        }
+        fprintf(stdout, " %d", procs[i]->pid);
+        if (i + 1 == numProcs || procs[i + 1]->jobId != procs[i]->jobId) {
+            seconds = (now.tv_sec - procs[i]->startTime.tv_sec) +
+                      (now.tv_nsec - procs[i]->startTime.tv_nsec) / 1e9;
+            fprintf(stdout, "\t%.1fs", seconds);
+            if (procs[i]->cgroupId != -1 &&
+                readJobCgroupUsage(procs[i]->cgroupId, &cpuSeconds,
+                                   &memoryBytes) == 0) {
+                fprintf(stdout, "\tcpu %.2fs", cpuSeconds);
+                if (memoryBytes != -1) {
+                    fprintf(stdout, " mem %lld KB", memoryBytes / 1024);
+                }
+            }
+            fprintf(stdout, "\t%s\n", procs[i]->command);
+        }
+    }
+    fflush(stdout);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _waitResult()
+*  Parameters: struct ForegroundStatus *fs - The foreground status.
+*              struct ForegroundStatus *reaped - The status of a reaped
+*                                                background process.
+* Description: Makes the status and resource usage of a reaped background
+*              process the foreground status, and converts it into the exit
+*              status of the wait builtin.
+*     Returns: The exit value, or 128 plus the signal number if the process was
+*              terminated by a signal.
+*******************************************************************************/
+
+int _waitResult(struct ForegroundStatus *fs, struct ForegroundStatus *reaped) {
+    *fs = *reaped;
+    return exitCode(reaped);
+}
+
+/*******************************************************************************
+*    Function: _waitJob()
+*  Parameters: struct BackgroundProcesses *bp - The background process table.
+*              struct ForegroundStatus *fs - The foreground status.
+*              int jobId - The job to wait for.
+* Description: Waits until every process of a background job has terminated.
+*     Returns: The status of the last process reaped, or
+*              WAIT_INTERRUPTED_STATUS if a signal interrupted the wait.
+*******************************************************************************/
+
+int _waitJob(struct BackgroundProcesses *bp, struct ForegroundStatus *fs,
+             int jobId) {
+    struct ForegroundStatus reaped;
+    int slot, reapedJob, status = 0;
+
+    while ((slot = findJobProcess(bp, jobId)) != -1) {
+        if (reapBackground(bp, bp->slots[slot].pid, &reapedJob,
+                           &reaped) == -1) {
+            if (errno == EINTR) {
+                return WAIT_INTERRUPTED_STATUS;
+            }
+            /* The process is gone; forget it rather than wait forever. */
+            removeBackgroundProcess(bp, slot);
+            continue;
+        }
+        status = _waitResult(fs, &reaped);
+    }
+    return status;
+}
+
+/*******************************************************************************
+*    Function: executeWait()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Receives the status and resource
+*                                            usage of the last process waited
+*                                            for.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Executes the wait builtin command. With no arguments, it waits
+*              for every background job. Otherwise it waits for each argument
+*              in turn, a PID or a job ID written %N. "-n" waits for any one
+*              job to finish. The shell sleeps in waitpid() meanwhile, and a
+*              signal such as SIGINT ends the wait.
+*     Returns: The status of the last process or job waited for, 127 if it
+*              isn't a background process or job of the shell, or
+*              WAIT_INTERRUPTED_STATUS if a signal interrupted the wait.
+*******************************************************************************/
+
+int executeWait(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    struct ForegroundStatus reaped;
+    int i, slot, jobId, status = 0;
+    pid_t pid;
+    char *end;
+
+    /* Wait for every job. */
+    if (ci->numArgs == 1) {
+        while (bp->size > 0) {
+            if (reapBackground(bp, -1, &jobId, &reaped) == -1) {
+                return errno == EINTR ? WAIT_INTERRUPTED_STATUS : 0;
+            }
+        }
+        return 0;
+    }
+
+    /* Wait for the first job to finish. A job is finished once none of its
+     * processes remain.
      */
-    for (i = 0; i < NUM_BACKGROUND_PIDS; i++) {
-        if (bp->array[i] != -1 && kill(bp->array[i], SIGTERM) != 0) {
-            perror("kill");
-            /* Clean up terminated processes */
-            wait(0);
+    if (strcmp(ci->args[1], "-n") == 0) {
+        if (bp->size == 0) {
+            return 127;
+        }
+        while (1) {
+            if (reapBackground(bp, -1, &jobId, &reaped) == -1) {
+                return errno == EINTR ? WAIT_INTERRUPTED_STATUS : 127;
+            }
+            if (findJobProcess(bp, jobId) == -1) {
+                return _waitResult(fs, &reaped);
+            }
+        }
+    }
+
+    /* Wait for each PID or job in turn. */
+    for (i = 1; i < ci->numArgs; i++) {
+        if (ci->args[i][0] == '%') {
+            jobId = strtol(ci->args[i] + 1, &end, 10);
+            if (*end != '\0' || end == ci->args[i] + 1 ||
+                findJobProcess(bp, jobId) == -1) {
+                fprintf(stderr, "wait: %s: no such job\n", ci->args[i]);
+                fflush(stderr);
+                status = 127;
+                continue;
+            }
+            status = _waitJob(bp, fs, jobId);
+        } else {
+            pid = strtol(ci->args[i], &end, 10);
+            if (*end != '\0' || end == ci->args[i] ||
+                (slot = findBackgroundProcess(bp, pid)) == -1) {
+                fprintf(stderr, "wait: pid %s is not a child of this shell\n",
+                        ci->args[i]);
+                fflush(stderr);
+                status = 127;
+                continue;
+            }
+            if (reapBackground(bp, pid, &jobId, &reaped) == -1) {
+                if (errno == EINTR) {
+                    return WAIT_INTERRUPTED_STATUS;
+                }
+                removeBackgroundProcess(bp, slot);
+                status = 127;
+                continue;
+            }
+            status = _waitResult(fs, &reaped);
+        }
+        if (status == WAIT_INTERRUPTED_STATUS) {
+            return status;
         }
     }
+    return status;
+}
+
+/*******************************************************************************
+*    Function: _printTime()
+*  Parameters: char *label - The name of the time.
+*              struct timeval *time - The time.
+* Description: Prints a time to standard error in minutes and seconds.
+*     Returns: None.
+*******************************************************************************/
+
+void _printTime(char *label, struct timeval *time) {
+    fprintf(stderr, "%s\t%ldm%ld.%03lds\n", label, (long) time->tv_sec / 60,
+            (long) time->tv_sec % 60, (long) time->tv_usec / 1000);
+}
+
+/*******************************************************************************
+*    Function: executeTime()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct of
+*                                       the first pipeline stage.
+*              struct ForegroundStatus *fs - The last foreground status.
+*              struct BackgroundProcess *bp - The background process table.
+* Description: Executes the time builtin command, a prefix which executes the
+*              rest of the command line (including any pipeline) and then
+*              displays its wall, user and system time on standard error. The
+*              times of external commands are those reported by wait4(); a
+*              builtin's times are those of the shell itself. The usage is
+*              kept in the foreground status for status -v.
+*     Returns: The exit status of the timed command.
+*******************************************************************************/
+
+int executeTime(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    struct CommandInfo timed = *ci;
+    struct rusage before, after;
+    struct timespec start;
+    struct timeval wall;
+    double seconds;
+
+    /* Execute the command line without the time prefix. */
+    timed.args = ci->args + 1;
+    timed.numArgs = ci->numArgs - 1;
+    fs->hasUsage = 0;
+    getrusage(RUSAGE_SELF, &before);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    executeCommand(&timed, fs, bp);
+    seconds = elapsedSeconds(&start);
+
+    /* Without a child's usage, the command ran in the shell itself. */
+    if (!fs->hasUsage) {
+        getrusage(RUSAGE_SELF, &after);
+        memset(&fs->usage, 0, sizeof(fs->usage));
+        timersub(&after.ru_utime, &before.ru_utime, &fs->usage.ru_utime);
+        timersub(&after.ru_stime, &before.ru_stime, &fs->usage.ru_stime);
+        fs->usage.ru_maxrss = after.ru_maxrss;
+        fs->usage.ru_minflt = after.ru_minflt - before.ru_minflt;
+        fs->usage.ru_majflt = after.ru_majflt - before.ru_majflt;
+        fs->usage.ru_nvcsw = after.ru_nvcsw - before.ru_nvcsw;
+        fs->usage.ru_nivcsw = after.ru_nivcsw - before.ru_nivcsw;
+        fs->hasUsage = 1;
+    }
+    fs->wallSeconds = seconds;
+
+    wall.tv_sec = (time_t) seconds;
+    wall.tv_usec = (suseconds_t) ((seconds - wall.tv_sec) * 1000000);
+    fprintf(stderr, "\n");
+    _printTime("real", &wall);
+    _printTime("user", &fs->usage.ru_utime);
+    _printTime("sys", &fs->usage.ru_stime);
+    fflush(stderr);
+
+    return exitCode(fs);
 }
@@ -12,18 +12,142 @@
 #include <limits.h>
 
 #include "input.h"
+#include "parallel.h"
 #include "signal_proc.h"
+#include "utilities.h"
 
-/* Initializer list of builtin function names */
-#define BUILTINS_LIST_INIT {"cd", "exit", "status"}
-/* The number of builtin functions */
-#define NUM_BUILTINS       3
+/* Initial number of buckets in the builtin table. Must be a power of two
+ * and larger than the number of builtins so that lookups rarely probe.
+ */
+#define BUILTIN_TABLE_INIT_SIZE 32
 
+/* Exit status of wait when a signal interrupts it. */
+#define WAIT_INTERRUPTED_STATUS (128 + SIGINT)
+
+/* Builtin flags. */
+/* The shell terminates after the builtin has executed. */
+#define BUILTIN_EXITS           0x01
+/* The builtin's input and output redirects are honored. */
+#define BUILTIN_REDIRECTS       0x02
+/* The builtin's exit status becomes the foreground status, as an external
+ * command's would.
+ */
+#define BUILTIN_SETS_STATUS     0x04
+/* An external command of the same name exists. It is executed instead when
+ * the command is in the background or is a stage of a pipeline.
+ */
+#define BUILTIN_EXTERNAL        0x08
+/* The builtin is a prefix that takes the rest of the command line, including
+ * any pipeline, as its arguments.
+ */
+#define BUILTIN_PREFIX          0x10
+/* The flags of a builtin utility that stands in for an external command. */
+#define BUILTIN_UTILITY         (BUILTIN_REDIRECTS | BUILTIN_SETS_STATUS | \
+                                 BUILTIN_EXTERNAL)
+
+/* The signature shared by all builtin functions. The return value is the
+ * builtin's exit status.
+ */
+typedef int (*BuiltinHandler)(struct CommandInfo *, struct ForegroundStatus *,
+                              struct BackgroundProcesses *);
+
+/* A struct to hold a registered builtin command. */
+struct Builtin {
+    char          *name;
+    BuiltinHandler handler;
+    int            flags;
+};
+
+/* A struct to hold what a builtin run as a pipeline stage needs in the copy
+ * of the shell that runs it: the stage, and the shell's last foreground
+ * status and job table.
+ */
+struct BuiltinStage {
+    struct Builtin             *builtin;
+    struct CommandInfo         *ci;
+    struct ForegroundStatus    *fs;
+    struct BackgroundProcesses *bp;
+};
+
+/* A struct to hold the registered builtins in an open addressing hash table
+ * keyed by name.
+ */
+struct BuiltinTable {
+    struct Builtin *buckets;
+    int capacity;
+    int size;
+};
+
+/* Initializer list of the builtins registered when the table is first used.
+ * A new builtin only needs an entry here.
+ */
+#define BUILTINS_LIST_INIT {                                    \
+    {"cd",       executeCd,       0},                           \
+    {"exit",     executeExit,     BUILTIN_EXITS},               \
+    {"status",   executeStatus,   0},                           \
+    {"spawn",    executeSpawn,    0},                           \
+    {"hash",     executeHash,     0},                           \
+    {"set",      executeSet,      0},                           \
+    {"memstats", executeMemstats, 0},                           \
+    {"echo",     executeEcho,     BUILTIN_UTILITY},             \
+    {"printf",   executePrintf,   BUILTIN_UTILITY},             \
+    {"test",     executeTest,     BUILTIN_UTILITY},             \
+    {"[",        executeTest,     BUILTIN_UTILITY},             \
+    {"pwd",      executePwd,      BUILTIN_UTILITY},             \
+    {"true",     executeTrue,     BUILTIN_UTILITY},             \
+    {"false",    executeFalse,    BUILTIN_UTILITY},             \
+    {"parallel", executeParallel, BUILTIN_REDIRECTS |           \
+                                  BUILTIN_SETS_STATUS},         \
+    {"jobs",     executeJobs,     BUILTIN_REDIRECTS |           \
+                                  BUILTIN_SETS_STATUS},         \
+    {"wait",     executeWait,     BUILTIN_SETS_STATUS},         \
+    {"time",     executeTime,     BUILTIN_PREFIX},              \
+    {"shellstats", executeShellStats, BUILTIN_REDIRECTS |       \
+                                      BUILTIN_SETS_STATUS},     \
+    {"export",   executeExport,   BUILTIN_REDIRECTS},           \
+    {"unset",    executeUnset,    0},                           \
+    {"cgroup",   executeCgroup,   BUILTIN_REDIRECTS}            \
+}
+
+void registerBuiltin(char *, BuiltinHandler, int);
+struct Builtin *findBuiltin(char *);
 int isBuiltIn(char *);
-void handleBuiltIn(struct CommandInfo *, struct ForegroundStatus *,
+int handleBuiltIn(struct CommandInfo *, struct ForegroundStatus *,
+                  struct BackgroundProcesses *);
+int runBuiltin(struct Builtin *, struct CommandInfo *,
+               struct ForegroundStatus *, struct BackgroundProcesses *);
+int runBuiltinStage(void *);
+int executeCommand(struct CommandInfo *, struct ForegroundStatus *,
                    struct BackgroundProcesses *);
-void executeCd(struct CommandInfo *);
-void executeStatus(struct ForegroundStatus *);
-void executeExit(struct BackgroundProcesses *);
+int executeLine(char *, size_t, int, struct ForegroundStatus *,
+                struct BackgroundProcesses *, struct Arena *);
+int executeCd(struct CommandInfo *, struct ForegroundStatus *,
+              struct BackgroundProcesses *);
+int executeStatus(struct CommandInfo *, struct ForegroundStatus *,
+                  struct BackgroundProcesses *);
+int executeExit(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executeSpawn(struct CommandInfo *, struct ForegroundStatus *,
+                 struct BackgroundProcesses *);
+int executeHash(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executeSet(struct CommandInfo *, struct ForegroundStatus *,
+               struct BackgroundProcesses *);
+int executeMemstats(struct CommandInfo *, struct ForegroundStatus *,
+                    struct BackgroundProcesses *);
+int executeJobs(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executeWait(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executeTime(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executeShellStats(struct CommandInfo *, struct ForegroundStatus *,
+                      struct BackgroundProcesses *);
+int executeExport(struct CommandInfo *, struct ForegroundStatus *,
+                  struct BackgroundProcesses *);
+int executeUnset(struct CommandInfo *, struct ForegroundStatus *,
+                 struct BackgroundProcesses *);
+int executeCgroup(struct CommandInfo *, struct ForegroundStatus *,
+                  struct BackgroundProcesses *);
 
 #endif
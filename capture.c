@@ -0,0 +1,217 @@
+/*******************************************************************************
+*      Filename: capture.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the execution of commands whose standard output is
+*                captured, for command substitution. Builtin utilities write
+*                into a memfd in the shell process itself; other builtins run
+*                in a forked copy of the shell, and non-builtin commands are
+*                launched like any pipeline, with the last stage writing into
+*                a pipe.
+*******************************************************************************/
+
+#include "capture.h"
+#include "script.h"
+
+/*******************************************************************************
+*    Function: _readAll()
+*  Parameters: int fd - The descriptor to be read until end of file.
+*              struct CaptureBuffer *buf - The buffer the output is added to.
+* Description: Reads a descriptor into a buffer that doubles whenever it
+*              fills, asking each read() for all of the free space.
+*     Returns: None.
+*******************************************************************************/
+
+void _readAll(int fd, struct CaptureBuffer *buf) {
+    ssize_t numRead;
+
+    while (1) {
+        if (buf->len == buf->capacity) {
+            buf->capacity = buf->capacity ? buf->capacity * 2 :
+                                            CAPTURE_INIT_SIZE;
+            if ((buf->data = realloc(buf->data, buf->capacity)) == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        numRead = read(fd, buf->data + buf->len, buf->capacity - buf->len);
+        if (numRead > 0) {
+            buf->len += numRead;
+        } else if (numRead == 0 || errno != EINTR) {
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+*    Function: _captureBuiltin()
+*  Parameters: struct Builtin *builtin - A builtin utility.
+*              struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Receives the status.
+*              struct CaptureBuffer *buf - Receives the output.
+* Description: Executes a builtin utility in the shell process with its
+*              standard output in a memfd, which unlike a pipe can't fill up
+*              while nobody reads it. The output is read back once the
+*              builtin has finished.
+*     Returns: None.
+*******************************************************************************/
+
+void _captureBuiltin(struct Builtin *builtin, struct CommandInfo *ci,
+                     struct ForegroundStatus *fs, struct CaptureBuffer *buf) {
+    int fd, saved;
+
+    if ((fd = memfd_create("capture", MFD_CLOEXEC)) == -1) {
+        perror("memfd_create");
+        fs->statusNum = 1;
+        return;
+    }
+
+    fflush(stdout);
+    saved = fcntl(1, F_DUPFD_CLOEXEC, 10);
+    dup2(fd, 1);
+    runBuiltin(builtin, ci, fs, NULL);
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+
+    lseek(fd, 0, SEEK_SET);
+    _readAll(fd, buf);
+    close(fd);
+}
+
+/*******************************************************************************
+*    Function: _captureSubshell()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              char *rest - The rest of the list following the command.
+*              size_t restLen - The length of the rest of the list.
+*              int pipeOut - The write end of the capture pipe.
+*              pid_t *pid - Receives the PID of the forked shell.
+* Description: Executes a command, and the rest of its list, in a forked copy
+*              of the shell with its standard output on the capture pipe, so
+*              that builtins such as cd and assignments don't affect the
+*              shell itself. The copy's exit status is that of the last
+*              command executed.
+*     Returns: None.
+*******************************************************************************/
+
+void _captureSubshell(struct CommandInfo *ci, char *rest, size_t restLen,
+                      int pipeOut, pid_t *pid) {
+    struct ForegroundStatus fs;
+    struct BackgroundProcesses bp;
+    struct Arena arena = {0};
+
+    if ((*pid = fork()) == -1) {
+        perror("fork");
+        return;
+    }
+    if (*pid != 0) {
+        return;
+    }
+
+    /* The fork server and the job cgroups belong to the shell. */
+    detachSpawnEngine();
+    forgetJobCgroups();
+    dup2(pipeOut, 1);
+    initForegroundStatus(&fs);
+    initBackgroundProcesses(&bp);
+    if (!executeCommand(ci, &fs, &bp)) {
+        executeLine(rest, restLen, ci->listOp, &fs, &bp, &arena);
+    }
+    fflush(stdout);
+    _exit(LAST_STATUS);
+}
+
+/*******************************************************************************
+*    Function: captureCommand()
+*  Parameters: char *text - The command line to be executed.
+*              size_t len - The length of the command line.
+*              size_t *outLen - Receives the length of the output.
+* Description: Executes a command line in the foreground and captures its
+*              standard output. A builtin utility runs in the shell process;
+*              any other builtin or assignment, a pipeline with such a
+*              builtin as a stage, a compound command, or a list of several
+*              pipelines runs in a forked copy of the shell;
+*              otherwise the pipeline is launched through the spawn engine
+*              with its last stage writing into a pipe, which is read with
+*              large reads while it runs. The command's status becomes the
+*              value of $?.
+*     Returns: The allocated output, which the caller frees.
+*******************************************************************************/
+
+char *captureCommand(char *text, size_t len, size_t *outLen) {
+    struct CommandInfo command, *stage;
+    struct CaptureBuffer buf = {0};
+    struct ForegroundStatus fs;
+    struct Arena arena = {0};
+    struct Builtin *builtin = NULL, *stageBuiltin;
+    struct timespec startTime;
+    int numStages = 0, isSubshell, pipeFDs[2];
+    pid_t pid = -1;
+    size_t used;
+
+    /* A line beginning with a compound command is executed whole by the
+     * copy of the shell, as the rest of a list after an empty command.
+     */
+    if (isCompoundStart(text, len)) {
+        memset(&command, 0, sizeof(command));
+        command.listOp = LIST_SEQ;
+        used = 0;
+    } else {
+        used = processInput(text, len, &command, &arena);
+    }
+    initForegroundStatus(&fs);
+    for (stage = &command; stage != NULL; stage = stage->next) {
+        stage->isForeground = 1;
+        numStages++;
+    }
+    pid_t pids[numStages];
+    struct ForegroundStatus stageStatus[numStages];
+
+    if (command.numArgs > 0) {
+        builtin = findBuiltin(command.args[0]);
+    }
+    isSubshell = builtin != NULL || command.listOp != LIST_END ||
+                 (command.numArgs > 0 && strchr(command.args[0], '=') != NULL);
+    for (stage = command.next; stage != NULL; stage = stage->next) {
+        if ((stageBuiltin = findBuiltin(stage->args[0])) != NULL &&
+            !(stageBuiltin->flags & BUILTIN_EXTERNAL)) {
+            isSubshell = 1;
+        }
+    }
+    if (command.numArgs == 0 && command.listOp == LIST_END) {
+        fs.statusNum = LAST_STATUS;
+    } else if (builtin != NULL && command.next == NULL &&
+               command.listOp == LIST_END &&
+               (builtin->flags & BUILTIN_EXTERNAL)) {
+        _captureBuiltin(builtin, &command, &fs, &buf);
+    } else if (pipe2(pipeFDs, O_CLOEXEC) == -1) {
+        perror("pipe2");
+        fs.statusNum = 1;
+    } else {
+        fcntl(pipeFDs[0], F_SETPIPE_SZ, CAPTURE_PIPE_SIZE);
+        clock_gettime(CLOCK_MONOTONIC, &startTime);
+        if (isSubshell) {
+            _captureSubshell(&command, text + used, len - used, pipeFDs[1],
+                             &pid);
+        } else {
+            launchPipeline(&command, pipeFDs[1], -1, pids, stageStatus, NULL,
+                           NULL);
+        }
+        close(pipeFDs[1]);
+        _readAll(pipeFDs[0], &buf);
+        close(pipeFDs[0]);
+
+        if (isSubshell) {
+            if (pid == -1 || waitChild(pid, 0, &fs) == -1) {
+                fs.statusNum = 1;
+            }
+        } else {
+            waitPipeline(numStages, pids, stageStatus, &startTime, &fs);
+        }
+    }
+
+    setLastStatus(exitCode(&fs));
+    arenaFree(&arena);
+    *outLen = buf.len;
+    return buf.data;
+}
@@ -0,0 +1,46 @@
+/*******************************************************************************
+*      Filename: capture.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for capture.c. See capture.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "builtins.h"
+#include "input.h"
+#include "signal_proc.h"
+#include "variables.h"
+
+/* Initial size of the capture buffer in bytes. It doubles whenever it fills,
+ * and each read() asks for all of the free space.
+ */
+#define CAPTURE_INIT_SIZE  65536
+/* Requested capacity of the capture pipe, so that a command writing a large
+ * output is switched out less often. The kernel may grant less.
+ */
+#define CAPTURE_PIPE_SIZE  (1 << 20)
+
+/* A struct to hold the output of a command as it is read. */
+struct CaptureBuffer {
+    char  *data;
+    size_t len;
+    size_t capacity;
+};
+
+char *captureCommand(char *, size_t, size_t *);
+
+#endif
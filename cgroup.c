@@ -0,0 +1,450 @@
+/*******************************************************************************
+*      Filename: cgroup.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the placement of background jobs in cgroup v2
+*                cgroups of their own, the limits set on those cgroups, and
+*                the reading of their resource usage. Job cgroups are created
+*                in a directory inside the shell's own cgroup, which requires
+*                that cgroup to be delegated to the user.
+*******************************************************************************/
+
+#include "cgroup.h"
+
+/* Job cgroup placement, disabled until the cgroup builtin enables it. */
+struct JobCgroups JOB_CGROUPS = {
+    .dirFD = -1,
+    .nextId = 1
+};
+
+/*******************************************************************************
+*    Function: _findCgroupPath()
+*  Parameters: char *path - Receives the path of the shell's cgroup.
+*              size_t size - The size of path.
+* Description: Finds the directory of the shell's cgroup in the cgroup v2
+*              hierarchy, from the mount point of the hierarchy in
+*              /proc/self/mountinfo and the shell's cgroup in /proc/self/cgroup.
+*     Returns: 0 on success, -1 if there is no cgroup v2 hierarchy.
+*******************************************************************************/
+
+int _findCgroupPath(char *path, size_t size) {
+    char *line = NULL, *fields[5], *c, *group;
+    char mount[PATH_MAX] = "", root[PATH_MAX] = "";
+    size_t lineSize = 0, rootLen;
+    int i, result = -1;
+    FILE *file;
+
+    /* A mountinfo line holds the root of the mount within the hierarchy and
+     * the mount point as its 4th and 5th fields, and the file system type
+     * after a "-".
+     */
+    if ((file = fopen("/proc/self/mountinfo", "re")) == NULL) {
+        return -1;
+    }
+    while (mount[0] == '\0' && getline(&line, &lineSize, file) != -1) {
+        if ((c = strstr(line, " - cgroup2 ")) == NULL) {
+            continue;
+        }
+        *c = '\0';
+        for (i = 0, c = strtok(line, " "); i < 5 && c != NULL;
+             i++, c = strtok(NULL, " ")) {
+            fields[i] = c;
+        }
+        if (i == 5) {
+            snprintf(root, sizeof(root), "%s", fields[3]);
+            snprintf(mount, sizeof(mount), "%s", fields[4]);
+        }
+    }
+    fclose(file);
+
+    /* The cgroup v2 line of /proc/self/cgroup has the form "0::path". */
+    if (mount[0] != '\0' &&
+        (file = fopen("/proc/self/cgroup", "re")) != NULL) {
+        while (result == -1 && getline(&line, &lineSize, file) != -1) {
+            if (strncmp(line, "0::", 3) != 0) {
+                continue;
+            }
+            group = line + 3;
+            group[strcspn(group, "\n")] = '\0';
+            rootLen = strcmp(root, "/") == 0 ? 0 : strlen(root);
+            if (strncmp(group, root, rootLen) == 0) {
+                snprintf(path, size, "%s%s", mount, group + rootLen);
+                if (strlen(path) > 1 && path[strlen(path) - 1] == '/') {
+                    path[strlen(path) - 1] = '\0';
+                }
+                result = 0;
+            }
+        }
+        fclose(file);
+    }
+    free(line);
+    return result;
+}
+
+/*******************************************************************************
+*    Function: _readCgroupFile()
+*  Parameters: int dirFD - The directory of a cgroup.
+*              char *name - The name of an interface file.
+*              char *buffer - Receives the contents, NUL-terminated. Must hold
+*                             CGROUP_READ_MAX characters.
+* Description: Reads a cgroup interface file.
+*     Returns: The number of characters read, or -1 with errno set.
+*******************************************************************************/
+
+ssize_t _readCgroupFile(int dirFD, char *name, char *buffer) {
+    ssize_t numRead;
+    int fd;
+
+    if ((fd = openat(dirFD, name, O_RDONLY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    numRead = read(fd, buffer, CGROUP_READ_MAX - 1);
+    close(fd);
+    if (numRead >= 0) {
+        buffer[numRead] = '\0';
+    }
+    return numRead;
+}
+
+/*******************************************************************************
+*    Function: _writeCgroupFile()
+*  Parameters: int dirFD - The directory of a cgroup.
+*              char *name - The name of an interface file.
+*              char *value - The value to be written.
+* Description: Writes a value to a cgroup interface file in one write(), as
+*              the kernel expects.
+*     Returns: 0 on success, -1 with errno set.
+*******************************************************************************/
+
+int _writeCgroupFile(int dirFD, char *name, char *value) {
+    ssize_t numWritten;
+    int fd;
+
+    if ((fd = openat(dirFD, name, O_WRONLY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    numWritten = write(fd, value, strlen(value));
+    close(fd);
+    return numWritten == -1 ? -1 : 0;
+}
+
+/*******************************************************************************
+*    Function: _hasController()
+*  Parameters: int dirFD - The directory of a cgroup.
+*              char *controller - The name of a controller.
+* Description: Checks whether a controller is enabled for the children of a
+*              cgroup, which gives them its interface files.
+*     Returns: 1 if it is, 0 otherwise.
+*******************************************************************************/
+
+int _hasController(int dirFD, char *controller) {
+    char buffer[CGROUP_READ_MAX];
+    char *c, *state;
+
+    if (_readCgroupFile(dirFD, "cgroup.subtree_control", buffer) == -1) {
+        return 0;
+    }
+    for (c = strtok_r(buffer, " \n", &state); c != NULL;
+         c = strtok_r(NULL, " \n", &state)) {
+        if (strcmp(c, controller) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _openJobCgroups()
+*  Parameters: None.
+* Description: Creates the directory of job cgroups inside the shell's cgroup,
+*              moves the shell into a leaf cgroup in that directory, and
+*              enables the cpu, memory and io controllers for the directory
+*              and for its children. A controller can't be enabled where the
+*              shell's cgroup doesn't offer it, or still holds other processes
+*              and isn't the root, so each is enabled separately and failures
+*              are reported.
+*     Returns: 0 on success, -1 with errno set.
+*******************************************************************************/
+
+int _openJobCgroups() {
+    char *controllers[NUM_CGROUP_LIMITS] = CGROUP_CONTROLLERS_INIT;
+    char own[PATH_MAX], name[32], enable[32];
+    int i, len, parentFD, err;
+
+    if (_findCgroupPath(own, sizeof(own)) == -1) {
+        errno = ENOENT;
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%s%d", CGROUP_DIR_PREFIX, getpid());
+    len = snprintf(JOB_CGROUPS.path, sizeof(JOB_CGROUPS.path), "%s/%s",
+                   strcmp(own, "/") == 0 ? "" : own, name);
+    if (len < 0 || (size_t)len >= sizeof(JOB_CGROUPS.path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if ((parentFD = open(own, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    if ((mkdirat(parentFD, name, 0755) == -1 && errno != EEXIST) ||
+        (JOB_CGROUPS.dirFD = openat(parentFD, name, O_RDONLY | O_DIRECTORY |
+                                                    O_CLOEXEC)) == -1) {
+        err = errno;
+        close(parentFD);
+        errno = err;
+        return -1;
+    }
+    if ((mkdirat(JOB_CGROUPS.dirFD, CGROUP_SHELL_LEAF, 0755) == -1 &&
+         errno != EEXIST) ||
+        _writeCgroupFile(JOB_CGROUPS.dirFD,
+                         CGROUP_SHELL_LEAF "/cgroup.procs", "0") == -1) {
+        fprintf(stderr, "Warning: Unable to move the shell into %s/%s: %s\n",
+                JOB_CGROUPS.path, CGROUP_SHELL_LEAF, strerror(errno));
+        fflush(stderr);
+    }
+
+    for (i = 0; i < NUM_CGROUP_LIMITS; i++) {
+        snprintf(enable, sizeof(enable), "+%s", controllers[i]);
+        if (_writeCgroupFile(parentFD, "cgroup.subtree_control",
+                             enable) == -1 ||
+            _writeCgroupFile(JOB_CGROUPS.dirFD, "cgroup.subtree_control",
+                             enable) == -1) {
+            fprintf(stderr, "Warning: Unable to enable the %s controller for "
+                            "job cgroups: %s\n", controllers[i],
+                    strerror(errno));
+            fflush(stderr);
+        }
+    }
+    close(parentFD);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: enableJobCgroups()
+*  Parameters: None.
+* Description: Enables the placement of each new background job in a cgroup
+*              of its own, creating the directory of job cgroups the first
+*              time. If it can't be created, for example because there is no
+*              cgroup v2 hierarchy or the shell's cgroup isn't delegated, a
+*              warning is displayed once, and jobs run where the shell does.
+*     Returns: 0 on success, -1 if cgroups are unavailable.
+*******************************************************************************/
+
+int enableJobCgroups() {
+    if (JOB_CGROUPS.dirFD == -1 && !JOB_CGROUPS.isUnavailable &&
+        _openJobCgroups() == -1) {
+        fprintf(stderr, "Warning: No delegated cgroup v2 hierarchy, background "
+                        "jobs run without cgroups: %s\n", strerror(errno));
+        fflush(stderr);
+        JOB_CGROUPS.isUnavailable = 1;
+    }
+    if (JOB_CGROUPS.isUnavailable) {
+        return -1;
+    }
+    JOB_CGROUPS.isEnabled = 1;
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: setCgroupLimit()
+*  Parameters: char *name - The interface file of the limit.
+*              char *value - The value of the limit.
+* Description: Sets a limit for the cgroups of later background jobs, and
+*              enables their placement in cgroups. The value is checked by
+*              the kernel when a job cgroup is created.
+*     Returns: 0 on success, -1 with errno set: EINVAL if there is no such
+*              limit, ENOENT if cgroups are unavailable, and EOPNOTSUPP if the
+*              limit's controller isn't enabled.
+*******************************************************************************/
+
+int setCgroupLimit(char *name, char *value) {
+    char *limitNames[NUM_CGROUP_LIMITS] = CGROUP_LIMIT_NAMES_INIT;
+    char *controllers[NUM_CGROUP_LIMITS] = CGROUP_CONTROLLERS_INIT;
+    int i;
+
+    for (i = 0; i < NUM_CGROUP_LIMITS && strcmp(name, limitNames[i]) != 0;
+         i++) {
+        /* Do nothing... */
+    }
+    if (i == NUM_CGROUP_LIMITS) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (enableJobCgroups() == -1) {
+        errno = ENOENT;
+        return -1;
+    }
+    if (!_hasController(JOB_CGROUPS.dirFD, controllers[i])) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    free(JOB_CGROUPS.limits[i]);
+    if ((JOB_CGROUPS.limits[i] = strdup(value)) == NULL) {
+        perror("strdup");
+        exit(1);
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: clearCgroupLimits()
+*  Parameters: None.
+* Description: Clears every limit, so that the cgroups of later jobs keep the
+*              kernel's defaults.
+*     Returns: None.
+*******************************************************************************/
+
+void clearCgroupLimits() {
+    int i;
+
+    for (i = 0; i < NUM_CGROUP_LIMITS; i++) {
+        free(JOB_CGROUPS.limits[i]);
+        JOB_CGROUPS.limits[i] = NULL;
+    }
+}
+
+/*******************************************************************************
+*    Function: createJobCgroup()
+*  Parameters: int *id - Receives the sequence number of the cgroup.
+* Description: Creates the cgroup of a new background job and writes the
+*              limits that are set into it. A limit the kernel rejects is
+*              reported, and the job runs without it.
+*     Returns: A descriptor of the cgroup's directory, for placing processes
+*              in it, or -1 if placement is disabled or the cgroup couldn't be
+*              created.
+*******************************************************************************/
+
+int createJobCgroup(int *id) {
+    char *limitNames[NUM_CGROUP_LIMITS] = CGROUP_LIMIT_NAMES_INIT;
+    char name[32];
+    int i, fd;
+
+    if (!JOB_CGROUPS.isEnabled) {
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%s%d", CGROUP_JOB_PREFIX,
+             JOB_CGROUPS.nextId);
+    if (mkdirat(JOB_CGROUPS.dirFD, name, 0755) == -1 ||
+        (fd = openat(JOB_CGROUPS.dirFD, name, O_RDONLY | O_DIRECTORY |
+                                              O_CLOEXEC)) == -1) {
+        perror("cgroup");
+        return -1;
+    }
+    for (i = 0; i < NUM_CGROUP_LIMITS; i++) {
+        if (JOB_CGROUPS.limits[i] != NULL &&
+            _writeCgroupFile(fd, limitNames[i], JOB_CGROUPS.limits[i]) == -1) {
+            fprintf(stderr, "Warning: Unable to set %s to %s: %s\n",
+                    limitNames[i], JOB_CGROUPS.limits[i], strerror(errno));
+            fflush(stderr);
+        }
+    }
+    *id = JOB_CGROUPS.nextId++;
+    return fd;
+}
+
+/*******************************************************************************
+*    Function: removeJobCgroup()
+*  Parameters: int id - The sequence number of a job cgroup.
+* Description: Removes a job cgroup. Removal fails harmlessly while the cgroup
+*              still holds processes, so it is attempted as each process of
+*              the job is reaped, and succeeds after the last.
+*     Returns: None.
+*******************************************************************************/
+
+void removeJobCgroup(int id) {
+    char name[32];
+
+    snprintf(name, sizeof(name), "%s%d", CGROUP_JOB_PREFIX, id);
+    unlinkat(JOB_CGROUPS.dirFD, name, AT_REMOVEDIR);
+}
+
+/*******************************************************************************
+*    Function: readJobCgroupUsage()
+*  Parameters: int id - The sequence number of a job cgroup.
+*              double *cpuSeconds - Receives the CPU time used by the job's
+*                                   processes, including their children.
+*              long long *memoryBytes - Receives the memory in use, or -1 if
+*                                       the memory controller isn't enabled.
+* Description: Reads the resource usage of a job from its cgroup. CPU time is
+*              accounted for by every cgroup, memory only by the memory
+*              controller.
+*     Returns: 0 on success, -1 if the cgroup can't be read.
+*******************************************************************************/
+
+int readJobCgroupUsage(int id, double *cpuSeconds, long long *memoryBytes) {
+    char buffer[CGROUP_READ_MAX], name[32];
+    char *c;
+    int fd, result = -1;
+
+    snprintf(name, sizeof(name), "%s%d", CGROUP_JOB_PREFIX, id);
+    if ((fd = openat(JOB_CGROUPS.dirFD, name, O_RDONLY | O_DIRECTORY |
+                                              O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    if (_readCgroupFile(fd, "cpu.stat", buffer) != -1 &&
+        (c = strstr(buffer, "usage_usec ")) != NULL) {
+        *cpuSeconds = strtoll(c + strlen("usage_usec "), NULL, 10) / 1e6;
+        *memoryBytes = -1;
+        if (_readCgroupFile(fd, "memory.current", buffer) != -1) {
+            *memoryBytes = strtoll(buffer, NULL, 10);
+        }
+        result = 0;
+    }
+    close(fd);
+    return result;
+}
+
+/*******************************************************************************
+*    Function: closeJobCgroups()
+*  Parameters: None.
+* Description: Removes the remaining job cgroups and their directory, when the
+*              shell exits, after moving the shell back into its own cgroup.
+*              Cgroups that still hold processes are left.
+*     Returns: None.
+*******************************************************************************/
+
+void closeJobCgroups() {
+    struct dirent *entry;
+    DIR *dir;
+    int fd;
+
+    if (JOB_CGROUPS.dirFD == -1) {
+        return;
+    }
+    if ((fd = dup(JOB_CGROUPS.dirFD)) != -1 && (dir = fdopendir(fd)) == NULL) {
+        close(fd);
+    } else if (fd != -1) {
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, CGROUP_JOB_PREFIX,
+                        strlen(CGROUP_JOB_PREFIX)) == 0) {
+                unlinkat(JOB_CGROUPS.dirFD, entry->d_name, AT_REMOVEDIR);
+            }
+        }
+        closedir(dir);
+    }
+    /* Move the shell back into its own cgroup, so that its leaf and the
+     * directory can be removed.
+     */
+    _writeCgroupFile(JOB_CGROUPS.dirFD, "../cgroup.procs", "0");
+    unlinkat(JOB_CGROUPS.dirFD, CGROUP_SHELL_LEAF, AT_REMOVEDIR);
+    close(JOB_CGROUPS.dirFD);
+    rmdir(JOB_CGROUPS.path);
+    JOB_CGROUPS.dirFD = -1;
+    JOB_CGROUPS.isEnabled = 0;
+}
+
+/*******************************************************************************
+*    Function: forgetJobCgroups()
+*  Parameters: None.
+* Description: Clears the job cgroup state inherited by a forked copy of the
+*              shell, so that it neither places jobs in the shell's cgroups nor
+*              removes them when it exits. They are left to the shell.
+*     Returns: None.
+*******************************************************************************/
+
+void forgetJobCgroups() {
+    if (JOB_CGROUPS.dirFD != -1) {
+        close(JOB_CGROUPS.dirFD);
+        JOB_CGROUPS.dirFD = -1;
+    }
+    JOB_CGROUPS.isEnabled = 0;
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+*      Filename: cgroup.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for cgroup.c. See cgroup.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* Prefix of the directory that holds the shell's job cgroups, which is
+ * created inside the shell's own cgroup and named after the shell's PID, and
+ * prefix of each job cgroup, which is followed by a sequence number.
+ */
+#define CGROUP_DIR_PREFIX "basicshell-"
+#define CGROUP_JOB_PREFIX "job"
+/* The cgroup in that directory which holds the shell while placement is
+ * enabled. A cgroup that holds processes can't enable controllers for its
+ * children, so the shell moves out of its own cgroup into this leaf.
+ */
+#define CGROUP_SHELL_LEAF "shell"
+
+/* The limits that can be set on job cgroups, and the controller providing
+ * each, in the same order.
+ */
+#define CGROUP_CPU_MAX       0
+#define CGROUP_MEMORY_MAX    1
+#define CGROUP_IO_WEIGHT     2
+#define NUM_CGROUP_LIMITS    3
+#define CGROUP_LIMIT_NAMES_INIT {"cpu.max", "memory.max", "io.weight"}
+#define CGROUP_CONTROLLERS_INIT {"cpu", "memory", "io"}
+
+/* Size of the buffer that cgroup interface files are read into. */
+#define CGROUP_READ_MAX      4096
+
+/* A struct to hold the state of job cgroup placement. The directory of job
+ * cgroups is created the first time placement is enabled; dirFD is -1 until
+ * then, and isUnavailable is set if it couldn't be created. Each limit is the
+ * value written to the file of the same name in every new job cgroup, or NULL
+ * to keep the kernel's default.
+ */
+struct JobCgroups {
+    int   isEnabled;
+    int   isUnavailable;
+    int   dirFD;
+    char  path[PATH_MAX];
+    char *limits[NUM_CGROUP_LIMITS];
+    int   nextId;
+};
+
+extern struct JobCgroups JOB_CGROUPS;
+
+int enableJobCgroups();
+int setCgroupLimit(char *, char *);
+void clearCgroupLimits();
+int createJobCgroup(int *);
+void removeJobCgroup(int);
+int readJobCgroupUsage(int, double *, long long *);
+void closeJobCgroups();
+void forgetJobCgroups();
+
+#endif
@@ -0,0 +1,379 @@
+/*******************************************************************************
+*      Filename: event_loop.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the shell's event loop, which waits for input and
+*                for children in one place. It drives an io_uring through raw
+*                system calls, and falls back to epoll where io_uring is
+*                missing or disabled.
+*******************************************************************************/
+
+#include "event_loop.h"
+
+/* The event loop of the shell. Until initEventLoop() is called, every wait
+ * returns at once.
+ */
+struct EventLoop EVENT_LOOP = {
+    .backend = EVENTS_EPOLL,
+    .inputFD = -1,
+    .childFD = -1,
+    .ringFD = -1,
+    .epollFD = -1
+};
+
+/*******************************************************************************
+*    Function: _isRingUsable()
+*  Parameters: int ringFD - The descriptor of a new io_uring.
+* Description: Asks the kernel whether it supports every operation the event
+*              loop submits.
+*     Returns: 1 if it does, 0 otherwise.
+*******************************************************************************/
+
+int _isRingUsable(int ringFD) {
+    int ops[] = {IORING_OP_READ, IORING_OP_POLL_ADD};
+    struct io_uring_probe *probe;
+    size_t i;
+    int isUsable = 1;
+
+    probe = calloc(1, sizeof(struct io_uring_probe) +
+                      256 * sizeof(struct io_uring_probe_op));
+    if (probe == NULL) {
+        return 0;
+    }
+    if (syscall(SYS_io_uring_register, ringFD, IORING_REGISTER_PROBE, probe,
+                256) == -1) {
+        isUsable = 0;
+    }
+    for (i = 0; isUsable && i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (ops[i] > probe->last_op ||
+            !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED)) {
+            isUsable = 0;
+        }
+    }
+    free(probe);
+    return isUsable;
+}
+
+/*******************************************************************************
+*    Function: _closeRing()
+*  Parameters: struct EventLoop *loop - The event loop.
+* Description: Unmaps the rings of an io_uring and closes it.
+*     Returns: None.
+*******************************************************************************/
+
+void _closeRing(struct EventLoop *loop) {
+    if (loop->sqes != NULL && loop->sqes != MAP_FAILED) {
+        munmap(loop->sqes, EVENT_RING_ENTRIES * sizeof(struct io_uring_sqe));
+    }
+    if (loop->cqMap != NULL && loop->cqMap != MAP_FAILED &&
+        loop->cqMap != loop->sqMap) {
+        munmap(loop->cqMap, loop->cqMapLen);
+    }
+    if (loop->sqMap != NULL && loop->sqMap != MAP_FAILED) {
+        munmap(loop->sqMap, loop->sqMapLen);
+    }
+    close(loop->ringFD);
+    loop->ringFD = -1;
+    loop->sqMap = loop->cqMap = NULL;
+    loop->sqes = NULL;
+}
+
+/*******************************************************************************
+*    Function: _openRing()
+*  Parameters: struct EventLoop *loop - The event loop.
+* Description: Sets up an io_uring of EVENT_RING_ENTRIES entries and maps its
+*              submission and completion rings. Kernels that map both rings
+*              at once get a single mapping.
+*     Returns: 0 on success, -1 if io_uring is unavailable.
+*******************************************************************************/
+
+int _openRing(struct EventLoop *loop) {
+    struct io_uring_params params;
+    char *sq, *cq;
+
+    memset(&params, 0, sizeof(params));
+    if ((loop->ringFD = syscall(SYS_io_uring_setup, EVENT_RING_ENTRIES,
+                                &params)) == -1) {
+        return -1;
+    }
+    if (!_isRingUsable(loop->ringFD)) {
+        _closeRing(loop);
+        return -1;
+    }
+
+    loop->sqMapLen = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    loop->cqMapLen = params.cq_off.cqes +
+                     params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (loop->cqMapLen > loop->sqMapLen) {
+            loop->sqMapLen = loop->cqMapLen;
+        }
+        loop->cqMapLen = loop->sqMapLen;
+    }
+
+    loop->sqMap = mmap(NULL, loop->sqMapLen, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, loop->ringFD,
+                       IORING_OFF_SQ_RING);
+    if (loop->sqMap == MAP_FAILED) {
+        _closeRing(loop);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        loop->cqMap = loop->sqMap;
+    } else if ((loop->cqMap = mmap(NULL, loop->cqMapLen,
+                                   PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, loop->ringFD,
+                                   IORING_OFF_CQ_RING)) == MAP_FAILED) {
+        _closeRing(loop);
+        return -1;
+    }
+    loop->sqes = mmap(NULL, EVENT_RING_ENTRIES * sizeof(struct io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      loop->ringFD, IORING_OFF_SQES);
+    if (loop->sqes == MAP_FAILED) {
+        _closeRing(loop);
+        return -1;
+    }
+
+    sq = loop->sqMap;
+    cq = loop->cqMap;
+    loop->sqHead = (unsigned *) (sq + params.sq_off.head);
+    loop->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    loop->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    loop->sqArray = (unsigned *) (sq + params.sq_off.array);
+    loop->cqHead = (unsigned *) (cq + params.cq_off.head);
+    loop->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    loop->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    loop->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: initEventLoop()
+*  Parameters: int inputFD - The descriptor commands are read from.
+*              int childFD - The descriptor that becomes readable when a child
+*                            changes state, or -1.
+* Description: Sets up the event loop on io_uring, unless the environment
+*              selects epoll or io_uring is unavailable, in which case both
+*              descriptors are added to an epoll set once. A descriptor that
+*              epoll can't watch, such as a regular file, is always ready.
+*     Returns: None.
+*******************************************************************************/
+
+void initEventLoop(int inputFD, int childFD) {
+    struct EventLoop *loop = &EVENT_LOOP;
+    struct epoll_event event;
+    char *mode = getenv(EVENT_MODE_ENV);
+
+    loop->inputFD = inputFD;
+    loop->childFD = childFD;
+
+    if (mode != NULL && strcmp(mode, "uring") != 0 &&
+        strcmp(mode, "epoll") != 0) {
+        fprintf(stderr, "Warning: Unknown event backend %s\n", mode);
+        fflush(stderr);
+    }
+    if ((mode == NULL || strcmp(mode, "epoll") != 0) && _openRing(loop) == 0) {
+        loop->backend = EVENTS_URING;
+        return;
+    }
+
+    loop->backend = EVENTS_EPOLL;
+    if ((loop->epollFD = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        perror("epoll_create1");
+        return;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u32 = EVENT_INPUT;
+    loop->isInputPolled =
+        epoll_ctl(loop->epollFD, EPOLL_CTL_ADD, inputFD, &event) == 0;
+    if (childFD != -1) {
+        event.data.u32 = EVENT_CHILD;
+        epoll_ctl(loop->epollFD, EPOLL_CTL_ADD, childFD, &event);
+    }
+}
+
+/*******************************************************************************
+*    Function: _nextSqe()
+*  Parameters: struct EventLoop *loop - The event loop.
+*              int opcode - The operation.
+*              unsigned long long tag - The tag of its completion.
+* Description: Takes the next submission queue entry. It is published to the
+*              kernel by the next _enterRing().
+*     Returns: The cleared entry.
+*******************************************************************************/
+
+struct io_uring_sqe *_nextSqe(struct EventLoop *loop, int opcode,
+                              unsigned long long tag) {
+    unsigned index = (*loop->sqTail + loop->numPending) & *loop->sqMask;
+    struct io_uring_sqe *sqe = &loop->sqes[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = tag;
+    loop->sqArray[index] = index;
+    loop->numPending++;
+    return sqe;
+}
+
+/*******************************************************************************
+*    Function: _enterRing()
+*  Parameters: struct EventLoop *loop - The event loop.
+*              unsigned minComplete - The number of completions to wait for.
+* Description: Submits the entries taken since the last call and waits for
+*              completions, in one io_uring_enter().
+*     Returns: The result of io_uring_enter(), -1 with errno set on error. If
+*              entries were submitted, a signal ends the wait without an
+*              error.
+*******************************************************************************/
+
+int _enterRing(struct EventLoop *loop, unsigned minComplete) {
+    unsigned toSubmit = loop->numPending;
+
+    __atomic_store_n(loop->sqTail, *loop->sqTail + toSubmit, __ATOMIC_RELEASE);
+    loop->numPending = 0;
+    return syscall(SYS_io_uring_enter, loop->ringFD, toSubmit, minComplete,
+                   minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/*******************************************************************************
+*    Function: _reapCompletions()
+*  Parameters: struct EventLoop *loop - The event loop.
+* Description: Consumes the completion queue, recording the result of each
+*              request by its tag.
+*     Returns: None.
+*******************************************************************************/
+
+void _reapCompletions(struct EventLoop *loop) {
+    unsigned head = *loop->cqHead;
+    unsigned tail = __atomic_load_n(loop->cqTail, __ATOMIC_ACQUIRE);
+    struct io_uring_cqe *cqe;
+
+    for (; head != tail; head++) {
+        cqe = &loop->cqes[head & *loop->cqMask];
+        if (cqe->user_data == EVENT_TAG_INPUT) {
+            loop->isReading = 0;
+            loop->readResult = cqe->res;
+            loop->isInputReady = 1;
+        } else if (cqe->user_data == EVENT_TAG_CHILD) {
+            loop->isWatching = 0;
+            loop->isChildReady = 1;
+        }
+    }
+    __atomic_store_n(loop->cqHead, head, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+*    Function: _waitRing()
+*  Parameters: struct EventLoop *loop - The event loop.
+*              struct LineReader *reader - The reader input is read into.
+* Description: Waits on the io_uring. Unless they are already in flight, a
+*              read of the input into the reader's buffer and a poll of the
+*              child descriptor are submitted in the same io_uring_enter()
+*              that waits, so a line is read with one system call. Requests
+*              stay in flight across a signal and are waited for again.
+*     Returns: The events that occurred, or -1 with errno set to EINTR if a
+*              signal interrupted the wait.
+*******************************************************************************/
+
+int _waitRing(struct EventLoop *loop, struct LineReader *reader) {
+    struct io_uring_sqe *sqe;
+    size_t space;
+    char *dest;
+    int events = 0;
+
+    if (!loop->isReading && !loop->isInputReady) {
+        dest = reserveLineRead(reader, &space);
+        sqe = _nextSqe(loop, IORING_OP_READ, EVENT_TAG_INPUT);
+        sqe->fd = loop->inputFD;
+        sqe->addr = (unsigned long) dest;
+        sqe->len = space;
+        sqe->off = (__u64) -1;
+        loop->isReading = 1;
+        loop->reader = reader;
+    }
+    if (loop->childFD != -1 && !loop->isWatching && !loop->isChildReady) {
+        sqe = _nextSqe(loop, IORING_OP_POLL_ADD, EVENT_TAG_CHILD);
+        sqe->fd = loop->childFD;
+        sqe->poll32_events = POLLIN;
+        loop->isWatching = 1;
+    }
+
+    if (!loop->isInputReady && !loop->isChildReady &&
+        _enterRing(loop, 1) == -1 && errno != EINTR) {
+        perror("io_uring_enter");
+    }
+    _reapCompletions(loop);
+
+    if (loop->isChildReady) {
+        loop->isChildReady = 0;
+        events |= EVENT_CHILD;
+    }
+    if (loop->isInputReady) {
+        loop->isInputReady = 0;
+        if (loop->readResult >= 0) {
+            commitLineRead(loop->reader, loop->readResult);
+        }
+        events |= EVENT_INPUT;
+    }
+    if (events == 0) {
+        errno = EINTR;
+        return -1;
+    }
+    return events;
+}
+
+/*******************************************************************************
+*    Function: _waitEpoll()
+*  Parameters: struct EventLoop *loop - The event loop.
+* Description: Waits on the epoll set. If the input isn't in the set, it is
+*              always ready, and pending child events are only collected.
+*     Returns: The events that occurred, or -1 with errno set to EINTR if a
+*              signal interrupted the wait.
+*******************************************************************************/
+
+int _waitEpoll(struct EventLoop *loop) {
+    struct epoll_event ready[2];
+    int i, numReady, events = 0;
+
+    if (loop->epollFD == -1) {
+        return EVENT_INPUT | (loop->childFD != -1 ? EVENT_CHILD : 0);
+    }
+    numReady = epoll_wait(loop->epollFD, ready, 2,
+                          loop->isInputPolled ? -1 : 0);
+    if (numReady == -1) {
+        if (errno == EINTR) {
+            return -1;
+        }
+        perror("epoll_wait");
+        return EVENT_INPUT;
+    }
+    for (i = 0; i < numReady; i++) {
+        events |= ready[i].data.u32;
+    }
+    if (!loop->isInputPolled) {
+        events |= EVENT_INPUT;
+    }
+    return events;
+}
+
+/*******************************************************************************
+*    Function: waitEvents()
+*  Parameters: struct LineReader *reader - The reader of the input descriptor,
+*                                          which must own its buffer.
+* Description: Blocks until input arrives or a child changes state. With
+*              io_uring, the input has already been read into the reader
+*              when EVENT_INPUT is returned; with epoll, it is readable.
+*     Returns: The events that occurred, or -1 with errno set to EINTR if a
+*              signal interrupted the wait.
+*******************************************************************************/
+
+int waitEvents(struct LineReader *reader) {
+    struct EventLoop *loop = &EVENT_LOOP;
+
+    if (loop->backend == EVENTS_URING && reader->source == READER_OWNED) {
+        return _waitRing(loop, reader);
+    }
+    return _waitEpoll(loop);
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+*      Filename: event_loop.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for event_loop.c. See event_loop.c for
+*                function descriptions.
+*******************************************************************************/
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "reader.h"
+
+/* Event loop backends. EVENTS_URING submits the read of standard input and
+ * the watch on the child notification descriptor to an io_uring, so that
+ * waiting for a line and reading it is one io_uring_enter(). EVENTS_EPOLL
+ * waits on an epoll set registered once, and leaves the read to the caller;
+ * it is used when io_uring is unavailable.
+ */
+#define EVENTS_URING        0
+#define EVENTS_EPOLL        1
+
+/* Environment variable that selects the epoll backend when set to "epoll".
+ */
+#define EVENT_MODE_ENV      "SHELL_EVENTS"
+
+/* Number of submission queue entries of the ring. */
+#define EVENT_RING_ENTRIES  8
+
+/* Events reported by waitEvents(). */
+#define EVENT_INPUT         0x01  /* Input was read, or is readable. */
+#define EVENT_CHILD         0x02  /* A child changed state. */
+
+/* Tags of the requests submitted to the ring. */
+#define EVENT_TAG_INPUT     1
+#define EVENT_TAG_CHILD     2
+
+/* A struct to hold the state of the event loop: the backend, the descriptors
+ * it watches, the mapped rings of the io_uring, the number of entries not yet
+ * submitted, and the requests in flight.
+ * A read of standard input stays in flight until it completes, even if a
+ * signal interrupts the wait, and its data goes straight into the line
+ * reader's buffer.
+ */
+struct EventLoop {
+    int    backend;
+    int    inputFD;
+    int    childFD;
+    int    isInputPolled;
+
+    int    ringFD;
+    void  *sqMap;
+    void  *cqMap;
+    size_t sqMapLen;
+    size_t cqMapLen;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned numPending;
+
+    int    isReading;
+    int    isWatching;
+    int    isInputReady;
+    int    isChildReady;
+    int    readResult;
+    struct LineReader *reader;
+
+    int    epollFD;
+};
+
+extern struct EventLoop EVENT_LOOP;
+
+void initEventLoop(int, int);
+int waitEvents(struct LineReader *);
+
+#endif
@@ -0,0 +1,579 @@
+/*******************************************************************************
+*      Filename: glob_cache.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the expansion of the pattern characters *, ?, and
+*                [...] into sorted lists of matching paths. Directories are
+*                read with raw getdents64() calls, and their sorted listings
+*                are cached, so that repeated patterns over a large directory
+*                don't read it again until its mtime changes.
+*******************************************************************************/
+
+#include "glob_cache.h"
+
+/* Global directory cache. */
+struct GlobCache GLOB_CACHE = {0};
+
+/*******************************************************************************
+*    Function: isGlobChar()
+*  Parameters: char c - A character.
+* Description: Tests whether a character has a meaning in a pattern.
+*     Returns: 1 if the character is special in a pattern, 0 otherwise.
+*******************************************************************************/
+
+int isGlobChar(char c) {
+    return c == '*' || c == '?' || c == '[' || c == ']';
+}
+
+/*******************************************************************************
+*    Function: _hashIdentity()
+*  Parameters: dev_t dev - The device of a directory.
+*              ino_t ino - The inode of a directory.
+* Description: Mixes the identity of a directory into a hash value.
+*     Returns: The hash value.
+*******************************************************************************/
+
+unsigned int _hashIdentity(dev_t dev, ino_t ino) {
+    uint64_t hash = ((uint64_t) ino ^ ((uint64_t) dev << 32)) *
+                    0x9E3779B97F4A7C15ull;
+
+    return (unsigned int) (hash >> 32);
+}
+
+/*******************************************************************************
+*    Function: _findListing()
+*  Parameters: dev_t dev - The device of a directory.
+*              ino_t ino - The inode of a directory.
+* Description: Finds the bucket of a directory with linear probing.
+*     Returns: The bucket index holding the directory, or the index of the
+*              empty bucket where it would be inserted.
+*******************************************************************************/
+
+int _findListing(dev_t dev, ino_t ino) {
+    int mask = GLOB_CACHE.capacity - 1;
+    int i = _hashIdentity(dev, ino) & mask;
+
+    while (GLOB_CACHE.buckets[i].nameData != NULL &&
+           (GLOB_CACHE.buckets[i].dev != dev ||
+            GLOB_CACHE.buckets[i].ino != ino)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*******************************************************************************
+*    Function: _growGlobCache()
+*  Parameters: None.
+* Description: Allocates the bucket array, or doubles it and rehashes all
+*              listings once the load factor would exceed 0.7.
+*     Returns: None.
+*******************************************************************************/
+
+void _growGlobCache() {
+    struct DirListing *old = GLOB_CACHE.buckets;
+    int oldCapacity = GLOB_CACHE.capacity;
+    int i;
+
+    if (old != NULL && (GLOB_CACHE.size + 1) * 10 <= oldCapacity * 7) {
+        return;
+    }
+
+    GLOB_CACHE.capacity = old ? oldCapacity * 2 : GLOB_CACHE_INIT_SIZE;
+    GLOB_CACHE.buckets = calloc(GLOB_CACHE.capacity, sizeof(struct DirListing));
+    if (GLOB_CACHE.buckets == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i].nameData != NULL) {
+            GLOB_CACHE.buckets[_findListing(old[i].dev, old[i].ino)] = old[i];
+        }
+    }
+    free(old);
+}
+
+/*******************************************************************************
+*    Function: clearGlobCache()
+*  Parameters: None.
+* Description: Frees every cached directory listing.
+*     Returns: None.
+*******************************************************************************/
+
+void clearGlobCache() {
+    int i;
+
+    for (i = 0; i < GLOB_CACHE.capacity; i++) {
+        if (GLOB_CACHE.buckets[i].nameData != NULL) {
+            free(GLOB_CACHE.buckets[i].names);
+            free(GLOB_CACHE.buckets[i].nameData);
+        }
+    }
+    free(GLOB_CACHE.buckets);
+    memset(&GLOB_CACHE, 0, sizeof(struct GlobCache));
+}
+
+/*******************************************************************************
+*    Function: _compareDirNames()
+*  Parameters: const void *a - A pointer to a DirName struct.
+*              const void *b - A pointer to a DirName struct.
+* Description: Orders directory names by byte value, for qsort().
+*     Returns: A negative, zero, or positive value as a sorts before, with, or
+*              after b.
+*******************************************************************************/
+
+int _compareDirNames(const void *a, const void *b) {
+    return strcmp(((const struct DirName *) a)->name,
+                  ((const struct DirName *) b)->name);
+}
+
+/*******************************************************************************
+*    Function: _comparePaths()
+*  Parameters: const void *a - A pointer to a path.
+*              const void *b - A pointer to a path.
+* Description: Orders paths by byte value, for qsort().
+*     Returns: A negative, zero, or positive value as a sorts before, with, or
+*              after b.
+*******************************************************************************/
+
+int _comparePaths(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/*******************************************************************************
+*    Function: _readListing()
+*  Parameters: char *dir - The path of the directory.
+*              struct DirListing *listing - Receives the names.
+* Description: Reads every name of a directory, except "." and "..", with raw
+*              getdents64() calls and sorts them. The names are first stored
+*              by offset, since the name buffer moves as it grows.
+*     Returns: 0 on success, -1 if the directory couldn't be read.
+*******************************************************************************/
+
+int _readListing(char *dir, struct DirListing *listing) {
+    static char *dents = NULL;
+    struct LinuxDirent64 *entry;
+    size_t dataLen = 0, dataCapacity = 256, nameLen;
+    int namesCapacity = 16;
+    long numBytes, pos;
+    int fd, i;
+
+    if (dents == NULL && (dents = malloc(GLOB_DENTS_BUF_SIZE)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    if ((fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+
+    listing->numNames = 0;
+    listing->names = malloc(namesCapacity * sizeof(struct DirName));
+    listing->nameData = malloc(dataCapacity);
+    if (listing->names == NULL || listing->nameData == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+
+    while ((numBytes = syscall(SYS_getdents64, fd, dents,
+                               GLOB_DENTS_BUF_SIZE)) > 0) {
+        for (pos = 0; pos < numBytes; pos += entry->d_reclen) {
+            entry = (struct LinuxDirent64 *) (dents + pos);
+            if (entry->d_name[0] == '.' && (entry->d_name[1] == '\0' ||
+                (entry->d_name[1] == '.' && entry->d_name[2] == '\0'))) {
+                continue;
+            }
+
+            nameLen = strlen(entry->d_name) + 1;
+            if (dataLen + nameLen > dataCapacity) {
+                while (dataLen + nameLen > dataCapacity) {
+                    dataCapacity *= 2;
+                }
+                listing->nameData = realloc(listing->nameData, dataCapacity);
+            }
+            if (listing->numNames == namesCapacity) {
+                namesCapacity *= 2;
+                listing->names = realloc(listing->names,
+                                         namesCapacity *
+                                         sizeof(struct DirName));
+            }
+            if (listing->nameData == NULL || listing->names == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+
+            memcpy(listing->nameData + dataLen, entry->d_name, nameLen);
+            listing->names[listing->numNames].name = (char *) dataLen;
+            listing->names[listing->numNames++].type = entry->d_type;
+            dataLen += nameLen;
+        }
+    }
+    close(fd);
+    if (numBytes == -1) {
+        free(listing->names);
+        free(listing->nameData);
+        listing->nameData = NULL;
+        return -1;
+    }
+
+    for (i = 0; i < listing->numNames; i++) {
+        listing->names[i].name = listing->nameData +
+                                 (size_t) listing->names[i].name;
+    }
+    qsort(listing->names, listing->numNames, sizeof(struct DirName),
+          _compareDirNames);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _getListing()
+*  Parameters: char *dir - The path of the directory.
+* Description: Finds the sorted listing of a directory. A cached listing is
+*              used if the directory's mtime hasn't changed and the listing
+*              was read long enough after that mtime; otherwise the directory
+*              is read again.
+*     Returns: A pointer to the listing, or NULL if the path isn't a readable
+*              directory.
+*******************************************************************************/
+
+struct DirListing *_getListing(char *dir) {
+    struct DirListing *listing;
+    struct stat info;
+    struct timespec now;
+    int i;
+
+    if (stat(dir, &info) == -1 || !S_ISDIR(info.st_mode)) {
+        return NULL;
+    }
+
+    if (GLOB_CACHE.buckets == NULL) {
+        _growGlobCache();
+    }
+    i = _findListing(info.st_dev, info.st_ino);
+    listing = &GLOB_CACHE.buckets[i];
+    if (listing->nameData != NULL) {
+        if (listing->isSettled &&
+            listing->mtime.tv_sec == info.st_mtim.tv_sec &&
+            listing->mtime.tv_nsec == info.st_mtim.tv_nsec) {
+            return listing;
+        }
+        free(listing->names);
+        free(listing->nameData);
+        listing->nameData = NULL;
+        GLOB_CACHE.size--;
+    }
+
+    /* Make room for the listing, emptying the cache if it is full. */
+    if (GLOB_CACHE.size >= GLOB_CACHE_MAX_DIRS) {
+        clearGlobCache();
+        _growGlobCache();
+    } else if ((GLOB_CACHE.size + 1) * 10 > GLOB_CACHE.capacity * 7) {
+        _growGlobCache();
+    }
+    listing = &GLOB_CACHE.buckets[_findListing(info.st_dev, info.st_ino)];
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (_readListing(dir, listing) == -1) {
+        return NULL;
+    }
+    listing->dev = info.st_dev;
+    listing->ino = info.st_ino;
+    listing->mtime = info.st_mtim;
+    listing->isSettled = (now.tv_sec - info.st_mtim.tv_sec) * 1000000000LL +
+                         (now.tv_nsec - info.st_mtim.tv_nsec) >=
+                         GLOB_CACHE_SETTLE_NS;
+    GLOB_CACHE.size++;
+    return listing;
+}
+
+/*******************************************************************************
+*    Function: _matchOne()
+*  Parameters: char **p - A pointer into the pattern, advanced past the
+*                         pattern element on a match.
+*              char c - The character to be matched.
+* Description: Matches one character against the pattern element at *p: ?, a
+*              bracket expression, an escaped character, or a literal. A
+*              bracket expression may be negated with ! or ^ and may contain
+*              ranges; a [ without a closing ] is literal.
+*     Returns: 1 if the character matches, 0 otherwise.
+*******************************************************************************/
+
+int _matchOne(char **p, char c) {
+    char *q = *p + 1;
+    int isNegated = 0, isMatch = 0;
+    char low, high;
+
+    switch (**p) {
+        case '\0':
+            return 0;
+        case '?':
+            (*p)++;
+            return 1;
+        case '\\':
+            if (q[0] != '\0') {
+                *p += 2;
+                return q[0] == c;
+            }
+            break;
+        case '[':
+            if (*q == '!' || *q == '^') {
+                isNegated = 1;
+                q++;
+            }
+            /* A ] at the start of the list is a member, not the end. */
+            do {
+                if (*q == '\0') {
+                    break;
+                }
+                if (*q == '\\' && q[1] != '\0') {
+                    q++;
+                }
+                low = high = *q++;
+                if (q[0] == '-' && q[1] != ']' && q[1] != '\0') {
+                    q++;
+                    if (*q == '\\' && q[1] != '\0') {
+                        q++;
+                    }
+                    high = *q++;
+                }
+                if ((unsigned char) c >= (unsigned char) low &&
+                    (unsigned char) c <= (unsigned char) high) {
+                    isMatch = 1;
+                }
+            } while (*q != ']');
+            if (*q == ']') {
+                *p = q + 1;
+                return isMatch != isNegated;
+            }
+            break;
+    }
+
+    /* A literal character, including an unterminated [. */
+    if (**p == c) {
+        (*p)++;
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _matchPattern()
+*  Parameters: char *p - The pattern of one path component.
+*              char *s - The name to be matched.
+* Description: Matches a whole name against a pattern. On a mismatch after a
+*              *, the * is retried one character further, so the match takes
+*              time proportional to the product of the lengths.
+*     Returns: 1 if the name matches, 0 otherwise.
+*******************************************************************************/
+
+int _matchPattern(char *p, char *s) {
+    char *star = NULL, *starName = NULL;
+
+    while (*s != '\0') {
+        if (*p == '*') {
+            while (*p == '*') {
+                p++;
+            }
+            star = p;
+            starName = s;
+        } else if (!_matchOne(&p, *s)) {
+            if (star == NULL) {
+                return 0;
+            }
+            p = star;
+            s = ++starName;
+        } else {
+            s++;
+        }
+    }
+    while (*p == '*') {
+        p++;
+    }
+    return *p == '\0';
+}
+
+/*******************************************************************************
+*    Function: _hasGlob()
+*  Parameters: char *p - The pattern of one path component.
+* Description: Tests whether a component contains an unescaped *, ?, or [.
+*     Returns: 1 if the component is a pattern, 0 if it is a literal name.
+*******************************************************************************/
+
+int _hasGlob(char *p) {
+    for (; *p != '\0'; p++) {
+        if (*p == '\\' && p[1] != '\0') {
+            p++;
+        } else if (*p == '*' || *p == '?' || *p == '[') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _addMatch()
+*  Parameters: struct GlobMatches *matches - The matches collected so far.
+*              char *path - The matching path.
+* Description: Copies a matching path into the arena and appends it.
+*     Returns: None.
+*******************************************************************************/
+
+void _addMatch(struct GlobMatches *matches, char *path) {
+    size_t len = strlen(path) + 1;
+
+    if (matches->count == matches->capacity) {
+        matches->capacity = matches->capacity ? matches->capacity * 2 : 16;
+        matches->paths = realloc(matches->paths,
+                                 matches->capacity * sizeof(char *));
+        if (matches->paths == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    matches->paths[matches->count] = arenaAlloc(matches->arena, len);
+    memcpy(matches->paths[matches->count++], path, len);
+}
+
+/*******************************************************************************
+*    Function: _isDirectory()
+*  Parameters: char *path - The path of a directory entry.
+*              unsigned char type - The type reported by getdents64().
+* Description: Tests whether a directory entry is a directory, or a symbolic
+*              link to one. The type is only checked with stat() if the file
+*              system doesn't report it or the entry is a link.
+*     Returns: 1 if the entry leads to a directory, 0 otherwise.
+*******************************************************************************/
+
+int _isDirectory(char *path, unsigned char type) {
+    struct stat info;
+
+    if (type == DT_DIR) {
+        return 1;
+    }
+    if (type != DT_LNK && type != DT_UNKNOWN) {
+        return 0;
+    }
+    return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+/*******************************************************************************
+*    Function: _expandPath()
+*  Parameters: struct GlobMatches *matches - The matches collected so far.
+*              char *path - A PATH_MAX buffer holding the expanded prefix.
+*              size_t pathLen - The length of the prefix.
+*              char *rest - The remaining components of the pattern.
+* Description: Expands the next component of a pattern against the directory
+*              named by the prefix, recursing into each match until the
+*              pattern is exhausted. A literal component is appended as is. A
+*              name beginning with . is only matched by a component beginning
+*              with a literal dot.
+*     Returns: None.
+*******************************************************************************/
+
+void _expandPath(struct GlobMatches *matches, char *path, size_t pathLen,
+                 char *rest) {
+    struct DirListing *listing;
+    struct stat info;
+    char *slash = strchr(rest, '/');
+    size_t compLen = slash ? (size_t) (slash - rest) : strlen(rest);
+    size_t nameLen;
+    char comp[compLen + 1];
+    char *p, *out;
+    int i;
+
+    /* The whole pattern has been expanded; the path exists if it came from a
+     * listing or a literal component was found.
+     */
+    if (*rest == '\0') {
+        path[pathLen] = '\0';
+        if (lstat(path, &info) == 0) {
+            _addMatch(matches, path);
+        }
+        return;
+    }
+
+    memcpy(comp, rest, compLen);
+    comp[compLen] = '\0';
+    rest += compLen + (slash != NULL);
+
+    if (!_hasGlob(comp)) {
+        if (pathLen + compLen + 2 > PATH_MAX) {
+            return;
+        }
+        for (p = comp, out = path + pathLen; *p != '\0'; p++) {
+            if (*p == '\\' && p[1] != '\0') {
+                p++;
+            }
+            *out++ = *p;
+        }
+        if (slash != NULL) {
+            *out++ = '/';
+        }
+        _expandPath(matches, path, out - path, rest);
+        return;
+    }
+
+    path[pathLen] = '\0';
+    if ((listing = _getListing(pathLen ? path : ".")) == NULL) {
+        return;
+    }
+    for (i = 0; i < listing->numNames; i++) {
+        if (listing->names[i].name[0] == '.' && comp[0] != '.' &&
+            !(comp[0] == '\\' && comp[1] == '.')) {
+            continue;
+        }
+        if (!_matchPattern(comp, listing->names[i].name)) {
+            continue;
+        }
+        nameLen = strlen(listing->names[i].name);
+        if (pathLen + nameLen + 2 > PATH_MAX) {
+            continue;
+        }
+        memcpy(path + pathLen, listing->names[i].name, nameLen + 1);
+        if (slash == NULL) {
+            _addMatch(matches, path);
+            continue;
+        }
+        if (_isDirectory(path, listing->names[i].type)) {
+            path[pathLen + nameLen] = '/';
+            _expandPath(matches, path, pathLen + nameLen + 1, rest);
+        }
+        /* The recursion may have moved or evicted the listing. */
+        path[pathLen] = '\0';
+        if ((listing = _getListing(pathLen ? path : ".")) == NULL) {
+            return;
+        }
+    }
+}
+
+/*******************************************************************************
+*    Function: expandGlob()
+*  Parameters: char *pattern - The pattern, in which \ escapes the next
+*                              character.
+*              struct Arena *arena - The arena holding the matching paths.
+*              char ***paths - Receives the array of matching paths, which the
+*                              caller frees.
+* Description: Expands a pattern into the paths that match it. Each component
+*              of the pattern is matched against the names of one directory.
+*     Returns: The number of matching paths, sorted by byte value, or 0 if no
+*              path matches.
+*******************************************************************************/
+
+int expandGlob(char *pattern, struct Arena *arena, char ***paths) {
+    struct GlobMatches matches = {arena, NULL, 0, 0};
+    char path[PATH_MAX];
+    size_t pathLen = 0;
+
+    while (*pattern == '/') {
+        path[pathLen++] = *pattern++;
+        if (pathLen == PATH_MAX - 1) {
+            break;
+        }
+    }
+    _expandPath(&matches, path, pathLen, pattern);
+
+    /* The array isn't allocated until the first match. */
+    if (matches.count > 1) {
+        qsort(matches.paths, matches.count, sizeof(char *), _comparePaths);
+    }
+    *paths = matches.paths;
+    return matches.count;
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+*      Filename: glob_cache.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for glob_cache.c. See glob_cache.c for
+*                function descriptions.
+*******************************************************************************/
+
+#ifndef GLOB_CACHE_H
+#define GLOB_CACHE_H
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arena.h"
+
+/* Initial number of buckets in the directory cache. Must be a power of two. */
+#define GLOB_CACHE_INIT_SIZE  32
+/* Maximum number of directories in the cache. Once it is reached, the cache
+ * is emptied.
+ */
+#define GLOB_CACHE_MAX_DIRS   128
+/* Size of the buffer filled by each getdents64() call. */
+#define GLOB_DENTS_BUF_SIZE   65536
+/* A listing is trusted while the directory's mtime is unchanged, but only if
+ * it was read at least this many nanoseconds after that mtime. The kernel
+ * stamps mtimes from a coarse clock, so a change made just after an earlier
+ * read can carry the same mtime; a listing this recent is read again.
+ */
+#define GLOB_CACHE_SETTLE_NS  50000000LL
+
+/* The layout of a record returned by getdents64(). */
+struct LinuxDirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+/* A struct to hold one name of a directory listing. */
+struct DirName {
+    char          *name;
+    unsigned char  type;
+};
+
+/* A struct to hold the listing of a directory, sorted by name, along with
+ * the identity and mtime of the directory when it was read. A NULL nameData
+ * marks an empty bucket.
+ */
+struct DirListing {
+    dev_t           dev;
+    ino_t           ino;
+    struct timespec mtime;
+    int             isSettled;
+    int             numNames;
+    struct DirName *names;
+    char           *nameData;
+};
+
+/* A struct to hold the directory listings in an open addressing hash table
+ * keyed by device and inode, so that a directory is found under any path and
+ * from any working directory.
+ */
+struct GlobCache {
+    struct DirListing *buckets;
+    int capacity;
+    int size;
+};
+
+/* A struct to collect the paths matching a pattern. The paths are allocated
+ * from an arena, and the array with malloc().
+ */
+struct GlobMatches {
+    struct Arena *arena;
+    char **paths;
+    int    count;
+    int    capacity;
+};
+
+int isGlobChar(char);
+int expandGlob(char *, struct Arena *, char ***);
+void clearGlobCache();
+
+#endif
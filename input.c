@@ -3,298 +3,813 @@
 *        Author: Maxwell Goldberg
 * Last Modified: 03.03.17
 *   Description: Contains methods for processing a user command line string
-*                and cleaning up memory allocated to the CommandLine struct.
+*                into a CommandInfo struct allocated from an Arena.
 *******************************************************************************/
 
 #include "input.h"
+#include "capture.h"
+
+/* The shell's process ID as a string, used to expand "$$". */
+char PID_STRING[PID_LEN+1] = "";
+int  PID_STRING_LEN = 0;
+
+/* Character class table of the lexer. Unlisted characters are C_OTHER. */
+const unsigned char CHAR_CLASSES[256] = {
+    ['\0'] = C_END,    ['\n'] = C_END,
+    [' ']  = C_SPACE,  ['\t'] = C_SPACE, ['\v'] = C_SPACE,
+    ['\f'] = C_SPACE,  ['\r'] = C_SPACE,
+    ['\''] = C_SQUOTE, ['"']  = C_DQUOTE, ['\\'] = C_BSLASH,
+    ['$']  = C_DOLLAR,
+    ['<']  = C_OP,     ['>']  = C_OP,     ['|']  = C_OP,     ['&'] = C_OP,
+    [';']  = C_OP,
+    ['*']  = C_GLOB,   ['?']  = C_GLOB,   ['[']  = C_GLOB,   [']'] = C_GLOB
+};
+
+/* Transition table of the lexer, indexed by state and character class. */
+const struct LexTransition LEX_TABLE[NUM_LEX_STATES][NUM_CHAR_CLASSES] = {
+    [S_BLANK] = {
+        [C_OTHER]  = {LEX_START | LEX_APPEND,           S_WORD},
+        [C_END]    = {LEX_FINISH,                        S_BLANK},
+        [C_SPACE]  = {0,                                 S_BLANK},
+        [C_SQUOTE] = {LEX_START,                         S_SQUOTE},
+        [C_DQUOTE] = {LEX_START,                         S_DQUOTE},
+        [C_BSLASH] = {LEX_START,                         S_ESCAPE},
+        [C_DOLLAR] = {LEX_START,                         S_DOLLAR},
+        [C_OP]     = {LEX_OP,                            S_BLANK},
+        [C_GLOB]   = {LEX_START | LEX_GLOB | LEX_APPEND, S_WORD}
+    },
+    [S_WORD] = {
+        [C_OTHER]  = {LEX_APPEND,                        S_WORD},
+        [C_END]    = {LEX_END | LEX_FINISH,              S_BLANK},
+        [C_SPACE]  = {LEX_END,                           S_BLANK},
+        [C_SQUOTE] = {0,                                 S_SQUOTE},
+        [C_DQUOTE] = {0,                                 S_DQUOTE},
+        [C_BSLASH] = {0,                                 S_ESCAPE},
+        [C_DOLLAR] = {0,                                 S_DOLLAR},
+        [C_OP]     = {LEX_END | LEX_OP,                  S_BLANK},
+        [C_GLOB]   = {LEX_GLOB | LEX_APPEND,             S_WORD}
+    },
+    [S_SQUOTE] = {
+        [C_OTHER]  = {LEX_APPEND,                        S_SQUOTE},
+        [C_END]    = {LEX_ERROR | LEX_FINISH,            S_BLANK},
+        [C_SPACE]  = {LEX_APPEND,                        S_SQUOTE},
+        [C_SQUOTE] = {0,                                 S_WORD},
+        [C_DQUOTE] = {LEX_APPEND,                        S_SQUOTE},
+        [C_BSLASH] = {LEX_APPEND,                        S_SQUOTE},
+        [C_DOLLAR] = {LEX_APPEND,                        S_SQUOTE},
+        [C_OP]     = {LEX_APPEND,                        S_SQUOTE},
+        [C_GLOB]   = {LEX_APPEND,                        S_SQUOTE}
+    },
+    [S_DQUOTE] = {
+        [C_OTHER]  = {LEX_APPEND,                        S_DQUOTE},
+        [C_END]    = {LEX_ERROR | LEX_FINISH,            S_BLANK},
+        [C_SPACE]  = {LEX_APPEND,                        S_DQUOTE},
+        [C_SQUOTE] = {LEX_APPEND,                        S_DQUOTE},
+        [C_DQUOTE] = {0,                                 S_WORD},
+        [C_BSLASH] = {0,                                 S_DQ_ESCAPE},
+        [C_DOLLAR] = {0,                                 S_DQ_DOLLAR},
+        [C_OP]     = {LEX_APPEND,                        S_DQUOTE},
+        [C_GLOB]   = {LEX_APPEND,                        S_DQUOTE}
+    },
+    [S_ESCAPE] = {
+        [C_OTHER]  = {LEX_APPEND,                        S_WORD},
+        [C_END]    = {LEX_END | LEX_FINISH,              S_BLANK},
+        [C_SPACE]  = {LEX_APPEND,                        S_WORD},
+        [C_SQUOTE] = {LEX_APPEND,                        S_WORD},
+        [C_DQUOTE] = {LEX_APPEND,                        S_WORD},
+        [C_BSLASH] = {LEX_APPEND,                        S_WORD},
+        [C_DOLLAR] = {LEX_APPEND,                        S_WORD},
+        [C_OP]     = {LEX_APPEND,                        S_WORD},
+        [C_GLOB]   = {LEX_APPEND,                        S_WORD}
+    },
+    [S_DQ_ESCAPE] = {
+        [C_OTHER]  = {LEX_BSLASH | LEX_APPEND,           S_DQUOTE},
+        [C_END]    = {LEX_ERROR | LEX_FINISH,            S_BLANK},
+        [C_SPACE]  = {LEX_BSLASH | LEX_APPEND,           S_DQUOTE},
+        [C_SQUOTE] = {LEX_BSLASH | LEX_APPEND,           S_DQUOTE},
+        [C_DQUOTE] = {LEX_APPEND,                        S_DQUOTE},
+        [C_BSLASH] = {LEX_APPEND,                        S_DQUOTE},
+        [C_DOLLAR] = {LEX_APPEND,                        S_DQUOTE},
+        [C_OP]     = {LEX_BSLASH | LEX_APPEND,           S_DQUOTE},
+        [C_GLOB]   = {LEX_BSLASH | LEX_APPEND,           S_DQUOTE}
+    },
+    [S_DOLLAR] = {
+        [C_OTHER]  = {LEX_VAR,                           S_WORD},
+        [C_END]    = {LEX_DOLLAR | LEX_END | LEX_FINISH, S_BLANK},
+        [C_SPACE]  = {LEX_DOLLAR | LEX_END,              S_BLANK},
+        [C_SQUOTE] = {LEX_DOLLAR,                        S_SQUOTE},
+        [C_DQUOTE] = {LEX_DOLLAR,                        S_DQUOTE},
+        [C_BSLASH] = {LEX_DOLLAR,                        S_ESCAPE},
+        [C_DOLLAR] = {LEX_PID,                           S_WORD},
+        [C_OP]     = {LEX_DOLLAR | LEX_END | LEX_OP,     S_BLANK},
+        [C_GLOB]   = {LEX_VAR,                           S_WORD}
+    },
+    [S_DQ_DOLLAR] = {
+        [C_OTHER]  = {LEX_VAR,                           S_DQUOTE},
+        [C_END]    = {LEX_ERROR | LEX_FINISH,            S_BLANK},
+        [C_SPACE]  = {LEX_DOLLAR | LEX_APPEND,           S_DQUOTE},
+        [C_SQUOTE] = {LEX_DOLLAR | LEX_APPEND,           S_DQUOTE},
+        [C_DQUOTE] = {LEX_DOLLAR,                        S_WORD},
+        [C_BSLASH] = {LEX_DOLLAR,                        S_DQ_ESCAPE},
+        [C_DOLLAR] = {LEX_PID,                           S_DQUOTE},
+        [C_OP]     = {LEX_DOLLAR | LEX_APPEND,           S_DQUOTE},
+        [C_GLOB]   = {LEX_VAR,                           S_DQUOTE}
+    }
+};
 
 /*******************************************************************************
-*    Function: _expandVars()
-*  Parameters: char *inBuffer - The user input string.
-*             char *outBuffer - The input string with expansions performed.
-* Description: Performs variable expansion on '$$' instances within the user
-*              input string.
+*    Function: _checkRedirect()
+*  Parameters: struct LexContext *lex - The lexer state.
+* Description: Reports a redirect operator that isn't followed by a filename.
 *     Returns: None.
 *******************************************************************************/
 
-void _expandVars(char *inBuffer, char *outBuffer) {
-    int i, j;
-    int current = 0;
-    int dollarFlag = 0;
-    pid_t pid = getpid(); /* Determine the process ID. */
-    /* Write the process ID to string */
-    char pidBuffer[PID_LEN+1];
-    memset(pidBuffer, '\0', sizeof(pidBuffer));
-    sprintf(pidBuffer, "%i", pid);   
-
-    /* Iterate through the input String. */
-    for (i = 0; i <= strlen(inBuffer); i++) {
-        /* If the dollar flag isn't set and we encounter a dollar sign,
-         * write the dollar sign to the outbuffer and increment the
-         * outbuffer index. We don't want to overwrite single dollar sign
-         * characters, so we need to remain agnostic about the presence
-         * of a second dollar sign until the next loop iteration. We
-         * set the dollar flag so that we know that a dollar sign was
-         * previously encountered.
-         */
-        if (!dollarFlag && inBuffer[i] == '$') {
-            outBuffer[current] = inBuffer[i];
-            current++;
-            dollarFlag = 1;
-        /* If variable expansion is to occur, we set the outbuffer index
-         * back one character in order to overwrite the previously written
-         * dollar sign, and output the processID.
-         */
-        } else if (dollarFlag && inBuffer[i] == '$') {
-            current--;
-            for (j = 0; j < strlen(pidBuffer); j++) {
-                outBuffer[current] = pidBuffer[j];
-                current++;
-            }
-            dollarFlag = 0; /* Reset the dollar flag */
-        /* Copy the inbuffer character to the outbuffer. */
-        } else {
-            outBuffer[current] = inBuffer[i];
-            current++;
-        }
-    } 
+void _checkRedirect(struct LexContext *lex) {
+    if (lex->pendingRedir == '<') {
+        fprintf(stderr, "Warning: Input redir doesn't specify file\n");
+        fflush(stderr);
+    } else if (lex->pendingRedir == '>') {
+        fprintf(stderr, "Warning: Output redir doesn't specify file\n");
+        fflush(stderr);
+    }
+    lex->pendingRedir = 0;
 }
 
 /*******************************************************************************
-*    Function: _addArgument()
-*  Parameters: char *argBuffer - The string to be copied to the argument value.
-*              int arPos - The position of the arg in the CommandInfo args arr.
-*              int argLen - The length of the string (w/o null terminator).
-*              struct CommandInfo *ci - A pointer to the CommandInfo struct.
-* Description: Allocates memory for an individual Argument struct.
+*    Function: _rejectEmptyStage()
+*  Parameters: struct LexContext *lex - The lexer state.
+* Description: Reports a pipeline stage without a command. A pipeline with an
+*              empty stage can't be executed, so the line is discarded.
 *     Returns: None.
 *******************************************************************************/
 
-void _addArgument(char *argBuffer, int argPos, int argLen, 
-                  struct CommandInfo *ci) {
-    /* Allocate the Argument struct. */
-    ci->args[argPos] = malloc(sizeof(struct Argument));
-    /* Allocate and fill the Argument value. */
-    ci->args[argPos]->value = malloc((sizeof(char) * argLen) + 1);
-    memset(ci->args[argPos]->value, '\0', (sizeof(char) * argLen) + 1);
-    strcpy(ci->args[argPos]->value, argBuffer);
-    /* Set each Argument active by default */
-    ci->args[argPos]->isActive = 1;
+void _rejectEmptyStage(struct LexContext *lex) {
+    if (lex->isValid) {
+        fprintf(stderr, "Warning: Pipeline stage has no command\n");
+        fflush(stderr);
+    }
+    lex->isValid = 0;
 }
 
 /*******************************************************************************
-*    Function: void _freeArgument()
-*  Parameters: struct Argument * arg - A pointer to the argument to be 
-*                                      deallocated.
-* Description: Frees memory allocated for an Argument.
+*    Function: _addWord()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              char *word - The terminated word.
+* Description: Adds a word to the current pipeline stage, either as the
+*              filename of a pending redirect or as an argument.
 *     Returns: None.
 *******************************************************************************/
 
-void _freeArgument(struct Argument *arg) {
-    if(arg) {
-        /* Free the value. */
-        if (arg->value) {
-            free(arg->value);
-            arg->value = NULL;
-        }
-        /* Free the argument itself */
-        free(arg);
+void _addWord(struct LexContext *lex, char *word) {
+    if (lex->pendingRedir == '<') {
+        lex->stage->inRedirFile = word;
+        lex->pendingRedir = 0;
+    } else if (lex->pendingRedir == '>') {
+        lex->stage->outRedirFile = word;
+        lex->pendingRedir = 0;
+    } else {
+        lex->args[lex->numArgs++] = word;
+        lex->stage->numArgs++;
     }
 }
 
 /*******************************************************************************
-*    Function: void freeCommandInfoArgs()
-*  Parameters: struct CommandInfo *ci - A pointer the CommandInfo struct.
-* Description: Deallocates all Arguments in the CommandInfo struct.
+*    Function: _reserveArgs()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              int count - The number of arguments about to be added.
+*              size_t remaining - The number of input characters that follow.
+* Description: Makes room for the matches of a pattern. The argument array
+*              always has a slot for each remaining input character; if the
+*              matches don't fit, the array moves to a bigger one and every
+*              stage's slice of it moves along.
 *     Returns: None.
 *******************************************************************************/
 
-void freeCommandInfoArgs(struct CommandInfo *ci) {
-    int i;
-    if (ci) {
-        /* Iterate through all arguments, deallocating them. */
-        for (i = 0; i < ci->numArgs; i++) {
-            if (ci->args[i]) {
-                _freeArgument(ci->args[i]);
-                ci->args[i] = NULL;
-            }
+void _reserveArgs(struct LexContext *lex, int count, size_t remaining) {
+    size_t needed = lex->numArgs + count + remaining + 2;
+    struct CommandInfo *stage;
+    char **args;
+
+    if (needed <= (size_t) lex->argsCapacity) {
+        return;
+    }
+    args = arenaAlloc(lex->arena, sizeof(char *) * needed * 2);
+    memcpy(args, lex->args, sizeof(char *) * lex->numArgs);
+    for (stage = lex->ci; stage != NULL; stage = stage->next) {
+        stage->args = args + (stage->args - lex->args);
+    }
+    lex->args = args;
+    lex->argsCapacity = needed * 2;
+}
+
+/*******************************************************************************
+*    Function: _addGlobWord()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              char *word - The terminated word, which contains unquoted
+*                           pattern characters.
+*              size_t remaining - The number of input characters that follow.
+* Description: Expands a word into the paths matching it, which are added in
+*              sorted order. The pattern escapes every pattern character that
+*              was quoted, so that only the unquoted ones match. A word that
+*              matches nothing is added as it is. A redirect filename is only
+*              replaced by a single match.
+*     Returns: None.
+*******************************************************************************/
+
+void _addGlobWord(struct LexContext *lex, char *word, size_t remaining) {
+    size_t len = strlen(word), i;
+    char *pattern, *p;
+    char **paths;
+    int count, g = 0;
+
+    if (!lex->isValid) {
+        _addWord(lex, word);
+        return;
+    }
+
+    p = pattern = arenaAlloc(lex->arena, len * 2 + 1);
+    for (i = 0; i < len; i++) {
+        if (g < lex->numGlobs && (size_t) lex->globs[g] == i) {
+            g++;
+        } else if (isGlobChar(word[i]) || word[i] == '\\') {
+            *p++ = '\\';
         }
-        /* Reset the number of arguments. */
-        ci->numArgs = 0;
+        *p++ = word[i];
     }
+    *p = '\0';
+
+    count = expandGlob(pattern, lex->arena, &paths);
+    if (count == 0 || (lex->pendingRedir && count > 1)) {
+        _addWord(lex, word);
+    } else {
+        _reserveArgs(lex, count, remaining);
+        for (g = 0; g < count; g++) {
+            _addWord(lex, paths[g]);
+        }
+    }
+    free(paths);
 }
 
 /*******************************************************************************
-*    Function: _processBuffer()
-*  Parameters: char *inputBuffer - The user input line with var expansions.
-*              struct CommandInfo *ci - The CommandInfo struct.
-* Description: Processes the expanded user input into CommandInfo Arguments.
+*    Function: _endWord()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              char *word - The terminated word.
+*              size_t remaining - The number of words that may still follow.
+* Description: Adds a terminated word, expanding it first if it contains
+*              unquoted pattern characters.
 *     Returns: None.
 *******************************************************************************/
 
-void _processBuffer(char *inputBuffer, struct CommandInfo *ci) {
-    int numArgs = 0;
-    int numChars = 0;
-    int currArgLen = 0;
-    char *c = inputBuffer;
-    char argBuffer[INPUT_BUFFER_LEN+1];
-    memset(argBuffer, '\0', sizeof(argBuffer));
-
-    /* While we haven't processed the full string, the maximum number of
-     * Arguments hasn't been exceeded, and we haven't hit a newline or 
-     * null terminator...
-     */
-    while (numChars <= strlen(inputBuffer) && numArgs < MAX_ARGS &&
-           *c != '\0' && *c != '\n') {
-
-        /* Place nonspace chars into the argument string buffer. */          
-        if (!isspace(*c)) {
-            argBuffer[currArgLen++] = *c;
-        /* If we hit a space char and the previous character was
-         * nonspace, add an argument to the CommandInfo.
-         */
-        } else if (numChars > 0 && !isspace(*(c - 1))) {
-            _addArgument(argBuffer, numArgs, currArgLen, ci);
-            currArgLen = 0;
-            numArgs++;
-            memset(argBuffer, '\0', sizeof(argBuffer));
-        }
-        numChars++;
-        c++;
-    }
-
-    /* Determine if there is a final argument. If so, add it to the
-     * CommandInfo. 
-     */
-    if (numChars > 0 && !isspace(inputBuffer[numChars - 1])
-        && numArgs < MAX_ARGS) {
-        _addArgument(argBuffer, numArgs, currArgLen, ci);
-        numArgs++;
+void _endWord(struct LexContext *lex, char *word, size_t remaining) {
+    if (lex->numGlobs > 0) {
+        _addGlobWord(lex, word, remaining);
+    } else {
+        _addWord(lex, word);
     }
-    /* Set the number of arguments. */
-    ci->numArgs = numArgs;
 }
 
 /*******************************************************************************
-*    Function: _determineForeground()
-*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
-* Description: Determines the foreground state of a CommandInfo struct.
+*    Function: _addOperator()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              char op - The operator character.
+* Description: Handles a redirect, pipe, or background operator. A pipe
+*              terminates the arguments of the current stage and begins a new
+*              stage whose arguments are a slice of the same array.
 *     Returns: None.
 *******************************************************************************/
 
-void _determineForeground(struct CommandInfo *ci) {
-    int boolean;
-    if (ci->numArgs > 0) {
-        /* If the last argument is '&', set the Argument as inactive so that it
-         * can be cleaned up.
-         */
-        boolean = (strcmp(ci->args[ci->numArgs-1]->value, "&") != 0);
-        if (!boolean) {
-            ci->args[ci->numArgs-1]->isActive = 0;
+void _addOperator(struct LexContext *lex, char op) {
+    struct CommandInfo *stage;
+
+    _checkRedirect(lex);
+
+    if (op == '<' || op == '>') {
+        lex->pendingRedir = op;
+    } else if (op == '&') {
+        lex->pendingAmpersand = 1;
+    } else if (op == '|') {
+        if (lex->stage->numArgs == 0) {
+            _rejectEmptyStage(lex);
         }
-        /* Set the foreground status appropriately */
-        ci->isForeground = boolean;
+        lex->args[lex->numArgs++] = NULL;
+
+        stage = arenaAlloc(lex->arena, sizeof(struct CommandInfo));
+        memset(stage, 0, sizeof(struct CommandInfo));
+        stage->args = &lex->args[lex->numArgs];
+        lex->stage->next = stage;
+        lex->stage = stage;
     }
 }
 
 /*******************************************************************************
-*    Function: _determineRedirects()
-*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
-* Description: Determines the input and output redirects of a CommandInfo struct
+*    Function: _listOperator()
+*  Parameters: char *c - An operator character.
+*              char *end - The end of the input.
+*              size_t *opLen - Receives the length of a list operator.
+* Description: Tests whether an operator ends a list element: ';', "&&",
+*              "||", or an '&' that is followed by further commands.
+*     Returns: LIST_SEQ, LIST_AND, or LIST_OR, or LIST_END if the operator
+*              belongs to the current element.
+*******************************************************************************/
+
+int _listOperator(char *c, char *end, size_t *opLen) {
+    char *next = c + 1;
+
+    *opLen = 1;
+    if (*c == ';') {
+        return LIST_SEQ;
+    }
+    if ((*c == '&' || *c == '|') && next < end && *next == *c) {
+        *opLen = 2;
+        return *c == '&' ? LIST_AND : LIST_OR;
+    }
+    if (*c == '&') {
+        while (next < end && (*next == ' ' || *next == '\t')) {
+            next++;
+        }
+        if (next < end && *next != '\n' && *next != '\0') {
+            return LIST_SEQ;
+        }
+    }
+    return LIST_END;
+}
+
+/*******************************************************************************
+*    Function: _isEmptyElement()
+*  Parameters: int hasCommand - Set if the element has a word or a redirect.
+*              int listOp - The list operator that ends the element.
+*              char *next - The character following the operator.
+*              char *end - The end of the input.
+* Description: Tests whether a list element is missing a command: the one
+*              ending at the operator, or, after "&&" or "||", the one that
+*              must follow it on the line. A line with an empty element is
+*              reported, and discarded.
+*     Returns: 1 if an element is missing, 0 otherwise.
+*******************************************************************************/
+
+int _isEmptyElement(int hasCommand, int listOp, char *next, char *end) {
+    while (next < end && (*next == ' ' || *next == '\t')) {
+        next++;
+    }
+    if (hasCommand && ((listOp != LIST_AND && listOp != LIST_OR) ||
+                       (next < end && *next != '\n' && *next != '\0'))) {
+        return 0;
+    }
+    fprintf(stderr, "Warning: List element has no command\n");
+    fflush(stderr);
+    return 1;
+}
+
+/*******************************************************************************
+*    Function: _reserveOutput()
+*  Parameters: struct Arena *arena - The arena of the command.
+*              size_t needed - The number of characters about to be written.
+*              size_t remaining - The number of input characters that follow.
+*              char **out - The output position.
+*              char **word - The start of the word being written.
+*              char **outEnd - The end of the output buffer.
+* Description: Makes room for an expansion of any length. The buffer always
+*              has room for the longest output of the remaining input, except
+*              for expansions; if an expansion doesn't fit, the word being
+*              written moves to a new buffer that has room for both. Earlier
+*              words stay where they are.
 *     Returns: None.
 *******************************************************************************/
 
-void _determineRedirects(struct CommandInfo *ci) {
-    int i;
-    memset(ci->inRedirFile, '\0', sizeof(ci->inRedirFile));
-    memset(ci->outRedirFile, '\0', sizeof(ci->outRedirFile));
-
-    /* Iterate through the arguments array. */
-    for (i = 0; i < ci->numArgs; i++) {
-        /* If we encounter an input redirect, copy the next argument to the
-         * input redirect buffer */
-        if (strcmp(ci->args[i]->value, "<") == 0) {
-            ci->args[i]->isActive = 0;
-            if (i < (ci->numArgs - 1)) {
-                strcpy(ci->inRedirFile, ci->args[i+1]->value);
-                ci->args[i+1]->isActive = 0;
-            /* If there isn't a subsequent argument, print an error. */
-            } else {
-                fprintf(stderr, "Warning: Input redir doesn't specify file\n");
-                fflush(stderr);
+void _reserveOutput(struct Arena *arena, size_t needed, size_t remaining,
+                    char **out, char **word, char **outEnd) {
+    size_t wordLen = *out - *word;
+    size_t size = wordLen + needed + remaining * (PID_LEN / 2) + 2;
+    char *buffer;
+
+    if ((size_t) (*outEnd - *word) >= size) {
+        return;
+    }
+    buffer = arenaAlloc(arena, size);
+    memcpy(buffer, *word, wordLen);
+    *word = buffer;
+    *out = buffer + wordLen;
+    *outEnd = buffer + size;
+}
+
+/*******************************************************************************
+*    Function: _findCommandEnd()
+*  Parameters: char *c - The first character of a command substitution.
+*              char *end - The end of the input.
+* Description: Finds the ')' that closes a command substitution, skipping
+*              nested parentheses, quotes, and escaped characters.
+*     Returns: A pointer to the closing ')', or NULL if there is none.
+*******************************************************************************/
+
+char *_findCommandEnd(char *c, char *end) {
+    int depth = 1;
+    char quote = '\0';
+
+    for (; c < end && *c != '\n' && *c != '\0'; c++) {
+        if (quote == '\'') {
+            if (*c == '\'') {
+                quote = '\0';
             }
-        }
-        /* If we encounter an output redirect, copy the next argument to the
-         * output redirect buffer */
-        if (strcmp(ci->args[i]->value, ">") == 0) {
-            ci->args[i]->isActive = 0;
-            if (i < (ci->numArgs - 1)) {
-                strcpy(ci->outRedirFile, ci->args[i+1]->value);
-                ci->args[i+1]->isActive = 0;
-            /* If there isn't a subsequent argument, print an error. */
-            } else {
-                fprintf(stderr, "Warning: Output redir doesn't specify file\n");
-                fflush(stderr);
+        } else if (*c == '\\' && c + 1 < end) {
+            c++;
+        } else if (quote == '"') {
+            if (*c == '"') {
+                quote = '\0';
             }
+        } else if (*c == '\'' || *c == '"') {
+            quote = *c;
+        } else if (*c == '(') {
+            depth++;
+        } else if (*c == ')' && --depth == 0) {
+            return c;
         }
-    } 
+    }
+    return NULL;
 }
 
 /*******************************************************************************
-*    Function: _filterInactiveArgs()
-*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
-* Description: Filters out inactive arguments from the Arguments array.
-*     Returns: None.
+*    Function: _isAssignmentWord()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              char *word - The start of the word being written.
+*              char *out - The output position.
+* Description: Tests whether the word being written is a variable assignment:
+*              it begins with "NAME=", and every word before it in the
+*              pipeline stage is an assignment too.
+*     Returns: 1 if it is, 0 otherwise.
 *******************************************************************************/
 
-void _filterInactiveArgs(struct CommandInfo *ci) {
+int _isAssignmentWord(struct LexContext *lex, char *word, char *out) {
+    char *equals;
     int i;
-    int newNumArgs = 0;
-    struct Argument *newArgs[MAX_ARGS];
-
-    /* Iterate through the Arguments array. */
-    for (i = 0; i < ci->numArgs; i++) {
-        /* If the argument is active, add it to the new arguments list */
-        if (ci->args[i]->isActive) {
-            newArgs[newNumArgs] = ci->args[i];
-            newNumArgs++;
-        }        
-        /* Otherwise, free the argument. */
-        else {
-            _freeArgument(ci->args[i]);
-            ci->args[i] = NULL;
-        }
-    } 
-    /* Set the new number of arguments. */
-    ci->numArgs = newNumArgs;
-
-    /* Replace the arguments array with the new arguments array. */
-    for (i = 0; i < ci->numArgs; i++) {
-        ci->args[i] = newArgs[i];
+
+    if (lex->pendingRedir ||
+        (equals = memchr(word, '=', out - word)) == NULL ||
+        !isValidName(word, equals - word)) {
+        return 0;
+    }
+    for (i = 0; i < lex->stage->numArgs; i++) {
+        if ((equals = strchr(lex->stage->args[i], '=')) == NULL ||
+            !isValidName(lex->stage->args[i], equals - lex->stage->args[i])) {
+            return 0;
+        }
     }
+    return 1;
+}
+
+/*******************************************************************************
+*    Function: _substituteCommand()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              char *c - The '(' following a '$'.
+*              char *end - The end of the input.
+*              int isQuoted - Set if the substitution is inside double quotes.
+*              char **out - The output position.
+*              char **word - The start of the word being written.
+*              char **outEnd - The end of the output buffer.
+* Description: Replaces "$(command)" with the standard output of the command,
+*              without its trailing newlines. Outside double quotes and
+*              outside the value of an assignment, the output is split into
+*              words at spaces, tabs, and newlines; the first word continues
+*              the current one, and the last one is continued by what
+*              follows. A substitution without a closing ')' is reported, and
+*              the line is discarded.
+*     Returns: The last input character consumed.
+*******************************************************************************/
+
+char *_substituteCommand(struct LexContext *lex, char *c, char *end,
+                         int isQuoted, char **out, char **word,
+                         char **outEnd) {
+    char *last = _findCommandEnd(c + 1, end);
+    char *value, *p, *valueEnd;
+    size_t valueLen, numFields = 0;
+
+    if (last == NULL) {
+        if (lex->isValid) {
+            fprintf(stderr, "Warning: Unterminated command substitution\n");
+            fflush(stderr);
+        }
+        lex->isValid = 0;
+        return c;
+    }
+    if (!lex->isValid) {
+        return last;
+    }
+
+    value = captureCommand(c + 1, last - c - 1, &valueLen);
+    lex->ci->hasSubstitution = 1;
+    while (valueLen > 0 && value[valueLen - 1] == '\n') {
+        valueLen--;
+    }
+    valueEnd = value + valueLen;
+    _reserveOutput(lex->arena, valueLen, end - last, out, word, outEnd);
+
+    if (isQuoted || _isAssignmentWord(lex, *word, *out)) {
+        if (valueLen > 0) {
+            memcpy(*out, value, valueLen);
+            *out += valueLen;
+        }
+        free(value);
+        return last;
+    }
+
+    /* Count the fields, then write each one, ending the word between
+     * them.
+     */
+    for (p = value; p < valueEnd; p++) {
+        if (strchr(" \t\n", *p) == NULL &&
+            (p == value || strchr(" \t\n", p[-1]) != NULL)) {
+            numFields++;
+        }
+    }
+    _reserveArgs(lex, numFields, end - last);
+    for (p = value; p < valueEnd && strchr(" \t\n", *p) != NULL; p++)
+        ;
+    while (p < valueEnd) {
+        while (p < valueEnd && strchr(" \t\n", *p) == NULL) {
+            *(*out)++ = *p++;
+        }
+        while (p < valueEnd && strchr(" \t\n", *p) != NULL) {
+            p++;
+        }
+        if (p < valueEnd) {
+            *(*out)++ = '\0';
+            _endWord(lex, *word, --numFields + (end - last));
+            *word = *out;
+            lex->numGlobs = 0;
+        }
+    }
+    free(value);
+    return last;
+}
+
+/*******************************************************************************
+*    Function: _expandVariable()
+*  Parameters: struct LexContext *lex - The lexer state.
+*              char *c - The character following a '$'.
+*              char *end - The end of the input.
+*              int isQuoted - Set if the '$' is inside double quotes.
+*              char **out - The output position.
+*              char **word - The start of the word being written.
+*              char **outEnd - The end of the output buffer.
+* Description: Expands "$NAME", "${NAME}", "$?", "$!", or "$(command)". A
+*              '$' that begins none of these is kept, with the following
+*              character. A "${"
+*              without a valid name and a closing '}' is reported, and the
+*              line is discarded.
+*     Returns: The last input character consumed.
+*******************************************************************************/
+
+char *_expandVariable(struct LexContext *lex, char *c, char *end,
+                      int isQuoted, char **out, char **word, char **outEnd) {
+    char *name = c, *last, *value;
+    size_t len = 0, valueLen;
+
+    if (*c == '(') {
+        return _substituteCommand(lex, c, end, isQuoted, out, word, outEnd);
+    } else if (*c == '{') {
+        name = c + 1;
+        while (name + len < end && name[len] != '}' && name[len] != '\n' &&
+               name[len] != '\0') {
+            len++;
+        }
+        if (name + len == end || name[len] != '}' ||
+            !(isValidName(name, len) ||
+              (len == 1 && strchr("?!$", name[0]) != NULL))) {
+            if (lex->isValid) {
+                fprintf(stderr, "Warning: Bad substitution\n");
+                fflush(stderr);
+            }
+            lex->isValid = 0;
+            return c;
+        }
+        last = name + len;
+    } else if (*c == '?' || *c == '!') {
+        len = 1;
+        last = c;
+    } else if (isalpha((unsigned char) *c) || *c == '_') {
+        while (name + len < end && (isalnum((unsigned char) name[len]) ||
+                                    name[len] == '_')) {
+            len++;
+        }
+        last = name + len - 1;
+    } else {
+        *(*out)++ = '$';
+        *(*out)++ = *c;
+        return c;
+    }
+
+    value = expandParameter(name, len);
+    valueLen = strlen(value);
+    _reserveOutput(lex->arena, valueLen, end - last, out, word, outEnd);
+    memcpy(*out, value, valueLen);
+    *out += valueLen;
+    return last;
 }
 
 /*******************************************************************************
 *    Function: processInput()
 *  Parameters: char *inputBuffer - The user command line input.
+*              size_t len - The length of the input. The input ends at len,
+*                           at a newline, or at a null terminator, whichever
+*                           comes first, and needn't be terminated.
 *              struct CommandInfo *ci - A pointer to the CommandInfo struct.
-* Description: Performs all input processing tasks necessary to convert a 
-*              user input string into a CommandInfo struct.
-*     Returns: None.
+*              struct Arena *arena - The arena from which the command is
+*                                    allocated. Resetting it releases the
+*                                    whole command.
+* Description: Converts a user input string into a CommandInfo struct in a
+*              single pass of a table-driven state machine. The machine splits
+*              words, removes single quotes, double quotes, and backslash
+*              escapes, expands "$$" into the process ID, other parameters
+*              into their values, and command substitutions into the output
+*              of their commands, expands unquoted patterns into the paths
+*              they match, and recognizes the '<', '>', '|', and '&'
+*              operators as it goes. Words are written with their terminators
+*              into output buffers, and the arguments are slices of them.
+*              Lexing stops after a list operator, which is recorded in
+*              listOp, so that the rest of a list is only expanded once the
+*              commands before it have executed.
+*     Returns: The number of input characters consumed, including the list
+*              operator.
 *******************************************************************************/
 
+size_t processInput(char *inputBuffer, size_t len, struct CommandInfo *ci,
+                    struct Arena *arena) {
+    const struct LexTransition *t;
+    struct LexContext lex;
+    struct CommandInfo *stage;
+    char *c, *out, *outEnd, *word = NULL;
+    char *end = inputBuffer + len;
+    int state = S_BLANK, listOp = LIST_END;
+    unsigned short act;
+    size_t opLen, used;
+
+    memset(ci, 0, sizeof(struct CommandInfo));
+    memset(&lex, 0, sizeof(struct LexContext));
+    lex.ci = ci;
+    lex.stage = ci;
+    lex.arena = arena;
+    lex.isValid = 1;
+
+    /* Write the process ID to string once. */
+    if (PID_STRING_LEN == 0) {
+        PID_STRING_LEN = sprintf(PID_STRING, "%i", getpid());
+    }
+
+    /* No character produces more than two output characters, except that
+     * "$$" produces PID_LEN and other expansions make room for themselves.
+     * Every word or operator consumes at least one character, so the line
+     * can't hold more than len argument slots and stage terminators, except
+     * that patterns make room for their matches.
+     */
+    out = arenaAlloc(arena, len * (PID_LEN / 2) + 2);
+    outEnd = out + len * (PID_LEN / 2) + 2;
+    lex.args = arenaAlloc(arena, sizeof(char *) * (len + 2));
+    lex.argsCapacity = len + 2;
+    ci->args = lex.args;
+
+    for (c = inputBuffer; ; c++) {
+        t = &LEX_TABLE[state][c < end ? CHAR_CLASSES[(unsigned char) *c] :
+                                        C_END];
+        act = t->actions;
 
-void processInput(char *inputBuffer, struct CommandInfo *ci) {
-    char tempBuffer[(INPUT_BUFFER_LEN * 3)+1];
+        if (act & LEX_START) {
+            word = out;
+            lex.numGlobs = 0;
+        }
+        if (act & LEX_DOLLAR) {
+            *out++ = '$';
+        }
+        if (act & LEX_BSLASH) {
+            *out++ = '\\';
+        }
+        if (act & LEX_PID) {
+            memcpy(out, PID_STRING, PID_STRING_LEN);
+            out += PID_STRING_LEN;
+        }
+        if (act & LEX_VAR) {
+            c = _expandVariable(&lex, c, end, state == S_DQ_DOLLAR, &out,
+                                &word, &outEnd);
+        }
+        if (act & LEX_GLOB) {
+            if (lex.globs == NULL) {
+                lex.globs = arenaAlloc(arena, sizeof(int) * len);
+            }
+            lex.globs[lex.numGlobs++] = out - word;
+        }
+        if (act & LEX_APPEND) {
+            *out++ = *c;
+        }
+        if (act & LEX_END) {
+            *out++ = '\0';
+            _endWord(&lex, word, end - c);
+        }
+        if (act & LEX_OP) {
+            if ((listOp = _listOperator(c, end, &opLen)) != LIST_END) {
+                if (lex.isValid &&
+                    _isEmptyElement(ci->numArgs > 0 || ci->next != NULL ||
+                                    ci->inRedirFile != NULL ||
+                                    ci->outRedirFile != NULL ||
+                                    lex.pendingRedir, listOp, c + opLen,
+                                    end)) {
+                    lex.isValid = 0;
+                }
+                if (*c == '&' && opLen == 1) {
+                    _addOperator(&lex, '&');
+                }
+                c += opLen - 1;
+                break;
+            }
+            _addOperator(&lex, *c);
+        }
+        if (act & LEX_ERROR) {
+            if (lex.isValid) {
+                fprintf(stderr, "Warning: Unterminated quote\n");
+                fflush(stderr);
+            }
+            lex.isValid = 0;
+        }
+        if (act & LEX_FINISH) {
+            break;
+        }
+        state = t->next;
+    }
+    used = c < end ? (size_t) (c + 1 - inputBuffer) : len;
+
+    _checkRedirect(&lex);
+    lex.args[lex.numArgs] = NULL;
+    if (ci->next != NULL && lex.stage->numArgs == 0) {
+        _rejectEmptyStage(&lex);
+    }
 
-    /* Expand "$$" instances into process IDs. */
-    _expandVars(inputBuffer, tempBuffer);
-    /* Store arguments into the CommandInfo array. */
-    _processBuffer(tempBuffer, ci);
-    /* Determine the foreground status of the command. */
-    _determineForeground(ci);
-    /* Determine input and output redirects. */
-    _determineRedirects(ci);
-    /* Filter out inactive arguments. */
-    _filterInactiveArgs(ci);
+    /* Discard a line with an empty pipeline stage or list element or an
+     * unterminated quote, along with the rest of its list, with a status of
+     * LEX_ERROR_STATUS.
+     */
+    if (!lex.isValid) {
+        setLastStatus(LEX_ERROR_STATUS);
+        memset(ci, 0, sizeof(struct CommandInfo));
+        ci->args = lex.args;
+        ci->args[0] = NULL;
+        return len;
+    }
+
+    /* Set the foreground status of every stage. */
+    for (stage = ci; stage != NULL; stage = stage->next) {
+        stage->isForeground = !lex.pendingAmpersand;
+    }
+    ci->listOp = listOp;
+    return used;
+}
+
+/*******************************************************************************
+*    Function: skipInput()
+*  Parameters: char *inputBuffer - The user command line input.
+*              size_t len - The length of the input, as for processInput().
+*              int *listOp - Receives the list operator that ends the
+*                            command, or LIST_END.
+* Description: Finds the end of a list element that isn't executed, running
+*              the same state machine as processInput() without writing words
+*              or expanding anything, so that a skipped command substitution
+*              doesn't execute. An empty list element is reported, as by
+*              processInput(), and the rest of the line is discarded with a
+*              status of LEX_ERROR_STATUS.
+*     Returns: The number of input characters consumed, including the list
+*              operator.
+*******************************************************************************/
+
+size_t skipInput(char *inputBuffer, size_t len, int *listOp) {
+    const struct LexTransition *t;
+    char *c, *last, *end = inputBuffer + len;
+    int state = S_BLANK, hasCommand = 0;
+    size_t opLen;
+
+    *listOp = LIST_END;
+    for (c = inputBuffer; ; c++) {
+        t = &LEX_TABLE[state][c < end ? CHAR_CLASSES[(unsigned char) *c] :
+                                        C_END];
+        if (t->actions & LEX_START) {
+            hasCommand = 1;
+        }
+        if ((t->actions & LEX_VAR) && *c == '(' &&
+            (last = _findCommandEnd(c + 1, end)) != NULL) {
+            c = last;
+        }
+        if ((t->actions & LEX_OP) &&
+            (*listOp = _listOperator(c, end, &opLen)) != LIST_END) {
+            if (_isEmptyElement(hasCommand, *listOp, c + opLen, end)) {
+                setLastStatus(LEX_ERROR_STATUS);
+                *listOp = LIST_END;
+                return len;
+            }
+            c += opLen - 1;
+            break;
+        }
+        if (t->actions & LEX_OP) {
+            hasCommand = 1;
+        }
+        if (t->actions & LEX_FINISH) {
+            break;
+        }
+        state = t->next;
+    }
+    return c < end ? (size_t) (c + 1 - inputBuffer) : len;
 }
@@ -16,37 +16,108 @@
 #include <sys/types.h>
 #include <unistd.h>
 
-/* Length of the input buffer in bytes, excluding the null terminator. */
-#define INPUT_BUFFER_LEN 2048 
-/* Maximum number of arguments in a single line of input. */
-#define MAX_ARGS         512
+#include "arena.h"
+#include "glob_cache.h"
+#include "variables.h"
+
 /* Maximum length of a PID string. */
-#define PID_LEN          5
+#define PID_LEN          10
 
-/* A struct to hold an argument. The isActive attribute is used to filter out
- * arguments that will not be passed to exec (such as & and input and output
- * redirection filenames.
+/* Character classes of the lexer. C_OTHER must be 0 so that every character
+ * not listed in the class table is an ordinary word character.
  */
-struct Argument {
-    char *value;
-    int isActive;
+#define C_OTHER          0
+#define C_END            1
+#define C_SPACE          2
+#define C_SQUOTE         3
+#define C_DQUOTE         4
+#define C_BSLASH         5
+#define C_DOLLAR         6
+#define C_OP             7
+#define C_GLOB           8
+#define NUM_CHAR_CLASSES 9
+
+/* States of the lexer. */
+#define S_BLANK          0  /* Between words. */
+#define S_WORD           1  /* In an unquoted part of a word. */
+#define S_SQUOTE         2  /* Inside single quotes. */
+#define S_DQUOTE         3  /* Inside double quotes. */
+#define S_ESCAPE         4  /* After an unquoted backslash. */
+#define S_DQ_ESCAPE      5  /* After a backslash inside double quotes. */
+#define S_DOLLAR         6  /* After an unquoted dollar sign. */
+#define S_DQ_DOLLAR      7  /* After a dollar sign inside double quotes. */
+#define NUM_LEX_STATES   8
+
+/* Actions of a lexer transition. They are performed in the order listed. */
+#define LEX_START        0x01  /* Begin a word. */
+#define LEX_DOLLAR       0x02  /* Append a pending '$'. */
+#define LEX_BSLASH       0x04  /* Append a pending '\'. */
+#define LEX_PID          0x08  /* Append the shell's process ID. */
+#define LEX_APPEND       0x10  /* Append the current character. */
+#define LEX_END          0x20  /* Terminate the word. */
+#define LEX_OP           0x40  /* Handle the character as an operator. */
+#define LEX_ERROR        0x80  /* Report an unterminated quote. */
+#define LEX_FINISH       0x100 /* Stop lexing. */
+#define LEX_VAR          0x200 /* Expand the parameter beginning here. */
+#define LEX_GLOB         0x400 /* Record an unquoted pattern character. */
+
+/* Status of a line discarded for a syntax error. */
+#define LEX_ERROR_STATUS 2
+
+/* Operators that end an element of a command list. */
+#define LIST_END         0  /* The element ends the list. */
+#define LIST_SEQ         1  /* ';' or '&': the next element always executes. */
+#define LIST_AND         2  /* "&&": the next element executes on status 0. */
+#define LIST_OR          3  /* "||": the next element executes otherwise. */
+
+/* A struct to hold one entry of the lexer transition table. */
+struct LexTransition {
+    unsigned short actions;
+    unsigned char  next;
 };
 
 /* A struct to hold all information in a line of user input. Once processInput()
  * has completed, this struct holds the arguments to be passed to exec() (or to
- * a builtin), the number of arguments that meet these criteria, the foreground
- * status of the command, and the filenames of input and output redirection 
- * files.
+ * a builtin) as a NULL-terminated array, the number of arguments that meet
+ * these criteria, the foreground status of the command, and the filenames of
+ * input and output redirection files (NULL if not redirected). A pipeline is
+ * held as a list of these structs, one per stage, linked through next. Every
+ * stage carries the foreground status of the pipeline. All strings are
+ * slices of one expanded copy of the line, and everything is allocated from
+ * the Arena passed to processInput(). A line may hold a list of pipelines;
+ * the first stage holds the list operator that follows the pipeline, and
+ * whether a command substitution was expanded anywhere in it.
  */
 struct CommandInfo {
-    struct Argument *args[MAX_ARGS];
+    char **args;
     int   numArgs;
     int   isForeground;
-    char inRedirFile[INPUT_BUFFER_LEN+1];
-    char outRedirFile[INPUT_BUFFER_LEN+1];
+    char *inRedirFile;
+    char *outRedirFile;
+    int   listOp;
+    int   hasSubstitution;
+    struct CommandInfo *next;
+};
+
+/* A struct to hold the state of the lexer while it assembles the words and
+ * operators of a line into a CommandInfo struct. globs holds the offsets of
+ * the unquoted pattern characters of the current word.
+ */
+struct LexContext {
+    struct CommandInfo *ci;
+    struct CommandInfo *stage;
+    struct Arena *arena;
+    char **args;
+    int   numArgs;
+    int   argsCapacity;
+    int  *globs;
+    int   numGlobs;
+    int   pendingRedir;
+    int   pendingAmpersand;
+    int   isValid;
 };
 
-void processInput(char *, struct CommandInfo *);
-void freeCommandInfoArgs(struct CommandInfo *);
+size_t processInput(char *, size_t, struct CommandInfo *, struct Arena *);
+size_t skipInput(char *, size_t, int *);
 
 #endif
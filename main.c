@@ -7,30 +7,80 @@
 
 #include "builtins.h"
 #include "input.h"
+#include "reader.h"
+#include "script.h"
 #include "signal_proc.h"
 
 /* Command line output string */
 #define CL_PROMPT ":"
 
-/* Global foreground-only mode flag switch. */
-int FOREGROUND_FLAG = 0;
-
 /*******************************************************************************
 *    Function: main()
-*  Parameters: Main function parameters.
-* Description: Performs initialization actions and the main shell loop.
-*     Returns: Exit status.
+*  Parameters: Main function parameters. With no arguments, commands are read
+*              interactively from standard input. "-c string" executes the
+*              commands in the string, and any other argument is the path of a
+*              script file to be executed. The shell runs itself with
+*              FORK_SERVER_FLAG to start the fork server.
+* Description: Performs initialization actions and the main shell loop. When
+*              executing a string or script, no prompt is displayed.
+*     Returns: Exit status: the status given to exit, or else the status of
+*              the last foreground process.
 *******************************************************************************/
 
 int main(int argc, char * argv[]) {
     int exitFlag = 0;
-    char inputBuffer[INPUT_BUFFER_LEN+1];   
-    struct CommandInfo command = {0};
+    int isInteractive = 1;
+    size_t lineLen;
+    char *inputLine;
+    struct LineReader reader;
     struct ForegroundStatus fs = {0};
     struct BackgroundProcesses bp = {0};
+    struct Arena arena = {0};
+    struct ScriptContext script = {&reader, 0, &fs, &bp};
+    struct timespec phaseStart;
+    char *spawnMode;
+
+    /* Run as the fork server if started as one. */
+    if (argc > 1 && strcmp(argv[1], FORK_SERVER_FLAG) == 0) {
+        return runForkServer();
+    }
 
-    /* Register signal handlers */
+    /* Register signal handlers and start receiving SIGCHLD through the
+     * reaper's signalfd.
+     */
     registerParentHandlers();
+    initReaper();
+    initEventLoop(0, REAPER_FD);
+    initShellStats();
+    initVariables();
+
+    /* Select the spawn engine named in the environment, if any. */
+    if ((spawnMode = getenv(SPAWN_MODE_ENV)) != NULL &&
+        selectSpawnMode(spawnMode) == -1) {
+        fprintf(stderr, "Warning: Can't select spawn engine %s\n", spawnMode);
+        fflush(stderr);
+    }
+
+    /* Read the commands through a line reader. A script file is mapped into
+     * memory, and a string is read in place.
+     */
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: %s [-c string | script]\n", argv[0]);
+            return 2;
+        }
+        initLineReaderFromBuffer(&reader, argv[2], strlen(argv[2]));
+        isInteractive = 0;
+    } else if (argc > 1) {
+        if (openLineReaderFile(&reader, argv[1]) == -1) {
+            perror(argv[1]);
+            return 127;
+        }
+        isInteractive = 0;
+    } else {
+        initLineReader(&reader, 0);
+        SHELL_INPUT = &reader;
+    }
 
     /* Initialize ForegroundStatus and Background Processes structs */
     initBackgroundProcesses(&bp);
@@ -38,48 +88,52 @@ int main(int argc, char * argv[]) {
 
     while (!exitFlag) {
         /* Reap background processes immediately prior to user input. */
-        backgroundCleanup(&bp);
+        if (bp.size > 0) {
+            backgroundCleanup(&bp);
+        }
 
-        /* Display prompt and fflush */
-        printf("%s ", CL_PROMPT);
-        fflush(stdout);
+        if (isInteractive) {
+            /* Display prompt and fflush */
+            printf("%s ", CL_PROMPT);
+            fflush(stdout);
 
-        /* Take in user input */
-        memset(inputBuffer, '\0', sizeof(inputBuffer));
-        fgets(inputBuffer, INPUT_BUFFER_LEN+1, stdin);
+            /* Unless a line is already buffered, wait for user input,
+             * announcing background processes that finish in the meantime.
+             * If a signal interrupts the wait, prompt again.
+             */
+            if (!hasBufferedLine(&reader) &&
+                waitForInput(&reader, &bp, CL_PROMPT) == -1) {
+                continue;
+            }
+        }
 
-        /* Process user input into command struct */
-        processInput(inputBuffer, &command);
-        /* If the foreground-only mode flag is set, override whatever
-         * foreground status is set so that the command is in the
-         * foreground.
-         */
-        if (FOREGROUND_FLAG) {
-            command.isForeground = 1;
-        }        
-
-
-        /* Case: No arguments */
-        if (command.numArgs <= 0) {
-            /* Do nothing... */
-        /* Case: Comment string */
-        } else if (command.args[0]->value[0] == '#') {
-            /* Do nothing... */
-        /* Case: Builtin function call */
-        } else if (isBuiltIn(command.args[0]->value)) {
-            handleBuiltIn(&command, &fs, &bp);
-            if (command.numArgs > 0 && strcmp(command.args[0]->value,
-                                              "exit") == 0) {
-                exitFlag = 1;
+        /* Take in user input. At EOF, clean up as exit would. */
+        STATS_START(phaseStart);
+        if ((inputLine = readLine(&reader, &lineLen)) == NULL) {
+            if (errno == EINTR) {
+                continue;
             }
-        /* Case: Non-builtin function call */
-        } else {
-            handleNonBuiltIn(&command, &fs, &bp);
+            executeExit(NULL, &fs, &bp);
+            break;
         }
+        STATS_RECORD(STATS_READ, phaseStart);
 
-        /* Free allocated memory for the next loop. */
-        freeCommandInfoArgs(&command);
+        /* A line with a compound command is parsed, with any further lines
+         * it takes, and executed as a whole.
+         */
+        if (hasCompoundCommand(inputLine, lineLen)) {
+            script.isInteractive = isInteractive;
+            exitFlag = executeCompound(inputLine, lineLen, LIST_SEQ, &script);
+            continue;
+        }
+
+        /* Process the line and execute it, one pipeline of a list at a
+         * time, noting whether it ends the shell.
+         */
+        exitFlag = executeLine(inputLine, lineLen, LIST_SEQ, &fs, &bp, &arena);
     }
-    
-    return 0;
+
+    /* The exit builtin sets the status the shell exits with. */
+    freeLineReader(&reader);
+    return exitFlag ? LAST_STATUS : exitCode(&fs);
 }
@@ -0,0 +1,388 @@
+/*******************************************************************************
+*      Filename: parallel.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the parallel builtin, which runs a command template
+*                once per item while keeping a fixed number of jobs in flight.
+*                Jobs are launched through the same path as non-builtin
+*                commands, and their termination is observed through pidfds so
+*                that a slot is refilled as soon as its job finishes.
+*******************************************************************************/
+
+#include "parallel.h"
+
+/* The line reader of the shell's commands, set by main() when it reads them
+ * from standard input.
+ */
+struct LineReader *SHELL_INPUT = NULL;
+
+/*******************************************************************************
+*    Function: _substitute()
+*  Parameters: char *word - A word of the command template.
+*              char *item - The item to be substituted.
+*              int *isReplaced - Set if the word contains the placeholder.
+* Description: Replaces every placeholder in a word with the item.
+*     Returns: The allocated word.
+*******************************************************************************/
+
+char *_substitute(char *word, char *item, int *isReplaced) {
+    size_t placeholderLen = strlen(PARALLEL_PLACEHOLDER);
+    size_t itemLen = strlen(item);
+    size_t count = 0;
+    char *p, *result, *out;
+
+    for (p = word; (p = strstr(p, PARALLEL_PLACEHOLDER)) != NULL;
+         p += placeholderLen) {
+        count++;
+    }
+    if (count == 0) {
+        return strdup(word);
+    }
+    *isReplaced = 1;
+
+    result = malloc(strlen(word) + count * itemLen + 1);
+    if (result == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (out = result; (p = strstr(word, PARALLEL_PLACEHOLDER)) != NULL;
+         word = p + placeholderLen) {
+        memcpy(out, word, p - word);
+        out += p - word;
+        memcpy(out, item, itemLen);
+        out += itemLen;
+    }
+    strcpy(out, word);
+    return result;
+}
+
+/*******************************************************************************
+*    Function: _buildArgs()
+*  Parameters: struct ParallelRun *run - The parallel run.
+*              char *item - The item of the job.
+*              int *numArgs - Receives the number of arguments.
+* Description: Builds the argument list of a job from the command template. If
+*              no word contains the placeholder, the item is appended as the
+*              last argument.
+*     Returns: The allocated, NULL-terminated argument list.
+*******************************************************************************/
+
+char **_buildArgs(struct ParallelRun *run, char *item, int *numArgs) {
+    char **argv = malloc((run->templateLen + 2) * sizeof(char *));
+    int i, isReplaced = 0;
+
+    if (argv == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < run->templateLen; i++) {
+        argv[i] = _substitute(run->template[i], item, &isReplaced);
+    }
+    if (!isReplaced) {
+        argv[i++] = strdup(item);
+    }
+    argv[i] = NULL;
+    *numArgs = i;
+    return argv;
+}
+
+/*******************************************************************************
+*    Function: _nextItem()
+*  Parameters: struct ParallelRun *run - The parallel run.
+* Description: Takes the next item from the command line or standard input.
+*     Returns: The allocated item, or NULL if there are no more items.
+*******************************************************************************/
+
+char *_nextItem(struct ParallelRun *run) {
+    char *line;
+    size_t len;
+
+    if (run->numItems >= 0) {
+        if (run->nextItem == run->numItems) {
+            return NULL;
+        }
+        return strdup(run->items[run->nextItem++]);
+    }
+
+    do {
+        line = readLine(run->reader, &len);
+    } while (line == NULL && errno == EINTR);
+    return line ? strndup(line, len) : NULL;
+}
+
+/*******************************************************************************
+*    Function: _freeJob()
+*  Parameters: struct ParallelJob *job - The job slot.
+* Description: Releases the item and arguments of a job and frees its slot.
+*     Returns: None.
+*******************************************************************************/
+
+void _freeJob(struct ParallelJob *job) {
+    int i;
+
+    for (i = 0; job->argv[i] != NULL; i++) {
+        free(job->argv[i]);
+    }
+    free(job->argv);
+    free(job->item);
+    job->argv = NULL;
+    job->item = NULL;
+    job->pid = -1;
+    job->pidfd = -1;
+}
+
+/*******************************************************************************
+*    Function: _startJob()
+*  Parameters: struct ParallelRun *run - The parallel run.
+*              struct ParallelJob *job - A free job slot.
+*              char *item - The allocated item, which the slot takes over.
+* Description: Launches the command for an item in the foreground, as a
+*              non-builtin command would be. If the items are read from
+*              standard input, the job's input is /dev/null so that it can't
+*              consume them. A job that can't be started counts as failed.
+*     Returns: None.
+*******************************************************************************/
+
+void _startJob(struct ParallelRun *run, struct ParallelJob *job, char *item) {
+    struct CommandInfo ci = {0};
+
+    job->item = item;
+    job->argv = _buildArgs(run, item, &ci.numArgs);
+    ci.args = job->argv;
+    ci.isForeground = 1;
+    if (run->numItems < 0) {
+        ci.inRedirFile = "/dev/null";
+    }
+
+    if ((job->pid = startStage(&ci, -1, -1, NULL, -1, -1, NULL, NULL)) == -1) {
+        run->numFailed++;
+        _freeJob(job);
+        return;
+    }
+    job->pidfd = pidfd_open(job->pid, 0);
+    run->numRunning++;
+}
+
+/*******************************************************************************
+*    Function: _finishJob()
+*  Parameters: struct ParallelRun *run - The parallel run.
+*              struct ParallelJob *job - The slot of a terminated job.
+* Description: Collects the exit status of a job, reports it if the job
+*              failed, and frees the slot.
+*     Returns: None.
+*******************************************************************************/
+
+void _finishJob(struct ParallelRun *run, struct ParallelJob *job) {
+    struct ForegroundStatus status;
+
+    initForegroundStatus(&status);
+    if (waitChild(job->pid, 0, &status) == -1) {
+        perror("waitpid");
+        status.statusNum = 1;
+    }
+
+    if (status.isSignal || status.statusNum != 0) {
+        run->numFailed++;
+        fprintf(stderr, "parallel: %s: %s %d\n", job->item,
+                status.isSignal ? "terminated by signal" : "exit value",
+                status.statusNum);
+        fflush(stderr);
+    }
+
+    if (job->pidfd != -1) {
+        close(job->pidfd);
+    }
+    _freeJob(job);
+    run->numRunning--;
+}
+
+/*******************************************************************************
+*    Function: _interruptJobs()
+*  Parameters: struct ParallelRun *run - The parallel run.
+* Description: Stops the run once the shell has received SIGINT: no further
+*              jobs are started, and SIGINT is passed on to the running jobs,
+*              which may not have received it themselves.
+*     Returns: None.
+*******************************************************************************/
+
+void _interruptJobs(struct ParallelRun *run) {
+    int i;
+
+    if (!INTERRUPT_FLAG || run->isInterrupted) {
+        return;
+    }
+    run->isInterrupted = 1;
+    for (i = 0; i < run->numSlots; i++) {
+        if (run->slots[i].pid != -1) {
+            kill(run->slots[i].pid, SIGINT);
+        }
+    }
+}
+
+/*******************************************************************************
+*    Function: _waitForJobs()
+*  Parameters: struct ParallelRun *run - The parallel run, with at least one
+*                                        job running.
+* Description: Waits until at least one job terminates and collects every job
+*              that has. As in handleNonBuiltIn(), SIGTSTP is blocked during
+*              the wait; SIGINT ends it, and stops the run. A job without a
+*              pidfd is waited for directly.
+*     Returns: None.
+*******************************************************************************/
+
+void _waitForJobs(struct ParallelRun *run) {
+    struct pollfd fds[run->numSlots];
+    int slotOf[run->numSlots];
+    int i, numFDs = 0;
+    sigset_t mask;
+
+    for (i = 0; i < run->numSlots; i++) {
+        if (run->slots[i].pid == -1) {
+            continue;
+        }
+        if (run->slots[i].pidfd == -1) {
+            _finishJob(run, &run->slots[i]);
+            return;
+        }
+        fds[numFDs].fd = run->slots[i].pidfd;
+        fds[numFDs].events = POLLIN;
+        slotOf[numFDs++] = i;
+    }
+
+    sigprocmask(SIG_SETMASK, NULL, &mask);
+    sigaddset(&mask, SIGTSTP);
+    while (ppoll(fds, numFDs, NULL, &mask) == -1) {
+        if (errno != EINTR) {
+            perror("ppoll");
+            _finishJob(run, &run->slots[slotOf[0]]);
+            return;
+        }
+        _interruptJobs(run);
+    }
+    _interruptJobs(run);
+
+    for (i = 0; i < numFDs; i++) {
+        if (fds[i].revents != 0) {
+            _finishJob(run, &run->slots[slotOf[i]]);
+        }
+    }
+}
+
+/*******************************************************************************
+*    Function: executeParallel()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the parallel builtin command:
+*                  parallel [-j N] command [argument ...] [::: item ...]
+*              The command is run once per item, with the item replacing each
+*              {} in the arguments (or appended if there is none). Without
+*              ":::", the items are the lines of standard input, which are
+*              taken from the shell's own reader if the shell reads its
+*              commands from there and the input isn't redirected; lines it
+*              has already buffered are items too. At most N jobs
+*              run at once, N defaulting to the number of online CPUs, and a
+*              new job starts as soon as one finishes. SIGINT stops the run:
+*              the running jobs are waited for, and no more are started.
+*     Returns: The number of failed jobs, at most PARALLEL_MAX_STATUS,
+*              PARALLEL_INTERRUPTED_STATUS if SIGINT stopped the run, or
+*              PARALLEL_ERROR_STATUS on a usage error.
+*******************************************************************************/
+
+int executeParallel(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                    struct BackgroundProcesses *bp) {
+    struct ParallelRun run = {0};
+    long numJobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 1, isDone = 0;
+    char *value, *end, *item;
+
+    /* Parse the job count, given as "-j N" or "-jN". */
+    if (i < ci->numArgs && strncmp(ci->args[i], "-j", 2) == 0) {
+        value = ci->args[i][2] != '\0' ? ci->args[i] + 2 : ci->args[++i];
+        if (value == NULL || (numJobs = strtol(value, &end, 10)) < 1 ||
+            *end != '\0') {
+            fprintf(stderr, "parallel: invalid job count\n");
+            fflush(stderr);
+            return PARALLEL_ERROR_STATUS;
+        }
+        i++;
+    }
+    if (numJobs < 1) {
+        numJobs = 1;
+    }
+
+    /* Split the command template from the items. */
+    run.template = &ci->args[i];
+    while (i < ci->numArgs && strcmp(ci->args[i], PARALLEL_SEPARATOR) != 0) {
+        i++;
+    }
+    run.templateLen = &ci->args[i] - run.template;
+    if (run.templateLen == 0) {
+        fprintf(stderr, "Usage: parallel [-j N] command [argument ...] "
+                "[::: item ...]\n");
+        fflush(stderr);
+        return PARALLEL_ERROR_STATUS;
+    }
+    if (i < ci->numArgs) {
+        run.items = &ci->args[i + 1];
+        run.numItems = ci->numArgs - i - 1;
+    } else {
+        run.numItems = -1;
+        if (SHELL_INPUT != NULL && ci->inRedirFile == NULL) {
+            run.reader = SHELL_INPUT;
+        } else {
+            initLineReader(&run.stdinReader, 0);
+            run.reader = &run.stdinReader;
+        }
+    }
+
+    run.numSlots = numJobs;
+    run.slots = malloc(run.numSlots * sizeof(struct ParallelJob));
+    if (run.slots == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < run.numSlots; i++) {
+        run.slots[i].pid = -1;
+        run.slots[i].pidfd = -1;
+    }
+
+    /* Fill every free slot, then wait for a job to finish, until both the
+     * items and the jobs are exhausted. A SIGINT received before the run
+     * started is disregarded.
+     */
+    INTERRUPT_FLAG = 0;
+    while (1) {
+        isDone |= run.isInterrupted;
+        for (i = 0; i < run.numSlots && !isDone; i++) {
+            if (run.slots[i].pid != -1) {
+                continue;
+            }
+            if ((item = _nextItem(&run)) == NULL) {
+                isDone = 1;
+            } else {
+                _startJob(&run, &run.slots[i], item);
+            }
+        }
+        if (run.numRunning == 0) {
+            if (isDone) {
+                break;
+            }
+            continue;
+        }
+        _waitForJobs(&run);
+    }
+
+    free(run.slots);
+    if (run.reader == &run.stdinReader) {
+        freeLineReader(&run.stdinReader);
+    } else if (run.reader != NULL && isatty(0)) {
+        /* The end of the items typed at a terminal doesn't end the shell. */
+        run.reader->isEOF = 0;
+    }
+    if (run.isInterrupted) {
+        return PARALLEL_INTERRUPTED_STATUS;
+    }
+    return run.numFailed < PARALLEL_MAX_STATUS ? run.numFailed :
+                                                 PARALLEL_MAX_STATUS;
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************
+*      Filename: parallel.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for parallel.c. See parallel.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/pidfd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "reader.h"
+#include "signal_proc.h"
+
+/* Separates the command template from the items on the command line. */
+#define PARALLEL_SEPARATOR    ":::"
+/* Replaced by the item in each word of the command template. */
+#define PARALLEL_PLACEHOLDER  "{}"
+/* Maximum exit status, which counts the failed jobs. */
+#define PARALLEL_MAX_STATUS   101
+/* Exit status on a usage error. */
+#define PARALLEL_ERROR_STATUS 255
+/* Exit status when SIGINT stops the run. */
+#define PARALLEL_INTERRUPTED_STATUS (128 + SIGINT)
+
+/* The line reader of the shell's commands, if they are read from standard
+ * input, or NULL. Items read from standard input are taken from it, since it
+ * may already hold them.
+ */
+extern struct LineReader *SHELL_INPUT;
+
+/* A struct to hold a job slot. A pid of -1 marks a free slot. The pidfd
+ * becomes readable when the job terminates, or is -1 if the kernel doesn't
+ * provide pidfds.
+ */
+struct ParallelJob {
+    pid_t  pid;
+    int    pidfd;
+    char  *item;
+    char **argv;
+};
+
+/* A struct to hold the state of a parallel builtin invocation. Items come from
+ * the command line if numItems is non-negative, and from standard input
+ * otherwise, through reader: either SHELL_INPUT or stdinReader. isInterrupted
+ * is set once SIGINT has stopped the run.
+ */
+struct ParallelRun {
+    char             **template;
+    int                templateLen;
+    char             **items;
+    int                numItems;
+    int                nextItem;
+    struct LineReader *reader;
+    struct LineReader  stdinReader;
+    struct ParallelJob *slots;
+    int                numSlots;
+    int                numRunning;
+    int                numFailed;
+    int                isInterrupted;
+};
+
+int executeParallel(struct CommandInfo *, struct ForegroundStatus *,
+                    struct BackgroundProcesses *);
+
+#endif
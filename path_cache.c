@@ -0,0 +1,327 @@
+/*******************************************************************************
+*      Filename: path_cache.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains a cache of resolved command paths, so that PATH is
+*                searched once per command name rather than once per command
+*                execution. The cache holds negative entries for commands
+*                that were not found and is discarded when PATH changes.
+*******************************************************************************/
+
+#include "path_cache.h"
+
+/* Global path cache. */
+struct PathCache PATH_CACHE = {0};
+
+/* Holds a path resolved against a relative PATH directory. Such paths depend
+ * on the working directory, so they are never placed in the cache.
+ */
+char PATH_CACHE_SCRATCH[PATH_MAX];
+
+/*******************************************************************************
+*    Function: _hashName()
+*  Parameters: char *name - The command name.
+* Description: Computes the FNV-1a hash of a command name.
+*     Returns: The hash value.
+*******************************************************************************/
+
+unsigned int _hashName(char *name) {
+    unsigned int hash = 2166136261u;
+
+    while (*name != '\0') {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*******************************************************************************
+*    Function: _findEntry()
+*  Parameters: char *name - The command name.
+* Description: Finds the bucket of a command name with linear probing.
+*     Returns: The bucket index holding the name, or the index of the empty
+*              bucket where it would be inserted.
+*******************************************************************************/
+
+int _findEntry(char *name) {
+    int mask = PATH_CACHE.capacity - 1;
+    int i = _hashName(name) & mask;
+
+    while (PATH_CACHE.buckets[i].name != NULL &&
+           strcmp(PATH_CACHE.buckets[i].name, name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*******************************************************************************
+*    Function: _removeEntry()
+*  Parameters: int i - The bucket index of the entry to be removed.
+* Description: Frees an entry and shifts the following entries of its probe
+*              sequence back so that no tombstones are needed.
+*     Returns: None.
+*******************************************************************************/
+
+void _removeEntry(int i) {
+    int mask = PATH_CACHE.capacity - 1;
+    int j = i;
+    int home;
+
+    free(PATH_CACHE.buckets[i].name);
+    free(PATH_CACHE.buckets[i].path);
+    PATH_CACHE.size--;
+
+    /* Move each later entry whose home bucket doesn't lie cyclically in
+     * (i, j] into the hole.
+     */
+    while (1) {
+        j = (j + 1) & mask;
+        if (PATH_CACHE.buckets[j].name == NULL) {
+            break;
+        }
+        home = _hashName(PATH_CACHE.buckets[j].name) & mask;
+        if ((j > i && (home <= i || home > j)) ||
+            (j < i && (home <= i && home > j))) {
+            PATH_CACHE.buckets[i] = PATH_CACHE.buckets[j];
+            i = j;
+        }
+    }
+    memset(&PATH_CACHE.buckets[i], 0, sizeof(struct PathEntry));
+}
+
+/*******************************************************************************
+*    Function: _growCache()
+*  Parameters: None.
+* Description: Allocates the bucket array, or doubles it and rehashes all
+*              entries once the load factor would exceed 0.7.
+*     Returns: None.
+*******************************************************************************/
+
+void _growCache() {
+    struct PathEntry *old = PATH_CACHE.buckets;
+    int oldCapacity = PATH_CACHE.capacity;
+    int i;
+
+    if (old != NULL && (PATH_CACHE.size + 1) * 10 <= oldCapacity * 7) {
+        return;
+    }
+
+    PATH_CACHE.capacity = old ? oldCapacity * 2 : PATH_CACHE_INIT_SIZE;
+    PATH_CACHE.buckets = calloc(PATH_CACHE.capacity, sizeof(struct PathEntry));
+    if (PATH_CACHE.buckets == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i].name != NULL) {
+            PATH_CACHE.buckets[_findEntry(old[i].name)] = old[i];
+        }
+    }
+    free(old);
+}
+
+/*******************************************************************************
+*    Function: _checkPathValue()
+*  Parameters: None.
+* Description: Discards the cache if PATH has changed since the entries were
+*              resolved.
+*     Returns: None.
+*******************************************************************************/
+
+void _checkPathValue() {
+    char *pathValue = getenv("PATH");
+
+    /* execvp() searches a default path when PATH is unset; do the same. */
+    if (pathValue == NULL) {
+        pathValue = "/bin:/usr/bin";
+    }
+    if (PATH_CACHE.pathValue == NULL ||
+        strcmp(PATH_CACHE.pathValue, pathValue) != 0) {
+        clearPathCache();
+        PATH_CACHE.pathValue = strdup(pathValue);
+    }
+}
+
+/*******************************************************************************
+*    Function: _searchPath()
+*  Parameters: char *name - The command name.
+*              int *isRelative - Set if the command was found in a relative
+*                                PATH directory.
+* Description: Searches each PATH directory in order for an executable regular
+*              file with the given name.
+*     Returns: The path of the command in PATH_CACHE_SCRATCH, or NULL if it
+*              wasn't found.
+*******************************************************************************/
+
+char *_searchPath(char *name, int *isRelative) {
+    char *dir = PATH_CACHE.pathValue;
+    char *end;
+    int dirLen;
+    struct stat info;
+
+    while (dir != NULL) {
+        end = strchr(dir, ':');
+        dirLen = end ? end - dir : strlen(dir);
+
+        /* An empty PATH directory denotes the working directory. */
+        if (dirLen == 0) {
+            snprintf(PATH_CACHE_SCRATCH, PATH_MAX, "%s", name);
+        } else {
+            snprintf(PATH_CACHE_SCRATCH, PATH_MAX, "%.*s/%s", dirLen, dir,
+                     name);
+        }
+        if (stat(PATH_CACHE_SCRATCH, &info) == 0 && S_ISREG(info.st_mode) &&
+            access(PATH_CACHE_SCRATCH, X_OK) == 0) {
+            *isRelative = (PATH_CACHE_SCRATCH[0] != '/');
+            return PATH_CACHE_SCRATCH;
+        }
+        dir = end ? end + 1 : NULL;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+*    Function: lookupPath()
+*  Parameters: char *name - The command name.
+* Description: Resolves a command name to the path that execvp() would use,
+*              consulting the cache first. Names containing a slash are
+*              returned unchanged. Results, including "not found", are cached.
+*     Returns: The path of the command, or NULL with errno set to ENOENT if it
+*              wasn't found. The path remains valid until the cache changes.
+*******************************************************************************/
+
+char *lookupPath(char *name) {
+    struct PathEntry *entry;
+    char *path;
+    int i, isRelative = 0;
+
+    if (strchr(name, '/') != NULL) {
+        return name;
+    }
+
+    _checkPathValue();
+    _growCache();
+
+    /* Return a cached result if there is one. Expired negative entries are
+     * discarded so that PATH is searched again.
+     */
+    i = _findEntry(name);
+    entry = &PATH_CACHE.buckets[i];
+    if (entry->name != NULL) {
+        if (entry->path != NULL) {
+            entry->hits++;
+            return entry->path;
+        }
+        if (time(NULL) < entry->expires) {
+            errno = ENOENT;
+            return NULL;
+        }
+        _removeEntry(i);
+        i = _findEntry(name);
+        entry = &PATH_CACHE.buckets[i];
+    }
+
+    /* Search PATH and cache the result. */
+    path = _searchPath(name, &isRelative);
+    if (isRelative) {
+        return path;
+    }
+    entry->name = strdup(name);
+    entry->path = path ? strdup(path) : NULL;
+    entry->hits = path ? 1 : 0;
+    entry->expires = time(NULL) + PATH_CACHE_NEG_TTL;
+    PATH_CACHE.size++;
+
+    if (path == NULL) {
+        errno = ENOENT;
+    }
+    return entry->path;
+}
+
+/*******************************************************************************
+*    Function: hashPath()
+*  Parameters: char *name - The command name.
+* Description: Searches PATH for a command name and replaces its cache entry,
+*              without counting a hit.
+*     Returns: The path of the command, or NULL if it wasn't found.
+*******************************************************************************/
+
+char *hashPath(char *name) {
+    char *path;
+
+    invalidatePath(name);
+    path = lookupPath(name);
+    if (path != NULL && strchr(name, '/') == NULL) {
+        PATH_CACHE.buckets[_findEntry(name)].hits = 0;
+    }
+    return path;
+}
+
+/*******************************************************************************
+*    Function: invalidatePath()
+*  Parameters: char *name - The command name.
+* Description: Removes a command name from the cache. This is used when a
+*              cached path fails to execute.
+*     Returns: None.
+*******************************************************************************/
+
+void invalidatePath(char *name) {
+    int i;
+
+    if (PATH_CACHE.buckets == NULL) {
+        return;
+    }
+    i = _findEntry(name);
+    if (PATH_CACHE.buckets[i].name != NULL) {
+        _removeEntry(i);
+    }
+}
+
+/*******************************************************************************
+*    Function: clearPathCache()
+*  Parameters: None.
+* Description: Removes every entry from the cache.
+*     Returns: None.
+*******************************************************************************/
+
+void clearPathCache() {
+    int i;
+
+    for (i = 0; i < PATH_CACHE.capacity; i++) {
+        free(PATH_CACHE.buckets[i].name);
+        free(PATH_CACHE.buckets[i].path);
+    }
+    free(PATH_CACHE.buckets);
+    free(PATH_CACHE.pathValue);
+    memset(&PATH_CACHE, 0, sizeof(PATH_CACHE));
+}
+
+/*******************************************************************************
+*    Function: printPathCache()
+*  Parameters: FILE *out - The stream to print to.
+* Description: Prints the hit count and path of every cached command. Negative
+*              entries are listed as not found.
+*     Returns: None.
+*******************************************************************************/
+
+void printPathCache(FILE *out) {
+    struct PathEntry *entry;
+    int i;
+
+    if (PATH_CACHE.size == 0) {
+        fprintf(out, "hash: hash table empty\n");
+        return;
+    }
+    fprintf(out, "hits\tcommand\n");
+    for (i = 0; i < PATH_CACHE.capacity; i++) {
+        entry = &PATH_CACHE.buckets[i];
+        if (entry->name == NULL) {
+            continue;
+        }
+        if (entry->path != NULL) {
+            fprintf(out, "%4d\t%s\n", entry->hits, entry->path);
+        } else {
+            fprintf(out, "%4d\t%s (not found)\n", entry->hits, entry->name);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+*      Filename: path_cache.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for path_cache.c. See path_cache.c for
+*                function descriptions.
+*******************************************************************************/
+
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Initial number of buckets in the path cache. Must be a power of two. */
+#define PATH_CACHE_INIT_SIZE 64
+/* Number of seconds a "not found" entry is trusted before PATH is searched
+ * again. This bounds how long a newly installed command can go unnoticed.
+ */
+#define PATH_CACHE_NEG_TTL   5
+
+/* A struct to hold a resolved command. A NULL path marks a negative entry
+ * for a command that was not found in any PATH directory.
+ */
+struct PathEntry {
+    char  *name;
+    char  *path;
+    int    hits;
+    time_t expires;
+};
+
+/* A struct to hold the resolved commands in an open addressing hash table
+ * keyed by command name. The PATH value the entries were resolved against is
+ * kept so that the cache can be discarded when PATH changes.
+ */
+struct PathCache {
+    struct PathEntry *buckets;
+    int   capacity;
+    int   size;
+    char *pathValue;
+};
+
+char *lookupPath(char *);
+char *hashPath(char *);
+void invalidatePath(char *);
+void clearPathCache();
+void printPathCache(FILE *);
+
+#endif
@@ -0,0 +1,248 @@
+/*******************************************************************************
+*      Filename: reader.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains a buffered line reader built on read(). Lines of any
+*                length are returned in place from a growable buffer. The
+*                reader can also return lines from a caller's buffer or from
+*                an mmap() of a whole file without copying them.
+*******************************************************************************/
+
+#include "reader.h"
+
+/*******************************************************************************
+*    Function: initLineReader()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+*              int fd - The descriptor to be read.
+* Description: Initializes a LineReader struct.
+*     Returns: None.
+*******************************************************************************/
+
+void initLineReader(struct LineReader *r, int fd) {
+    memset(r, 0, sizeof(struct LineReader));
+    r->fd = fd;
+    r->capacity = READER_INIT_SIZE;
+    if ((r->buffer = malloc(r->capacity)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+}
+
+/*******************************************************************************
+*    Function: initLineReaderFromBuffer()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+*              char *data - The text to be split into lines.
+*              size_t len - The length of the text.
+* Description: Initializes a LineReader struct that returns the lines of a
+*              buffer owned by the caller. The buffer isn't modified.
+*     Returns: None.
+*******************************************************************************/
+
+void initLineReaderFromBuffer(struct LineReader *r, char *data, size_t len) {
+    memset(r, 0, sizeof(struct LineReader));
+    r->fd = -1;
+    r->buffer = data;
+    r->capacity = len;
+    r->end = len;
+    r->isEOF = 1;
+    r->source = READER_BORROWED;
+}
+
+/*******************************************************************************
+*    Function: openLineReaderFile()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+*              char *path - The path of the file to be read.
+* Description: Initializes a LineReader struct that returns the lines of a
+*              file. A regular file is mapped into memory in its entirety, so
+*              its lines are returned without any read() or copy. Other files,
+*              such as pipes, are read with read().
+*     Returns: 0 on success, -1 with errno set if the file couldn't be opened.
+*******************************************************************************/
+
+int openLineReaderFile(struct LineReader *r, char *path) {
+    struct stat info;
+    char *data;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    if (!S_ISREG(info.st_mode)) {
+        initLineReader(r, fd);
+        return 0;
+    }
+
+    /* An empty file can't be mapped, but has no lines anyway. */
+    if (info.st_size == 0) {
+        initLineReaderFromBuffer(r, "", 0);
+        close(fd);
+        return 0;
+    }
+
+    data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    initLineReaderFromBuffer(r, data, info.st_size);
+    r->source = READER_MAPPED;
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: freeLineReader()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+* Description: Deallocates or unmaps the buffer of a LineReader struct, and
+*              closes any file it opened.
+*     Returns: None.
+*******************************************************************************/
+
+void freeLineReader(struct LineReader *r) {
+    if (r->source == READER_OWNED) {
+        free(r->buffer);
+        if (r->fd > 2) {
+            close(r->fd);
+        }
+    } else if (r->source == READER_MAPPED) {
+        munmap(r->buffer, r->capacity);
+    }
+    r->buffer = NULL;
+}
+
+/*******************************************************************************
+*    Function: _findNewline()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+* Description: Searches the unscanned buffered bytes for a newline.
+*     Returns: A pointer to the newline, or NULL if there isn't one yet.
+*******************************************************************************/
+
+char *_findNewline(struct LineReader *r) {
+    char *newline = memchr(r->buffer + r->scanned, '\n', r->end - r->scanned);
+
+    if (newline == NULL) {
+        r->scanned = r->end;
+    }
+    return newline;
+}
+
+/*******************************************************************************
+*    Function: hasBufferedLine()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+* Description: Determines whether a complete line can be returned without
+*              reading. A caller that waits for the descriptor to become
+*              readable must check this first.
+*     Returns: 1 if a line is buffered, 0 otherwise.
+*******************************************************************************/
+
+int hasBufferedLine(struct LineReader *r) {
+    return r->isEOF || _findNewline(r) != NULL;
+}
+
+/*******************************************************************************
+*    Function: reserveLineRead()
+*  Parameters: struct LineReader *r - A pointer to a reader that owns its
+*                                     buffer.
+*              size_t *space - Receives the number of bytes that may be read.
+* Description: Makes room at the end of the buffer for a read. The partial
+*              line is moved to the front of the buffer, and the buffer grows
+*              if the partial line fills it. One byte is always kept for the
+*              terminator of a final line. The bytes must be read into the
+*              space, and added with commitLineRead(), before the reader is
+*              used again.
+*     Returns: The start of the space.
+*******************************************************************************/
+
+char *reserveLineRead(struct LineReader *r, size_t *space) {
+    char *grown;
+
+    if (r->start > 0) {
+        memmove(r->buffer, r->buffer + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->scanned -= r->start;
+        r->start = 0;
+    }
+    if (r->end + 1 >= r->capacity) {
+        if ((grown = realloc(r->buffer, r->capacity * 2)) == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+        r->buffer = grown;
+        r->capacity *= 2;
+    }
+    *space = r->capacity - r->end - 1;
+    return r->buffer + r->end;
+}
+
+/*******************************************************************************
+*    Function: commitLineRead()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+*              size_t numRead - The number of bytes read into the space given
+*                               by reserveLineRead(). 0 marks EOF.
+* Description: Adds the bytes of a read to the buffered input.
+*     Returns: None.
+*******************************************************************************/
+
+void commitLineRead(struct LineReader *r, size_t numRead) {
+    if (numRead == 0) {
+        r->isEOF = 1;
+    }
+    r->end += numRead;
+}
+
+/*******************************************************************************
+*    Function: readLine()
+*  Parameters: struct LineReader *r - A pointer to the line reader.
+*              size_t *len - Receives the length of the line, if not NULL.
+* Description: Returns the next line. A final line without a newline is
+*              returned at EOF. The line is valid until the next call. If the
+*              reader owns its buffer, the newline is replaced by a null
+*              terminator; otherwise the line is delimited only by its length
+*              and its newline.
+*     Returns: The line, or NULL at EOF or on error. errno is EINTR if a
+*              signal interrupted the read.
+*******************************************************************************/
+
+char *readLine(struct LineReader *r, size_t *len) {
+    char *line, *newline, *dest;
+    size_t space;
+    ssize_t numRead;
+
+    while ((newline = _findNewline(r)) == NULL) {
+        /* At EOF, return the remaining bytes as the final line. */
+        if (r->isEOF) {
+            if (r->start == r->end) {
+                errno = 0;
+                return NULL;
+            }
+            newline = r->buffer + r->end;
+            break;
+        }
+
+        dest = reserveLineRead(r, &space);
+        if ((numRead = read(r->fd, dest, space)) == -1) {
+            return NULL;
+        }
+        commitLineRead(r, numRead);
+    }
+
+    line = r->buffer + r->start;
+    if (r->source == READER_OWNED) {
+        *newline = '\0';
+    }
+    if (len != NULL) {
+        *len = newline - line;
+    }
+    r->start = newline - r->buffer + 1;
+    if (r->start > r->end) {
+        r->start = r->end;
+    }
+    r->scanned = r->start;
+    return line;
+}
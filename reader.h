@@ -0,0 +1,55 @@
+/*******************************************************************************
+*      Filename: reader.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for reader.c. See reader.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef READER_H
+#define READER_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Initial size of the line reader buffer in bytes. The buffer doubles
+ * whenever a line doesn't fit.
+ */
+#define READER_INIT_SIZE 65536
+
+/* Sources of a line reader's buffer. */
+#define READER_OWNED     0  /* Allocated and filled with read(). */
+#define READER_BORROWED  1  /* Supplied by the caller; read-only. */
+#define READER_MAPPED    2  /* A read-only mmap() of a file. */
+
+/* A struct to hold a buffered line reader. Bytes in [start, end) have been
+ * read but not yet returned as lines. Bytes in [start, scanned) are known not
+ * to contain a newline, so no byte is searched twice.
+ */
+struct LineReader {
+    int    fd;
+    char  *buffer;
+    size_t capacity;
+    size_t start;
+    size_t scanned;
+    size_t end;
+    int    isEOF;
+    int    source;
+};
+
+void initLineReader(struct LineReader *, int);
+void initLineReaderFromBuffer(struct LineReader *, char *, size_t);
+int openLineReaderFile(struct LineReader *, char *);
+void freeLineReader(struct LineReader *);
+char *readLine(struct LineReader *, size_t *);
+int hasBufferedLine(struct LineReader *);
+char *reserveLineRead(struct LineReader *, size_t *);
+void commitLineRead(struct LineReader *, size_t);
+
+#endif
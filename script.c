@@ -0,0 +1,809 @@
+/*******************************************************************************
+*      Filename: script.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the compound commands if, while, and for. A compound
+*                command is parsed once, across as many lines as it takes,
+*                into a tree of nodes, which is then executed. Loop bodies
+*                run from the tree: commands that can't change between
+*                iterations are lexed once, and only the others are expanded
+*                again on each iteration.
+*******************************************************************************/
+
+#include "script.h"
+
+/* Holds the commands lexed while a compound command runs. It is reset after
+ * each command.
+ */
+struct Arena SCRIPT_ARENA = {0};
+
+/* Words that end a list of commands, and can't begin a command. */
+char *RESERVED_WORDS[] = {"then", "elif", "else", "fi", "do", "done", NULL};
+
+/*******************************************************************************
+*    Function: _isKeyword()
+*  Parameters: char *c - The start of a word.
+*              char *end - The end of the line.
+*              char *keyword - The keyword.
+* Description: Tests whether a word is a keyword, that is, whether it
+*              consists of the keyword followed by a blank, an operator, or
+*              the end of the line.
+*     Returns: 1 if the word is the keyword, 0 otherwise.
+*******************************************************************************/
+
+int _isKeyword(char *c, char *end, char *keyword) {
+    size_t len = strlen(keyword);
+
+    return (size_t) (end - c) >= len && memcmp(c, keyword, len) == 0 &&
+           (c + len == end || c[len] == ' ' || c[len] == '\t' ||
+            c[len] == ';' || c[len] == '&' || c[len] == '|');
+}
+
+/*******************************************************************************
+*    Function: _matchKeyword()
+*  Parameters: struct ScriptParser *p - The parser.
+*              char **keywords - A NULL-terminated list of keywords.
+* Description: Tests whether the next word is one of a list of keywords.
+*     Returns: The matching keyword, or NULL.
+*******************************************************************************/
+
+char *_matchKeyword(struct ScriptParser *p, char **keywords) {
+    int i;
+
+    for (i = 0; keywords[i] != NULL; i++) {
+        if (_isKeyword(p->pos, p->end, keywords[i])) {
+            return keywords[i];
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+*    Function: _syntaxError()
+*  Parameters: struct ScriptParser *p - The parser.
+*              char *message - The description of the error.
+* Description: Reports the first syntax error of a compound command, which is
+*              then discarded.
+*     Returns: None.
+*******************************************************************************/
+
+void _syntaxError(struct ScriptParser *p, char *message) {
+    if (p->isValid) {
+        fprintf(stderr, "Warning: %s\n", message);
+        fflush(stderr);
+    }
+    p->isValid = 0;
+}
+
+/*******************************************************************************
+*    Function: _setLine()
+*  Parameters: struct ScriptParser *p - The parser.
+*              char *line - A line of input.
+*              size_t len - The length of the line.
+* Description: Copies a line into the parser's arena, where the nodes parsed
+*              from it can refer to it, and makes it the current line.
+*     Returns: None.
+*******************************************************************************/
+
+void _setLine(struct ScriptParser *p, char *line, size_t len) {
+    char *newline = memchr(line, '\n', len);
+
+    if (newline != NULL) {
+        len = newline - line;
+    }
+    p->pos = arenaAlloc(p->arena, len + 1);
+    memcpy(p->pos, line, len);
+    p->pos[len] = '\0';
+    p->end = p->pos + len;
+}
+
+/*******************************************************************************
+*    Function: _readMore()
+*  Parameters: struct ScriptParser *p - The parser.
+* Description: Reads the next line of a compound command, displaying the
+*              continuation prompt first if the shell is interactive.
+*     Returns: 1 on success, 0 at EOF or if a signal interrupted the read.
+*******************************************************************************/
+
+int _readMore(struct ScriptParser *p) {
+    struct ScriptContext *ctx = p->ctx;
+    char *line;
+    size_t len;
+
+    if (ctx->reader == NULL) {
+        return 0;
+    }
+    if (ctx->isInteractive) {
+        printf("%s ", CONTINUATION_PROMPT);
+        fflush(stdout);
+        if (!hasBufferedLine(ctx->reader) &&
+            waitForInput(ctx->reader, ctx->bp,
+                         CONTINUATION_PROMPT) == -1) {
+            return 0;
+        }
+    }
+    if ((line = readLine(ctx->reader, &len)) == NULL) {
+        return 0;
+    }
+    _setLine(p, line, len);
+    return 1;
+}
+
+/*******************************************************************************
+*    Function: _skipBlank()
+*  Parameters: struct ScriptParser *p - The parser.
+*              int needMore - Set if the compound command isn't complete, so
+*                             that further lines are read.
+* Description: Moves to the next word, skipping blanks and comment lines.
+*     Returns: 1 if a word follows, 0 otherwise.
+*******************************************************************************/
+
+int _skipBlank(struct ScriptParser *p, int needMore) {
+    while (1) {
+        while (p->pos < p->end && (*p->pos == ' ' || *p->pos == '\t')) {
+            p->pos++;
+        }
+        if (p->pos < p->end && *p->pos != '#') {
+            return 1;
+        }
+        p->pos = p->end;
+        if (!needMore || !_readMore(p)) {
+            return 0;
+        }
+    }
+}
+
+/*******************************************************************************
+*    Function: _findSeparator()
+*  Parameters: char *c - The start of a command.
+*              char *end - The end of the line.
+* Description: Finds the list operator that ends a command: ';', "&&", "||",
+*              or '&', skipping quotes, escaped characters, and parenthesized
+*              command substitutions.
+*     Returns: A pointer to the operator, or end if the command ends the
+*              line.
+*******************************************************************************/
+
+char *_findSeparator(char *c, char *end) {
+    int depth = 0;
+    char quote = '\0';
+
+    for (; c < end; c++) {
+        if (quote == '\'') {
+            if (*c == '\'') {
+                quote = '\0';
+            }
+        } else if (*c == '\\' && c + 1 < end) {
+            c++;
+        } else if (quote == '"') {
+            if (*c == '"') {
+                quote = '\0';
+            }
+        } else if (*c == '\'' || *c == '"') {
+            quote = *c;
+        } else if (*c == '(') {
+            depth++;
+        } else if (*c == ')' && depth > 0) {
+            depth--;
+        } else if (depth == 0 && (*c == ';' || *c == '&' ||
+                                  (*c == '|' && c + 1 < end && c[1] == '|'))) {
+            return c;
+        }
+    }
+    return end;
+}
+
+/*******************************************************************************
+*    Function: _isStatic()
+*  Parameters: char *text - The text of a command.
+*              size_t len - The length of the text.
+* Description: Tests whether a command expands the same way every time, that
+*              is, whether it is free of parameters, substitutions, and
+*              pattern characters, quoted or not.
+*     Returns: 1 if the command is static, 0 otherwise.
+*******************************************************************************/
+
+int _isStatic(char *text, size_t len) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (text[i] == '$' || text[i] == '*' || text[i] == '?' ||
+            text[i] == '[') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*    Function: _newNode()
+*  Parameters: struct ScriptParser *p - The parser.
+*              int type - The type of the node.
+* Description: Allocates an empty node from the parser's arena.
+*     Returns: The node.
+*******************************************************************************/
+
+struct ScriptNode *_newNode(struct ScriptParser *p, int type) {
+    struct ScriptNode *node = arenaAlloc(p->arena, sizeof(struct ScriptNode));
+
+    memset(node, 0, sizeof(struct ScriptNode));
+    node->type = type;
+    return node;
+}
+
+/*******************************************************************************
+*    Function: _takeOperator()
+*  Parameters: struct ScriptParser *p - The parser.
+*              struct ScriptNode *node - Receives the list operator.
+* Description: Moves past the list operator that follows a node, if any, and
+*              records it in the node. A '&' runs the node in the background
+*              and, like the end of the line or a comment, is followed by the
+*              next node unconditionally.
+*     Returns: 1 if an operator or the end of the line follows, 0 otherwise.
+*******************************************************************************/
+
+int _takeOperator(struct ScriptParser *p, struct ScriptNode *node) {
+    char *c;
+
+    while (p->pos < p->end && (*p->pos == ' ' || *p->pos == '\t')) {
+        p->pos++;
+    }
+    c = p->pos;
+    node->listOp = LIST_SEQ;
+    if (c + 1 < p->end && (*c == '&' || *c == '|') && c[1] == *c) {
+        node->listOp = *c == '&' ? LIST_AND : LIST_OR;
+        p->pos += 2;
+    } else if (c < p->end && (*c == ';' || *c == '&')) {
+        node->isBackground = *c == '&';
+        p->pos++;
+    } else if (c < p->end && *c != '#') {
+        return 0;
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*    Function: _takeText()
+*  Parameters: struct ScriptParser *p - The parser.
+*              struct ScriptNode *node - Receives the text.
+* Description: Takes the text up to the next list operator or the end of the
+*              line, without trailing blanks, and moves past the operator. A
+*              '&' is kept at the end of the text, so that the command itself
+*              runs in the background.
+*     Returns: None.
+*******************************************************************************/
+
+void _takeText(struct ScriptParser *p, struct ScriptNode *node) {
+    char *separator = _findSeparator(p->pos, p->end);
+
+    if (separator < p->end && *separator == '&' &&
+        (separator + 1 == p->end || separator[1] != '&')) {
+        separator++;
+    }
+    node->text = p->pos;
+    node->len = separator - p->pos;
+    while (node->len > 0 && (node->text[node->len - 1] == ' ' ||
+                             node->text[node->len - 1] == '\t')) {
+        node->len--;
+    }
+    p->pos = separator;
+    _takeOperator(p, node);
+}
+
+/*******************************************************************************
+*    Function: _parseCommand()
+*  Parameters: struct ScriptParser *p - The parser, at the start of a command.
+* Description: Parses a command line. A static command is lexed right away,
+*              unless it is a list of several pipelines, whose later ones
+*              must be skipped or not as it executes.
+*     Returns: The node of the command.
+*******************************************************************************/
+
+struct ScriptNode *_parseCommand(struct ScriptParser *p) {
+    struct ScriptNode *node = _newNode(p, NODE_COMMAND);
+    struct CommandInfo *ci;
+
+    _takeText(p, node);
+    if (_isStatic(node->text, node->len)) {
+        ci = arenaAlloc(p->arena, sizeof(struct CommandInfo));
+        processInput(node->text, node->len, ci, p->arena);
+        if (ci->listOp == LIST_END) {
+            node->compiled = ci;
+        }
+    }
+    return node;
+}
+
+/*******************************************************************************
+*    Function: _expectKeyword()
+*  Parameters: struct ScriptParser *p - The parser.
+*              char *keyword - The expected keyword.
+* Description: Moves past the keyword that must come next.
+*     Returns: 1 if the keyword came next, 0 otherwise.
+*******************************************************************************/
+
+int _expectKeyword(struct ScriptParser *p, char *keyword) {
+    char message[64];
+
+    if (p->isValid && _skipBlank(p, 1) &&
+        _isKeyword(p->pos, p->end, keyword)) {
+        p->pos += strlen(keyword);
+        return 1;
+    }
+    snprintf(message, sizeof(message), "Expected %s", keyword);
+    _syntaxError(p, message);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _endCompound()
+*  Parameters: struct ScriptParser *p - The parser, past the closing keyword.
+*              struct ScriptNode *node - The node of the compound command.
+* Description: Checks that a compound command is followed by a list operator
+*              or by the end of the line, and moves past the operator.
+*     Returns: None.
+*******************************************************************************/
+
+void _endCompound(struct ScriptParser *p, struct ScriptNode *node) {
+    if (!_takeOperator(p, node)) {
+        _syntaxError(p, "Unexpected text after compound command");
+    }
+}
+
+struct ScriptNode *_parseList(struct ScriptParser *, char **);
+
+/*******************************************************************************
+*    Function: _parseIf()
+*  Parameters: struct ScriptParser *p - The parser, past "if" or "elif".
+* Description: Parses the rest of an if command. An elif is parsed as an if
+*              command nested in the else branch, sharing the closing fi.
+*     Returns: The node of the command.
+*******************************************************************************/
+
+struct ScriptNode *_parseIf(struct ScriptParser *p) {
+    struct ScriptNode *node = _newNode(p, NODE_IF);
+    char *thenEnds[] = {"then", NULL};
+    char *bodyEnds[] = {"elif", "else", "fi", NULL};
+    char *elseEnds[] = {"fi", NULL};
+    char *keyword;
+
+    node->cond = _parseList(p, thenEnds);
+    _expectKeyword(p, "then");
+    node->body = _parseList(p, bodyEnds);
+    if (!p->isValid) {
+        return node;
+    }
+
+    keyword = _matchKeyword(p, bodyEnds);
+    p->pos += strlen(keyword);
+    if (strcmp(keyword, "elif") == 0) {
+        /* The operator after the shared fi follows the whole command. */
+        node->elseBody = _parseIf(p);
+        node->listOp = node->elseBody->listOp;
+        node->isBackground = node->elseBody->isBackground;
+        node->elseBody->isBackground = 0;
+        return node;
+    }
+    if (strcmp(keyword, "else") == 0) {
+        node->elseBody = _parseList(p, elseEnds);
+        _expectKeyword(p, "fi");
+    }
+    _endCompound(p, node);
+    return node;
+}
+
+/*******************************************************************************
+*    Function: _parseLoop()
+*  Parameters: struct ScriptParser *p - The parser, past "while" or "for".
+*              int type - NODE_WHILE or NODE_FOR.
+* Description: Parses the rest of a while or for loop. The word list of a for
+*              loop follows "in" and ends at a ';' or at the end of the line;
+*              without "in", the list is empty, and a ';' may follow the
+*              name.
+*     Returns: The node of the loop.
+*******************************************************************************/
+
+struct ScriptNode *_parseLoop(struct ScriptParser *p, int type) {
+    struct ScriptNode *node = _newNode(p, type);
+    char *doEnds[] = {"do", NULL};
+    char *doneEnds[] = {"done", NULL};
+    char *name;
+    size_t len = 0;
+
+    if (type == NODE_WHILE) {
+        node->cond = _parseList(p, doEnds);
+    } else {
+        _skipBlank(p, 0);
+        name = p->pos;
+        while (name + len < p->end && name[len] != ' ' &&
+               name[len] != '\t' && name[len] != ';') {
+            len++;
+        }
+        if (!isValidName(name, len)) {
+            _syntaxError(p, "Bad for loop variable");
+            return node;
+        }
+        node->name = arenaAlloc(p->arena, len + 1);
+        memcpy(node->name, name, len);
+        node->name[len] = '\0';
+        p->pos += len;
+
+        _skipBlank(p, 0);
+        if (_isKeyword(p->pos, p->end, "in")) {
+            p->pos += 2;
+            _takeText(p, node);
+            if (node->listOp != LIST_SEQ || node->isBackground) {
+                _syntaxError(p, "Expected do");
+                return node;
+            }
+        } else if (p->pos < p->end && *p->pos == ';') {
+            p->pos++;
+        }
+    }
+
+    _expectKeyword(p, "do");
+    node->body = _parseList(p, doneEnds);
+    if (_expectKeyword(p, "done")) {
+        _endCompound(p, node);
+    }
+    return node;
+}
+
+/*******************************************************************************
+*    Function: _parseList()
+*  Parameters: struct ScriptParser *p - The parser.
+*              char **terminators - The keywords that end the list.
+* Description: Parses commands until one of the terminators, which is left
+*              to the caller. Further lines are read as needed; a list
+*              without terminators ends with the current line, unless it
+*              ends with "&&" or "||". A list element without a command is
+*              reported.
+*     Returns: The first node of the list, or NULL if it is empty.
+*******************************************************************************/
+
+struct ScriptNode *_parseList(struct ScriptParser *p, char **terminators) {
+    struct ScriptNode *head = NULL, **tail = &head, *last = NULL;
+    int isNested = terminators[0] != NULL, needsCommand = 0;
+    char *reserved;
+    char message[64];
+
+    while (p->isValid) {
+        needsCommand = last != NULL && (last->listOp == LIST_AND ||
+                                        last->listOp == LIST_OR);
+        if (!_skipBlank(p, isNested || needsCommand)) {
+            if (isNested || needsCommand) {
+                _syntaxError(p, "Unexpected end of input");
+            }
+            break;
+        }
+        if (*p->pos == ';' || *p->pos == '&' || *p->pos == '|') {
+            _syntaxError(p, "List element has no command");
+            break;
+        }
+        if (_matchKeyword(p, terminators) != NULL) {
+            if (needsCommand) {
+                _syntaxError(p, "List element has no command");
+            }
+            break;
+        }
+        if ((reserved = _matchKeyword(p, RESERVED_WORDS)) != NULL) {
+            snprintf(message, sizeof(message), "Unexpected %s", reserved);
+            _syntaxError(p, message);
+            break;
+        }
+
+        if (_isKeyword(p->pos, p->end, "if")) {
+            p->pos += 2;
+            *tail = _parseIf(p);
+        } else if (_isKeyword(p->pos, p->end, "while")) {
+            p->pos += 5;
+            *tail = _parseLoop(p, NODE_WHILE);
+        } else if (_isKeyword(p->pos, p->end, "for")) {
+            p->pos += 3;
+            *tail = _parseLoop(p, NODE_FOR);
+        } else {
+            *tail = _parseCommand(p);
+        }
+        last = *tail;
+        tail = &(*tail)->next;
+    }
+    return head;
+}
+
+int _executeList(struct ScriptNode *, int, struct ScriptContext *);
+
+/*******************************************************************************
+*    Function: _executeText()
+*  Parameters: struct ScriptNode *node - A command node.
+*              struct ScriptContext *ctx - The execution context.
+* Description: Executes a command as the main loop would, unless it was
+*              compiled. The foreground-only mode overrides the compiled
+*              foreground status for this execution only.
+*     Returns: 1 if the command ends the shell, 0 otherwise.
+*******************************************************************************/
+
+int _executeText(struct ScriptNode *node, struct ScriptContext *ctx) {
+    struct CommandInfo *ci = node->compiled, *stage;
+    int isForeground, isExit;
+
+    if (ci == NULL) {
+        return executeLine(node->text, node->len, LIST_SEQ, ctx->fs, ctx->bp,
+                           &SCRIPT_ARENA);
+    }
+
+    isForeground = ci->isForeground;
+    if (FOREGROUND_FLAG) {
+        for (stage = ci; stage != NULL; stage = stage->next) {
+            stage->isForeground = 1;
+        }
+    }
+    isExit = executeCommand(ci, ctx->fs, ctx->bp);
+    for (stage = ci; stage != NULL; stage = stage->next) {
+        stage->isForeground = isForeground;
+    }
+
+    arenaReset(&SCRIPT_ARENA);
+    return isExit;
+}
+
+/*******************************************************************************
+*    Function: _executeFor()
+*  Parameters: struct ScriptNode *node - A for loop node.
+*              struct ScriptContext *ctx - The execution context.
+* Description: Expands the word list of a for loop once, then executes the
+*              body with the variable set to each word in turn.
+*     Returns: 1 if a command ends the shell, 0 otherwise.
+*******************************************************************************/
+
+int _executeFor(struct ScriptNode *node, struct ScriptContext *ctx) {
+    struct CommandInfo words = {0};
+    struct Arena arena = {0};
+    int i, isExit = 0;
+
+    if (node->text != NULL) {
+        processInput(node->text, node->len, &words, &arena);
+    }
+    setLastStatus(0);
+    for (i = 0; i < words.numArgs && !INTERRUPT_FLAG; i++) {
+        setVariable(node->name, words.args[i], 0);
+        syncEnvironment();
+        if ((isExit = _executeList(node->body, LIST_SEQ, ctx)) != 0) {
+            break;
+        }
+        if (ctx->bp->size > 0) {
+            backgroundCleanup(ctx->bp);
+        }
+    }
+
+    arenaFree(&arena);
+    return isExit;
+}
+
+/*******************************************************************************
+*    Function: _executeNode()
+*  Parameters: struct ScriptNode *node - A node.
+*              struct ScriptContext *ctx - The execution context.
+* Description: Executes a command or compound command. The status of an if
+*              command or loop is that of the last command of its body, or 0
+*              if no body command was executed.
+*     Returns: 1 if a command ends the shell, 0 otherwise.
+*******************************************************************************/
+
+int _executeNode(struct ScriptNode *node, struct ScriptContext *ctx) {
+    struct ScriptNode *branch;
+    int status = 0;
+
+    switch (node->type) {
+        case NODE_COMMAND:
+            return _executeText(node, ctx);
+        case NODE_IF:
+            if (_executeList(node->cond, LIST_SEQ, ctx)) {
+                return 1;
+            }
+            branch = LAST_STATUS == 0 ? node->body : node->elseBody;
+            setLastStatus(0);
+            return INTERRUPT_FLAG ? 0 : _executeList(branch, LIST_SEQ, ctx);
+        case NODE_WHILE:
+            while (!INTERRUPT_FLAG) {
+                if (_executeList(node->cond, LIST_SEQ, ctx)) {
+                    return 1;
+                }
+                if (LAST_STATUS != 0 || INTERRUPT_FLAG) {
+                    break;
+                }
+                setLastStatus(0);
+                if (_executeList(node->body, LIST_SEQ, ctx)) {
+                    return 1;
+                }
+                status = LAST_STATUS;
+                if (ctx->bp->size > 0) {
+                    backgroundCleanup(ctx->bp);
+                }
+            }
+            setLastStatus(status);
+            return 0;
+        case NODE_FOR:
+            return _executeFor(node, ctx);
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _executeBackground()
+*  Parameters: struct ScriptNode *node - A compound command node.
+*              struct ScriptContext *ctx - The execution context.
+* Description: Executes a compound command in the background, in a forked
+*              copy of the shell that becomes a job in a process group of its
+*              own. Like a background command, it reads from and writes to
+*              /dev/null, and ignores SIGINT and SIGTSTP.
+*     Returns: 0.
+*******************************************************************************/
+
+int _executeBackground(struct ScriptNode *node, struct ScriptContext *ctx) {
+    char *jobNames[] = NODE_JOB_NAMES_INIT;
+    struct ScriptContext copy = {NULL, 0, NULL, NULL};
+    struct ForegroundStatus fs;
+    struct BackgroundProcesses bp;
+    int nullFD;
+    pid_t pid;
+
+    if ((pid = fork()) == -1) {
+        perror("fork");
+        setLastStatus(1);
+        return 0;
+    }
+    if (pid == 0) {
+        setpgid(0, 0);
+        registerBackgroundChildHandlers();
+        detachSpawnEngine();
+        forgetJobCgroups();
+        if ((nullFD = open("/dev/null", O_RDWR | O_CLOEXEC)) != -1) {
+            dup2(nullFD, 0);
+            dup2(nullFD, 1);
+        }
+        initForegroundStatus(&fs);
+        initBackgroundProcesses(&bp);
+        copy.fs = &fs;
+        copy.bp = &bp;
+        _executeNode(node, &copy);
+        fflush(stdout);
+        _exit(LAST_STATUS);
+    }
+
+    setpgid(pid, pid);
+    fprintf(stdout, "background pid id %d\n", pid);
+    fflush(stdout);
+    setLastBackground(pid);
+    addBackgroundProcess(ctx->bp, pid, pid, ctx->bp->nextJobId++,
+                         jobNames[node->type]);
+    setLastStatus(0);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _executeList()
+*  Parameters: struct ScriptNode *node - The first node of a list.
+*              int listOp - The list operator preceding the list.
+*              struct ScriptContext *ctx - The execution context.
+* Description: Executes each node of a list, stopping early if the shell
+*              received SIGINT. As in executeLine(), a node after "&&"
+*              executes only if the status of the last command executed is 0,
+*              and one after "||" only if it isn't. In foreground-only mode,
+*              compound commands followed by '&' run in the foreground.
+*     Returns: 1 if a command ends the shell, 0 otherwise.
+*******************************************************************************/
+
+int _executeList(struct ScriptNode *node, int listOp,
+                 struct ScriptContext *ctx) {
+    for (; node != NULL && !INTERRUPT_FLAG; node = node->next) {
+        if ((listOp != LIST_AND && listOp != LIST_OR) ||
+            (listOp == LIST_AND) == (LAST_STATUS == 0)) {
+            if (node->isBackground && !FOREGROUND_FLAG) {
+                _executeBackground(node, ctx);
+            } else if (_executeNode(node, ctx)) {
+                return 1;
+            }
+        }
+        listOp = node->listOp;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: isCompoundStart()
+*  Parameters: char *line - A line of input.
+*              size_t len - The length of the line.
+* Description: Tests whether a line begins with if, while, or for, or with a
+*              reserved word, which is reported by executeCompound().
+*     Returns: 1 if the line is handled by executeCompound(), 0 otherwise.
+*******************************************************************************/
+
+int isCompoundStart(char *line, size_t len) {
+    char *end = line + len;
+    int i;
+
+    while (line < end && (*line == ' ' || *line == '\t')) {
+        line++;
+    }
+    for (i = 0; RESERVED_WORDS[i] != NULL; i++) {
+        if (_isKeyword(line, end, RESERVED_WORDS[i])) {
+            return 1;
+        }
+    }
+    return _isKeyword(line, end, "if") || _isKeyword(line, end, "while") ||
+           _isKeyword(line, end, "for");
+}
+
+/*******************************************************************************
+*    Function: hasCompoundCommand()
+*  Parameters: char *line - A line of input.
+*              size_t len - The length of the line.
+* Description: Tests whether any element of a list begins as isCompoundStart()
+*              describes, finding the elements as the parser does, without
+*              expanding them.
+*     Returns: 1 if the line is handled by executeCompound(), 0 otherwise.
+*******************************************************************************/
+
+int hasCompoundCommand(char *line, size_t len) {
+    char *end = memchr(line, '\n', len), *separator;
+
+    if (end == NULL) {
+        end = line + len;
+    }
+    while (1) {
+        if (isCompoundStart(line, end - line)) {
+            return 1;
+        }
+        if ((separator = _findSeparator(line, end)) == end) {
+            return 0;
+        }
+        line = separator + 1;
+        if (line < end && *line == *separator) {
+            line++;
+        }
+    }
+}
+
+/*******************************************************************************
+*    Function: executeCompound()
+*  Parameters: char *line - The line, or the rest of a list, holding the
+*                           compound command.
+*              size_t len - The length of the line.
+*              int listOp - The list operator preceding the line, as for
+*                           executeLine().
+*              struct ScriptContext *ctx - The execution context.
+* Description: Parses the commands of a line, reading further lines until
+*              every compound command is complete, and executes them unless
+*              there was a syntax error, which sets the status to
+*              LEX_ERROR_STATUS. SIGINT stops the execution.
+*     Returns: 1 if a command ends the shell, 0 otherwise.
+*******************************************************************************/
+
+int executeCompound(char *line, size_t len, int listOp,
+                    struct ScriptContext *ctx) {
+    struct ScriptParser p = {0};
+    struct ScriptNode *head;
+    struct Arena arena = {0};
+    char *noEnds[] = {NULL};
+    int isExit = 0;
+
+    p.ctx = ctx;
+    p.arena = &arena;
+    p.isValid = 1;
+    _setLine(&p, line, len);
+
+    /* Parse the line's commands; only an incomplete compound command reads
+     * further lines.
+     */
+    head = _parseList(&p, noEnds);
+
+    INTERRUPT_FLAG = 0;
+    if (p.isValid) {
+        isExit = _executeList(head, listOp, ctx);
+    } else {
+        setLastStatus(LEX_ERROR_STATUS);
+    }
+    INTERRUPT_FLAG = 0;
+    arenaFree(&arena);
+    return isExit;
+}
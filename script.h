@@ -0,0 +1,90 @@
+/*******************************************************************************
+*      Filename: script.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for script.c. See script.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "builtins.h"
+#include "input.h"
+#include "reader.h"
+#include "signal_proc.h"
+#include "variables.h"
+
+/* Prompt displayed while a compound command continues on further lines. */
+#define CONTINUATION_PROMPT ">"
+
+/* Types of script nodes. */
+#define NODE_COMMAND 0  /* A command line, executed as the main loop would. */
+#define NODE_IF      1  /* if cond; then body; [else elseBody;] fi */
+#define NODE_WHILE   2  /* while cond; do body; done */
+#define NODE_FOR     3  /* for name in text; do body; done */
+
+/* The command line of a compound command run in the background, as listed by
+ * the jobs builtin, for each type of node.
+ */
+#define NODE_JOB_NAMES_INIT {"", "if ... fi", "while ... done", "for ... done"}
+
+/* A struct to hold one node of a parsed compound command. Lists of nodes are
+ * linked through next. The text of a command, or the word list of a for
+ * loop, is a slice of the source and is expanded each time it is executed.
+ * A command without parameters, substitutions, or patterns can't change
+ * between executions, so it is lexed once, when it is parsed, into compiled.
+ * listOp is the list operator that follows the node, and isBackground is set
+ * for a compound command followed by '&'.
+ */
+struct ScriptNode {
+    int    type;
+    int    listOp;
+    int    isBackground;
+    char  *text;
+    size_t len;
+    char  *name;
+    struct CommandInfo *compiled;
+    struct ScriptNode  *cond;
+    struct ScriptNode  *body;
+    struct ScriptNode  *elseBody;
+    struct ScriptNode  *next;
+};
+
+/* A struct to hold what a compound command is executed with: the reader
+ * further lines are taken from (or NULL), whether a prompt is displayed for
+ * them, and the shell's status and job table.
+ */
+struct ScriptContext {
+    struct LineReader          *reader;
+    int                         isInteractive;
+    struct ForegroundStatus    *fs;
+    struct BackgroundProcesses *bp;
+};
+
+/* A struct to hold the state of the parser. The source is parsed one line at
+ * a time; pos and end delimit the rest of the current line, which is copied
+ * into the arena along with every node.
+ */
+struct ScriptParser {
+    struct ScriptContext *ctx;
+    struct Arena         *arena;
+    char                 *pos;
+    char                 *end;
+    int                   isValid;
+};
+
+int isCompoundStart(char *, size_t);
+int hasCompoundCommand(char *, size_t);
+int executeCompound(char *, size_t, int, struct ScriptContext *);
+
+#endif
@@ -0,0 +1,159 @@
+/*******************************************************************************
+*      Filename: shell_stats.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the phase instrumentation of the shell's own
+*                overhead. The time spent in each phase of handling a command
+*                line is accumulated in a log-linear histogram per phase.
+*                Instrumentation is enabled through the environment at start
+*                up, and otherwise costs one branch per phase.
+*******************************************************************************/
+
+#include "shell_stats.h"
+
+/* Global instrumentation switch. */
+int STATS_ENABLED = 0;
+
+/* Latency histogram of each phase. */
+struct PhaseHistogram PHASE_STATS[NUM_STATS_PHASES];
+
+/*******************************************************************************
+*    Function: initShellStats()
+*  Parameters: None.
+* Description: Enables the instrumentation if SHELL_STATS_ENV is set to a value
+*              other than an empty string or "0".
+*     Returns: None.
+*******************************************************************************/
+
+void initShellStats() {
+    char *value = getenv(SHELL_STATS_ENV);
+
+    STATS_ENABLED = value != NULL && value[0] != '\0' &&
+                    strcmp(value, "0") != 0;
+}
+
+/*******************************************************************************
+*    Function: _bucketIndex()
+*  Parameters: long long ns - A non-negative value.
+* Description: Finds the histogram bucket of a value. The position of the
+*              highest set bit selects the power of two, and the
+*              STATS_SUB_BITS bits below it select the bucket within it.
+*     Returns: The bucket index.
+*******************************************************************************/
+
+int _bucketIndex(long long ns) {
+    unsigned long long value = ns;
+    int magnitude;
+
+    if (value < STATS_SUB_BUCKETS) {
+        return value;
+    }
+    magnitude = 63 - __builtin_clzll(value);
+    return (magnitude - STATS_SUB_BITS + 1) * STATS_SUB_BUCKETS +
+           ((value >> (magnitude - STATS_SUB_BITS)) & (STATS_SUB_BUCKETS - 1));
+}
+
+/*******************************************************************************
+*    Function: bucketValue()
+*  Parameters: int bucket - A bucket index.
+* Description: Finds the highest value that falls into a bucket.
+*     Returns: The highest value of the bucket.
+*******************************************************************************/
+
+long long bucketValue(int bucket) {
+    int magnitude, sub;
+
+    if (bucket < STATS_SUB_BUCKETS) {
+        return bucket;
+    }
+    magnitude = bucket / STATS_SUB_BUCKETS + STATS_SUB_BITS - 1;
+    sub = bucket % STATS_SUB_BUCKETS;
+    return (((unsigned long long) (STATS_SUB_BUCKETS + sub + 1)) <<
+            (magnitude - STATS_SUB_BITS)) - 1;
+}
+
+/*******************************************************************************
+*    Function: recordPhase()
+*  Parameters: int phase - The phase that ended.
+*              struct timespec *start - The time the phase began.
+* Description: Adds the time elapsed since the start of a phase to the phase's
+*              histogram.
+*     Returns: None.
+*******************************************************************************/
+
+void recordPhase(int phase, struct timespec *start) {
+    struct PhaseHistogram *stats = &PHASE_STATS[phase];
+    struct timespec end;
+    long long ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = (end.tv_sec - start->tv_sec) * 1000000000LL +
+         (end.tv_nsec - start->tv_nsec);
+    if (ns < 0) {
+        ns = 0;
+    }
+
+    if (stats->count == 0 || ns < stats->minNs) {
+        stats->minNs = ns;
+    }
+    if (ns > stats->maxNs) {
+        stats->maxNs = ns;
+    }
+    stats->counts[_bucketIndex(ns)]++;
+    stats->totalNs += ns;
+    stats->count++;
+}
+
+/*******************************************************************************
+*    Function: getPhaseStats()
+*  Parameters: int phase - The phase.
+* Description: Retrieves the histogram of a phase.
+*     Returns: A pointer to the histogram.
+*******************************************************************************/
+
+struct PhaseHistogram *getPhaseStats(int phase) {
+    return &PHASE_STATS[phase];
+}
+
+/*******************************************************************************
+*    Function: phasePercentile()
+*  Parameters: struct PhaseHistogram *stats - A histogram.
+*              double percentile - The percentile, between 0 and 100.
+* Description: Finds the value at a percentile of a histogram. The value is
+*              the highest of the bucket holding the percentile, but never more
+*              than the largest value recorded.
+*     Returns: The value in nanoseconds, or 0 if the histogram is empty.
+*******************************************************************************/
+
+long long phasePercentile(struct PhaseHistogram *stats, double percentile) {
+    unsigned long target, seen = 0;
+    long long value;
+    int i;
+
+    if (stats->count == 0) {
+        return 0;
+    }
+    target = (unsigned long) (stats->count * percentile / 100.0 + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    for (i = 0; i < STATS_NUM_BUCKETS; i++) {
+        seen += stats->counts[i];
+        if (seen >= target) {
+            value = bucketValue(i);
+            return value < stats->maxNs ? value : stats->maxNs;
+        }
+    }
+    return stats->maxNs;
+}
+
+/*******************************************************************************
+*    Function: resetShellStats()
+*  Parameters: None.
+* Description: Clears the histograms of all phases.
+*     Returns: None.
+*******************************************************************************/
+
+void resetShellStats() {
+    memset(PHASE_STATS, 0, sizeof(PHASE_STATS));
+}
@@ -0,0 +1,80 @@
+/*******************************************************************************
+*      Filename: shell_stats.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for shell_stats.c. See shell_stats.c for
+*                function descriptions.
+*******************************************************************************/
+
+#ifndef SHELL_STATS_H
+#define SHELL_STATS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The environment variable that enables phase instrumentation. Any value other
+ * than an empty string or "0" enables it.
+ */
+#define SHELL_STATS_ENV "SHELL_STATS"
+
+/* Phases of the shell's handling of a command line. STATS_SPAWN includes the
+ * exec() of the command under posix_spawn(), which returns once the child has
+ * executed, and STATS_WAIT lasts until every foreground stage has terminated.
+ */
+#define STATS_READ       0
+#define STATS_PARSE      1
+#define STATS_DISPATCH   2
+#define STATS_REDIRECT   3
+#define STATS_SPAWN      4
+#define STATS_WAIT       5
+#define NUM_STATS_PHASES 6
+
+/* Names of the phases, indexed by identifier. */
+#define STATS_PHASE_NAMES_INIT \
+    {"read", "parse", "dispatch", "redirect", "spawn", "wait"}
+
+/* Histograms are log-linear, as in HdrHistogram: each power of two is split
+ * into 2^STATS_SUB_BITS equal buckets, so a recorded value is within about 6%
+ * of its bucket's bounds. Values below 2^STATS_SUB_BITS have a bucket each.
+ */
+#define STATS_SUB_BITS    4
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BITS)
+#define STATS_NUM_BUCKETS ((64 - STATS_SUB_BITS + 1) * STATS_SUB_BUCKETS)
+
+/* Record the start of a phase, and the phase once it ends. When the
+ * instrumentation is disabled, each costs a single branch.
+ */
+#define STATS_START(start)                                                 \
+    do {                                                                   \
+        if (STATS_ENABLED) {                                               \
+            clock_gettime(CLOCK_MONOTONIC, &(start));                      \
+        }                                                                  \
+    } while (0)
+#define STATS_RECORD(phase, start)                                         \
+    do {                                                                   \
+        if (STATS_ENABLED) {                                               \
+            recordPhase((phase), &(start));                                \
+        }                                                                  \
+    } while (0)
+
+/* A struct to hold the latency histogram of one phase, in nanoseconds. */
+struct PhaseHistogram {
+    unsigned long counts[STATS_NUM_BUCKETS];
+    unsigned long count;
+    long long     totalNs;
+    long long     minNs;
+    long long     maxNs;
+};
+
+/* Global instrumentation switch. */
+extern int STATS_ENABLED;
+
+void initShellStats();
+void recordPhase(int, struct timespec *);
+struct PhaseHistogram *getPhaseStats(int);
+long long bucketValue(int);
+long long phasePercentile(struct PhaseHistogram *, double);
+void resetShellStats();
+
+#endif
@@ -9,26 +9,108 @@
 *******************************************************************************/
 
 #include "signal_proc.h"
+#include "builtins.h"
+
+/* Global foreground-only mode flag switch. */
+int FOREGROUND_FLAG = 0;
+
+/* Global pipefail flag. When set, a pipeline fails if any stage fails. */
+int PIPEFAIL_FLAG = 0;
+
+/* The signalfd through which SIGCHLD is received, or -1. */
+int REAPER_FD = -1;
+
+/* Set by the SIGINT handler, so that loops can stop between commands. */
+volatile sig_atomic_t INTERRUPT_FLAG = 0;
+
+/*******************************************************************************
+*    Function: _allocBackgroundSlots()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              int capacity - The new number of slots.
+* Description: Resizes the slot array and the hash table of a background
+*              process table. Existing processes are rehashed, and the new
+*              slots are pushed onto the free list.
+*     Returns: 0 on success, -1 if memory couldn't be allocated.
+*******************************************************************************/
+
+int _allocBackgroundSlots(struct BackgroundProcesses *bp, int capacity) {
+    struct BackgroundProcess *slots;
+    int *buckets;
+    int i, bucket;
+
+    slots = realloc(bp->slots, capacity * sizeof(struct BackgroundProcess));
+    if (slots == NULL) {
+        return -1;
+    }
+    bp->slots = slots;
+    if ((buckets = malloc(capacity * sizeof(int))) == NULL) {
+        return -1;
+    }
+    free(bp->buckets);
+    bp->buckets = buckets;
+
+    /* Initialize all new PIDS to -1 and push their slots onto the free list
+     * in reverse, so that lower slots are used first.
+     */
+    for (i = capacity - 1; i >= bp->capacity; i--) {
+        bp->slots[i].pid = -1;
+        bp->slots[i].command = NULL;
+        bp->slots[i].hashNext = bp->freeHead;
+        bp->freeHead = i;
+    }
+
+    /* Rehash the existing processes. */
+    for (i = 0; i < capacity; i++) {
+        bp->buckets[i] = -1;
+    }
+    for (i = 0; i < bp->capacity; i++) {
+        if (bp->slots[i].pid != -1) {
+            bucket = bp->slots[i].pid & (capacity - 1);
+            bp->slots[i].hashNext = bp->buckets[bucket];
+            bp->buckets[bucket] = i;
+        }
+    }
+    bp->capacity = capacity;
+    return 0;
+}
 
 /*******************************************************************************
 *    Function: initBackgroundProcesses()
-*  Parameters: struct BackgroundProcesses *bp - A pointer to the background PID
-*                                               array.
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
 * Description: Initializes a BackgroundProcesses struct.
 *     Returns: None.
 *******************************************************************************/
 
 void initBackgroundProcesses(struct BackgroundProcesses *bp) {
+    memset(bp, 0, sizeof(struct BackgroundProcesses));
+    bp->freeHead = -1;
+    bp->nextJobId = 1;
+
+    if (_allocBackgroundSlots(bp, BACKGROUND_INIT_SIZE) == -1) {
+        perror("malloc");
+        exit(1);
+    }
+}
+
+/*******************************************************************************
+*    Function: freeBackgroundProcesses()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+* Description: Deallocates a BackgroundProcesses struct.
+*     Returns: None.
+*******************************************************************************/
+
+void freeBackgroundProcesses(struct BackgroundProcesses *bp) {
     int i;
-    /* Initialize the array size. */
-    bp->size = 0;
-   
-    /* Initialize all PIDS to -1. We will test against this value to determine
-     * if a background process ID is in the array. 
-     */ 
-    for (i = 0; i < NUM_BACKGROUND_PIDS; i++) {
-        bp->array[i] = -1;
+
+    for (i = 0; i < bp->capacity; i++) {
+        free(bp->slots[i].command);
     }
+    free(bp->slots);
+    free(bp->buckets);
+    memset(bp, 0, sizeof(struct BackgroundProcesses));
 }
 
 /*******************************************************************************
@@ -44,212 +126,990 @@ void initForegroundStatus(struct ForegroundStatus *fs) {
      * if any foreground non-builtin has been executed or not.
      */
     fs->statusNum = -1;
+    fs->hasUsage = 0;
+    fs->wallSeconds = 0;
+    memset(&fs->usage, 0, sizeof(fs->usage));
 }
 
 /*******************************************************************************
-*    Function: _addBackgroundProcess()
-*  Parameters: struct BackgroundProcesses *bp - A pointer to the background arr.
-*              pid_t childPid - The PID to be added to the array.
-* Description: Adds a background process ID to the array.
+*    Function: exitCode()
+*  Parameters: struct ForegroundStatus *fs - A process status.
+* Description: Converts a process status into an exit status, as the shell
+*              reports it for $? and on exit. A terminating signal is reported
+*              as 128 plus the signal number.
+*     Returns: The exit status, or 0 if no process has been executed.
+*******************************************************************************/
+
+int exitCode(struct ForegroundStatus *fs) {
+    if (fs->statusNum == -1) {
+        return 0;
+    }
+    return fs->isSignal ? 128 + fs->statusNum : fs->statusNum;
+}
+
+/*******************************************************************************
+*    Function: elapsedSeconds()
+*  Parameters: struct timespec *start - A CLOCK_MONOTONIC time.
+* Description: Measures the wall time elapsed since a point in time.
+*     Returns: The elapsed time in seconds.
+*******************************************************************************/
+
+double elapsedSeconds(struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*******************************************************************************
+*    Function: addUsage()
+*  Parameters: struct ForegroundStatus *fs - The status receiving the usage.
+*              struct rusage *usage - The resources used by a process.
+* Description: Adds the resources used by a process to a status, so that a
+*              pipeline's status accounts for all of its processes. CPU times,
+*              faults, I/O and context switches are summed; the maximum
+*              resident set size is the largest of the processes.
 *     Returns: None.
 *******************************************************************************/
 
-void _addBackgroundProcess(struct BackgroundProcesses *bp, pid_t childPid) {
-    int i;
+void addUsage(struct ForegroundStatus *fs, struct rusage *usage) {
+    struct rusage *total = &fs->usage;
+
+    timeradd(&total->ru_utime, &usage->ru_utime, &total->ru_utime);
+    timeradd(&total->ru_stime, &usage->ru_stime, &total->ru_stime);
+    if (usage->ru_maxrss > total->ru_maxrss) {
+        total->ru_maxrss = usage->ru_maxrss;
+    }
+    total->ru_minflt += usage->ru_minflt;
+    total->ru_majflt += usage->ru_majflt;
+    total->ru_inblock += usage->ru_inblock;
+    total->ru_oublock += usage->ru_oublock;
+    total->ru_nvcsw += usage->ru_nvcsw;
+    total->ru_nivcsw += usage->ru_nivcsw;
+    fs->hasUsage = 1;
+}
+
+/*******************************************************************************
+*    Function: waitChild()
+*  Parameters: pid_t pid - The child to wait for, or -1 for any child.
+*              int options - The waitpid() options.
+*              struct ForegroundStatus *status - Receives the exit status of a
+*                                                terminated child, and its
+*                                                resource usage is added.
+* Description: Waits for a child with wait4(), which reports the resources the
+*              child used along with its status.
+*     Returns: The PID of the child, 0 if WNOHANG was given and no child has
+*              changed state, or -1 on error with errno set.
+*******************************************************************************/
+
+pid_t waitChild(pid_t pid, int options, struct ForegroundStatus *status) {
+    struct rusage usage;
+    pid_t child;
+    int result;
 
-    /* If the array is full, exit with an error. */
-    if (bp->size >= NUM_BACKGROUND_PIDS) {
-        fprintf(stderr, "Warning: %d background processes already running\n",
-                NUM_BACKGROUND_PIDS);
+    if ((child = wait4(pid, &result, options, &usage)) > 0) {
+        informStatus(child, result, status);
+        if (WIFEXITED(result) || WIFSIGNALED(result)) {
+            addUsage(status, &usage);
+        }
+    }
+    return child;
+}
+
+/*******************************************************************************
+*    Function: addBackgroundProcess()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              pid_t childPid - The PID to be added to the table.
+*              pid_t pgid - The process group of the job.
+*              int jobId - The job the process belongs to.
+*              char *command - The command line of the job. It is copied.
+* Description: Adds a background process to the table, doubling the table if
+*              it is full.
+*     Returns: The slot of the process, or -1 if it couldn't be added.
+*******************************************************************************/
+
+int addBackgroundProcess(struct BackgroundProcesses *bp, pid_t childPid,
+                         pid_t pgid, int jobId, char *command) {
+    struct BackgroundProcess *proc;
+    int slot, bucket;
+
+    /* If the table is full, grow it. If that fails, display a warning, but
+     * keep the shell running.
+     */
+    if (bp->freeHead == -1 &&
+        _allocBackgroundSlots(bp, bp->capacity * 2) == -1) {
+        fprintf(stderr, "Warning: unable to track background pid %d\n",
+                childPid);
         fflush(stderr);
+        return -1;
+    }
+
+    /* Take a slot from the free list and link it into the hash table. */
+    slot = bp->freeHead;
+    proc = &bp->slots[slot];
+    bp->freeHead = proc->hashNext;
+
+    proc->pid = childPid;
+    proc->pgid = pgid;
+    proc->jobId = jobId;
+    proc->cgroupId = -1;
+    proc->command = strdup(command);
+    clock_gettime(CLOCK_MONOTONIC, &proc->startTime);
+
+    bucket = childPid & (bp->capacity - 1);
+    proc->hashNext = bp->buckets[bucket];
+    bp->buckets[bucket] = slot;
+    bp->size++;
+    return slot;
+}
+
+/*******************************************************************************
+*    Function: findBackgroundProcess()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              pid_t pid - The PID to be found.
+* Description: Finds the slot of a background process.
+*     Returns: The slot of the process, or -1 if it isn't in the table.
+*******************************************************************************/
+
+int findBackgroundProcess(struct BackgroundProcesses *bp, pid_t pid) {
+    int slot = bp->buckets[pid & (bp->capacity - 1)];
+
+    while (slot != -1 && bp->slots[slot].pid != pid) {
+        slot = bp->slots[slot].hashNext;
+    }
+    return slot;
+}
+
+/*******************************************************************************
+*    Function: removeBackgroundProcess()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              int slot - The slot of the process to be removed.
+* Description: Removes a background process from the table, returning its slot
+*              to the free list, and removes the job's cgroup once it is empty.
+*              Job IDs start over once the table is empty.
+*     Returns: None.
+*******************************************************************************/
+
+void removeBackgroundProcess(struct BackgroundProcesses *bp, int slot) {
+    struct BackgroundProcess *proc = &bp->slots[slot];
+    int *link = &bp->buckets[proc->pid & (bp->capacity - 1)];
+
+    /* Unlink the slot from its hash chain. */
+    while (*link != slot) {
+        link = &bp->slots[*link].hashNext;
+    }
+    *link = proc->hashNext;
+
+    if (proc->cgroupId != -1) {
+        removeJobCgroup(proc->cgroupId);
+    }
+    free(proc->command);
+    proc->command = NULL;
+    proc->pid = -1;
+    proc->hashNext = bp->freeHead;
+    bp->freeHead = slot;
+
+    if (--bp->size == 0) {
+        bp->nextJobId = 1;
+    }
+}
+
+/*******************************************************************************
+*    Function: findJobProcess()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              int jobId - The job ID.
+* Description: Finds a process of a background job by scanning the table.
+*     Returns: The slot of a process of the job, or -1 if none remains.
+*******************************************************************************/
+
+int findJobProcess(struct BackgroundProcesses *bp, int jobId) {
+    int slot;
+
+    for (slot = 0; slot < bp->capacity; slot++) {
+        if (bp->slots[slot].pid != -1 && bp->slots[slot].jobId == jobId) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+/*******************************************************************************
+*    Function: _commandText()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct of
+*                                       the first pipeline stage.
+* Description: Reconstructs the command line of a pipeline from its arguments.
+*     Returns: The allocated command line.
+*******************************************************************************/
+
+char *_commandText(struct CommandInfo *ci) {
+    struct CommandInfo *stage;
+    size_t len = 1;
+    int i;
+    char *text;
+
+    for (stage = ci; stage != NULL; stage = stage->next) {
+        for (i = 0; i < stage->numArgs; i++) {
+            len += strlen(stage->args[i]) + 1;
+        }
+        len += 3;
+    }
+    if ((text = malloc(len)) == NULL) {
+        perror("malloc");
         exit(1);
     }
-    /* Otherwise, iterate through the array until we find an empty element. */
-    for (i = 0; i < NUM_BACKGROUND_PIDS; i++) {
-        /* Add the PID and increase the array size */
-        if (bp->array[i] == -1) {
-            bp->array[i] = childPid;
-            bp->size++;
-            return;
+
+    text[0] = '\0';
+    for (stage = ci; stage != NULL; stage = stage->next) {
+        for (i = 0; i < stage->numArgs; i++) {
+            if (i > 0) {
+                strcat(text, " ");
+            }
+            strcat(text, stage->args[i]);
+        }
+        if (stage->next != NULL) {
+            strcat(text, " | ");
         }
     }
-    /* If we don't find an empty element at this point, display an error and exit.
+    return text;
+}
+
+/*******************************************************************************
+*    Function: _redirectFiles()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              int hasPipeIn - Set if a pipe precedes the stage.
+*              int hasPipeOut - Set if a pipe follows the stage.
+*              struct FileOpen *files - Receives the input and output files
+*                                       of the stage, to be opened.
+* Description: Determines the redirection files of a pipeline stage. If the
+*              command is in the background and neither a file nor a pipe is
+*              assigned, /dev/null is used. A stage without a file has a NULL
+*              path. Descriptors are close-on-exec.
+*     Returns: None.
+*******************************************************************************/
+
+void _redirectFiles(struct CommandInfo *ci, int hasPipeIn, int hasPipeOut,
+                    struct FileOpen *files) {
+    files[0].path = ci->inRedirFile;
+    files[0].flags = O_RDONLY | O_CLOEXEC;
+    files[0].mode = 0;
+    files[1].path = ci->outRedirFile;
+    files[1].flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    files[1].mode = 0777;
+
+    /* Determine input redirection. If the command is in the background,
+     * and there is no explicitly assigned file or pipe, set the input
+     * redirection file to /dev/null.
      */
-    fprintf(stderr, "Warning: unable to place background process in array.\n");
-    fflush(stderr);
-    exit(1);
+    if (files[0].path == NULL && !hasPipeIn && !ci->isForeground) {
+        files[0].path = "/dev/null";
+    }
+    /* Perform a similar operation for output redirection. */
+    if (files[1].path == NULL && !hasPipeOut && !ci->isForeground) {
+        files[1].path = "/dev/null";
+    }
 }
 
 /*******************************************************************************
-*    Function: handleNonBuiltIn()
+*    Function: _openFiles()
+*  Parameters: struct FileOpen *files - The files to be opened. Each file's fd
+*                                       is filled in.
+*              int count - The number of files.
+* Description: Opens a batch of redirection files.
+*     Returns: None.
+*******************************************************************************/
+
+void _openFiles(struct FileOpen *files, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        files[i].fd = files[i].path != NULL ?
+                      open(files[i].path, files[i].flags, files[i].mode) : -1;
+    }
+}
+
+/*******************************************************************************
+*    Function: _takeRedirects()
+*  Parameters: struct FileOpen *files - The opened input and output files of
+*                                       a stage.
+*              int pipeIn - The read end of the preceding pipe, or -1.
+*              int pipeOut - The write end of the following pipe, or -1.
+*              int *inFD - Receives the input descriptor, or -1.
+*              int *outFD - Receives the output descriptor, or -1.
+* Description: Determines the input and output descriptors of a pipeline
+*              stage from its opened files. Explicit redirection files take
+*              precedence over pipes. If either file couldn't be opened, an
+*              error is displayed and the other file is closed.
+*     Returns: 0 on success, -1 if a redirection file couldn't be opened.
+*******************************************************************************/
+
+int _takeRedirects(struct FileOpen *files, int pipeIn, int pipeOut,
+                   int *inFD, int *outFD) {
+    /* If a redirect file can't be opened, display an error. */
+    if (files[0].path != NULL && files[0].fd == -1) {
+        fprintf(stderr, "cannot open %s for input\n", files[0].path);
+        fflush(stderr);
+        if (files[1].fd != -1) {
+            close(files[1].fd);
+        }
+        return -1;
+    }
+    if (files[1].path != NULL && files[1].fd == -1) {
+        fprintf(stderr, "cannot open %s for output\n", files[1].path);
+        fflush(stderr);
+        if (files[0].fd != -1) {
+            close(files[0].fd);
+        }
+        return -1;
+    }
+
+    *inFD = files[0].path != NULL ? files[0].fd : pipeIn;
+    *outFD = files[1].path != NULL ? files[1].fd : pipeOut;
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: openRedirects()
 *  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
-*              struct ForegroundStatus *fs - A pointer to the foreground status.
-*              struct BackgroundProcesses *bp - A pointer to the background PID
-*                                               array.
-* Description: Handles redirection of input and output as well as fork() and 
-*              exec() operations for non-builtin commands.
+*              int pipeIn - The read end of the preceding pipe, or -1.
+*              int pipeOut - The write end of the following pipe, or -1.
+*              int *inFD - Receives the input descriptor, or -1.
+*              int *outFD - Receives the output descriptor, or -1.
+* Description: Determines the input and output descriptors of a pipeline
+*              stage, opening its redirection files in the parent, together,
+*              so that they can be handed to the spawn engine.
+*     Returns: 0 on success, -1 if a redirection file couldn't be opened.
+*******************************************************************************/
+
+int openRedirects(struct CommandInfo *ci, int pipeIn, int pipeOut,
+                   int *inFD, int *outFD) {
+    struct FileOpen files[2];
+
+    _redirectFiles(ci, pipeIn != -1, pipeOut != -1, files);
+    _openFiles(files, 2);
+    return _takeRedirects(files, pipeIn, pipeOut, inFD, outFD);
+}
+
+/*******************************************************************************
+*    Function: _launchStage()
+*  Parameters: struct SpawnRequest *req - The process to be launched. Its path
+*                                         is filled in by this function.
+* Description: Resolves a command through the path cache and launches it. If a
+*              cached path no longer executes, it is discarded and PATH is
+*              searched once more.
+*     Returns: The child PID on success, -1 on failure with errno set.
+*******************************************************************************/
+
+pid_t _launchStage(struct SpawnRequest *req) {
+    pid_t spawnPid = -1;
+    char *name = req->argv[0];
+
+    if ((req->path = lookupPath(name)) != NULL) {
+        spawnPid = spawnCommand(req);
+        if (spawnPid == -1 && req->path != name &&
+            (errno == ENOENT || errno == EACCES || errno == ENOEXEC)) {
+            invalidatePath(name);
+            if ((req->path = lookupPath(name)) != NULL) {
+                spawnPid = spawnCommand(req);
+            }
+        }
+    }
+    return spawnPid;
+}
+
+/*******************************************************************************
+*    Function: startStage()
+*  Parameters: struct CommandInfo *ci - A pointer to the stage's CommandInfo.
+*              int pipeIn - The read end of the preceding pipe, or -1.
+*              int pipeOut - The write end of the following pipe, or -1.
+*              struct FileOpen *files - The stage's redirection files, already
+*                                       opened, or NULL to open them here.
+*              pid_t pgid - The process group of the stage, as in
+*                           struct SpawnRequest.
+*              int cgroupFD - The cgroup of the stage, or -1.
+*              struct ForegroundStatus *fs - The last foreground status.
+*              struct BackgroundProcesses *bp - The background process table,
+*                                               or NULL to execute builtins
+*                                               as external commands.
+* Description: Handles redirection of input and output for a single pipeline
+*              stage and launches it through the spawn engine. A builtin,
+*              other than a builtin utility, is run by a forked copy of the
+*              shell instead. The parent's copies of any redirection files
+*              are closed afterwards; pipe descriptors are left to the caller.
+*     Returns: The child PID on success, -1 if the stage couldn't be started.
+*******************************************************************************/
+
+pid_t startStage(struct CommandInfo *ci, int pipeIn, int pipeOut,
+                 struct FileOpen *files, pid_t pgid, int cgroupFD,
+                 struct ForegroundStatus *fs, struct BackgroundProcesses *bp) {
+    struct BuiltinStage stage = {NULL, ci, fs, bp};
+    pid_t spawnPid;
+    struct SpawnRequest req;
+    struct timespec phaseStart;
+
+    /* The arguments array is already NULL-terminated, as exec() expects. */
+    req.argv = ci->args;
+    req.isForeground = ci->isForeground;
+    req.pgid = pgid;
+    req.cgroupFD = cgroupFD;
+    req.run = NULL;
+    req.runArg = NULL;
+    if (bp != NULL && (stage.builtin = findBuiltin(ci->args[0])) != NULL &&
+        !(stage.builtin->flags & BUILTIN_EXTERNAL)) {
+        req.path = ci->args[0];
+        req.run = runBuiltinStage;
+        req.runArg = &stage;
+    }
+
+    if (files != NULL) {
+        if (_takeRedirects(files, pipeIn, pipeOut, &req.inFD,
+                           &req.outFD) == -1) {
+            return -1;
+        }
+    } else {
+        STATS_START(phaseStart);
+        if (openRedirects(ci, pipeIn, pipeOut, &req.inFD, &req.outFD) == -1) {
+            return -1;
+        }
+        STATS_RECORD(STATS_REDIRECT, phaseStart);
+    }
+
+    STATS_START(phaseStart);
+    spawnPid = req.run != NULL ? spawnCommand(&req) : _launchStage(&req);
+    STATS_RECORD(STATS_SPAWN, phaseStart);
+    if (spawnPid == -1) {
+        perror(req.argv[0]);
+    }
+
+    if (req.inFD != pipeIn && req.inFD != -1) {
+        close(req.inFD);
+    }
+    if (req.outFD != pipeOut && req.outFD != -1) {
+        close(req.outFD);
+    }
+    return spawnPid;
+}
+
+/*******************************************************************************
+*    Function: launchPipeline()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct of
+*                                       the first pipeline stage.
+*              int pipeOut - The output of the last stage, or -1.
+*              int cgroupFD - The cgroup every stage starts in, or -1.
+*              pid_t *pids - Receives the PID of each stage.
+*              struct ForegroundStatus *stageStatus - Receives the initial
+*                                                     status of each stage.
+*              struct ForegroundStatus *fs - The last foreground status.
+*              struct BackgroundProcesses *bp - The background process table,
+*                                               as for startStage().
+* Description: Starts every stage of a pipeline. The redirection files of all
+*              stages are opened together before any stage starts. Each stage
+*              but the last writes into a new pipe whose read end becomes the
+*              input of the next stage. The parent closes its copies of both
+*              ends as soon as the stages holding them are started; pipeOut
+*              is left to the caller. A stage that can't be started has a PID
+*              of -1 and fails with an exit value of 1. A background pipeline
+*              gets a process group of its own, led by its first stage.
 *     Returns: None.
 *******************************************************************************/
 
-void handleNonBuiltIn(struct CommandInfo *ci, struct ForegroundStatus *fs,
-                      struct BackgroundProcesses *bp) {
-    pid_t spawnPid = -5;
-    int childExitMethod = -5;
-    int i, sourceFD, targetFD, status;
-    char *argList[ci->numArgs + 1];
+void launchPipeline(struct CommandInfo *ci, int pipeOut, int cgroupFD,
+                    pid_t *pids, struct ForegroundStatus *stageStatus,
+                    struct ForegroundStatus *fs,
+                    struct BackgroundProcesses *bp) {
+    struct CommandInfo *stage;
+    struct timespec phaseStart;
+    int i, numStages = 0, pipeIn = -1;
+    int pipeFDs[2];
+    pid_t pgid = ci->isForeground ? -1 : 0;
+
+    for (stage = ci; stage != NULL; stage = stage->next) {
+        numStages++;
+    }
+    struct FileOpen files[numStages * 2];
+
+    STATS_START(phaseStart);
+    for (i = 0, stage = ci; stage != NULL; i++, stage = stage->next) {
+        _redirectFiles(stage, i > 0, stage->next != NULL || pipeOut != -1,
+                       &files[i * 2]);
+    }
+    _openFiles(files, numStages * 2);
+    STATS_RECORD(STATS_REDIRECT, phaseStart);
+
+    for (i = 0, stage = ci; stage != NULL; i++, stage = stage->next) {
+        pipeFDs[0] = -1;
+        pipeFDs[1] = -1;
+        if (stage->next != NULL && pipe2(pipeFDs, O_CLOEXEC) == -1) {
+            perror("pipe2");
+        }
+
+        pids[i] = startStage(stage, pipeIn,
+                             stage->next != NULL ? pipeFDs[1] : pipeOut,
+                             &files[i * 2], pgid, cgroupFD, fs, bp);
+        initForegroundStatus(&stageStatus[i]);
+        if (pids[i] == -1) {
+            stageStatus[i].statusNum = 1;
+        } else if (pgid == 0) {
+            pgid = pids[i];
+        }
+
+        if (pipeIn != -1) {
+            close(pipeIn);
+        }
+        if (pipeFDs[1] != -1) {
+            close(pipeFDs[1]);
+        }
+        pipeIn = pipeFDs[0];
+    }
+}
+
+/*******************************************************************************
+*    Function: waitPipeline()
+*  Parameters: int numStages - The number of pipeline stages.
+*              pid_t *pids - The PID of each stage, -1 if it wasn't started.
+*              struct ForegroundStatus *stageStatus - The status of each stage.
+*              struct timespec *startTime - The time the pipeline started.
+*              struct ForegroundStatus *fs - Receives the pipeline status.
+* Description: Waits for every stage of a foreground pipeline. The status of
+*              the pipeline is that of its last stage or, if PIPEFAIL_FLAG is
+*              set, that of its last stage to fail, and its resource usage is
+*              that of all stages.
+*     Returns: None.
+*******************************************************************************/
+
+void waitPipeline(int numStages, pid_t *pids,
+                  struct ForegroundStatus *stageStatus,
+                  struct timespec *startTime, struct ForegroundStatus *fs) {
+    struct timespec phaseStart;
     sigset_t mask;
+    int i;
 
     /* Signals issued while a parent is waiting can affect the execution of
      * waitpid() and set the ForegroundStatus struct into an undefined 
      * state. We need to shield the parent from the signals below while
      * it is waiting for a foreground process to complete. We will use mask
-     * to shield against these signals.
+     * to shield against these signals. SIGCHLD is blocked permanently by
+     * initReaper().
      */
     sigemptyset(&mask);
-    sigaddset(&mask, SIGCHLD);
     sigaddset(&mask, SIGINT);
     sigaddset(&mask, SIGTSTP);
 
-    /* Set active arguments into the correct state for an execvp() call. */
-    for (i = 0; i < ci->numArgs; i++) {
-        argList[i] = ci->args[i]->value;
-    } 
-    /* Append a NULL argument to the list. */
-    argList[ci->numArgs] = NULL;
-
-    /* Fork off a child process */
-    spawnPid = fork();
-   
-    /* If an error occurred, display it and exit. */ 
-    if (spawnPid == -1) {
-        perror("fork");
-        exit(1);
-    /* If the PID is 0, we are in the child process. */
-    } else if (spawnPid == 0) {
-        /* Register child signal handlers depending on whether or not the command
-         * has been issued in the foreground.
+    STATS_START(phaseStart);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    for (i = 0; i < numStages; i++) {
+        if (pids[i] == -1) {
+            continue;
+        }
+        /* Record the stage status and resource usage. If waitpid()
+         * issued an error, display it.
          */
-        if (ci->isForeground) {
-            registerForegroundChildHandlers();
-        } else {
-            registerBackgroundChildHandlers();
+        if (waitChild(pids[i], WSTOPPED, &stageStatus[i]) == -1) {
+            perror("waitpid");
         }
+    }
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+    STATS_RECORD(STATS_WAIT, phaseStart);
 
-        /* Determine input redirection. If the command is in the background,
-         * and there is no explicitly assigned file, set the input 
-         * redirection file to /dev/null.
-         */
-        if (strlen(ci->inRedirFile) == 0 && !ci->isForeground) {
-            strcpy(ci->inRedirFile, "/dev/null");
+    /* Inform the ForegroundStatus struct of the pipeline status. The
+     * resource usage is that of the whole pipeline.
+     */
+    *fs = stageStatus[numStages - 1];
+    if (PIPEFAIL_FLAG) {
+        for (i = numStages - 1; i >= 0; i--) {
+            if (stageStatus[i].isSignal || stageStatus[i].statusNum != 0) {
+                *fs = stageStatus[i];
+                break;
+            }
         }
-        /* Perform a similar operation for output redirection. */
-        if (strlen(ci->outRedirFile) == 0 && !ci->isForeground) {
-            strcpy(ci->outRedirFile, "/dev/null");
+    }
+    memset(&fs->usage, 0, sizeof(fs->usage));
+    for (i = 0; i < numStages; i++) {
+        if (stageStatus[i].hasUsage) {
+            addUsage(fs, &stageStatus[i].usage);
         }
+    }
+    fs->wallSeconds = elapsedSeconds(startTime);
+}
 
-        /* Use dup2() to set the input redirection. */
-        if (strlen(ci->inRedirFile) != 0) {
-            /* If the redirect file can't be opened, exit with an error. */
-            if ((sourceFD = open(ci->inRedirFile, O_RDONLY)) == -1) {
-                fprintf(stderr, "cannot open %s for input\n", ci->inRedirFile);
-                fflush(stderr);
-                exit(1);
-            }
-            if (dup2(sourceFD, 0) == -1) {
-                perror("dup2");
-                exit(1);
-            }
-            close(sourceFD);
-        }
-        /* Use dup2() to set the output redirection. */
-        if (strlen(ci->outRedirFile) != 0) {
-            /* If the redirect file can't be opened, exit with an error. */
-            if ((targetFD = open(ci->outRedirFile, O_WRONLY | O_CREAT | O_TRUNC,
-                                 0777)) == -1) {
-                fprintf(stderr, "cannot open %s for output\n", ci->outRedirFile);
-                fflush(stderr);
-                exit(1);
-            }
-            if (dup2(targetFD, 1) == -1) {
-                perror("dup2");
-                exit(1);
-            }
-            close(targetFD);
-        }      
+/*******************************************************************************
+*    Function: handleNonBuiltIn()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct of
+*                                       the first pipeline stage.
+*              struct ForegroundStatus *fs - A pointer to the foreground status.
+*              struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+* Description: Launches every stage of a pipeline of non-builtin commands,
+*              connecting adjacent stages with pipes. All stages are running
+*              before any of them is waited for. A foreground pipeline is
+*              waited for, and a background pipeline becomes a job, in a
+*              cgroup of its own if job cgroups are enabled.
+*     Returns: None.
+*******************************************************************************/
 
-        /* Attempt to execvp() on the argument list. If it fails,  exit with 
-         * an error.
-         */
-        if (execvp(argList[0], argList) < 0) {
-            perror(argList[0]);
-            exit(1);
-        }
+void handleNonBuiltIn(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                      struct BackgroundProcesses *bp) {
+    struct CommandInfo *stage;
+    struct timespec startTime;
+    int i, slot, numStages = 0, cgroupFD = -1, cgroupId = -1;
+    char *commandText;
+    pid_t pgid = -1;
+
+    for (stage = ci; stage != NULL; stage = stage->next) {
+        numStages++;
+    }
+    pid_t pids[numStages];
+    struct ForegroundStatus stageStatus[numStages];
+
+    if (!ci->isForeground) {
+        cgroupFD = createJobCgroup(&cgroupId);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    launchPipeline(ci, -1, cgroupFD, pids, stageStatus, fs, bp);
+    if (cgroupFD != -1) {
+        close(cgroupFD);
     }
  
-    /* If the command is issued for a foreground process, wait for the 
-     * foreground process to terminate. Block out signals that might interfere 
-     * with this wait.
+    /* If the command is issued for a foreground process, wait for each 
+     * foreground process to terminate.
      */
     if (ci->isForeground) {
-        sigprocmask(SIG_BLOCK, &mask, NULL);
-        status = waitpid(spawnPid, &childExitMethod, WSTOPPED);
-        sigprocmask(SIG_UNBLOCK, &mask, NULL);
-
-        /* If waitpid() didn't issue an error, inform the ForegroundStatus
-         * struct.
-         */
-        if (status != -1) { 
-            informStatus(spawnPid, childExitMethod, fs);
-            /* If the child was terminated by signal, display the signal no.*/
-            if (WIFSIGNALED(childExitMethod)) {
-                executeStatus(fs);
-            }
-        /* Otherwise, display the error. */
-        } else {
-            perror("waitpid");
+        waitPipeline(numStages, pids, stageStatus, &startTime, fs);
+        /* If the child was terminated by signal, display the signal no.*/
+        if (fs->isSignal) {
+            executeStatus(NULL, fs, NULL);
         }
-    /* If the command is issued for a background process, print the PID and 
-     * add it to the BackgroundProcesses array.
+    /* If the command is issued for a background process, print the PID of
+     * the last stage and add every stage to the BackgroundProcesses array.
      */
     } else {
-        fprintf(stdout, "background pid id %d\n", spawnPid);
-        fflush(stdout);
-        _addBackgroundProcess(bp, spawnPid);
+        if (pids[numStages - 1] != -1) {
+            fprintf(stdout, "background pid id %d\n", pids[numStages - 1]);
+            fflush(stdout);
+            setLastBackground(pids[numStages - 1]);
+        }
+        /* The group is led by the first stage that started. */
+        commandText = _commandText(ci);
+        for (i = 0; i < numStages; i++) {
+            if (pids[i] != -1) {
+                if (pgid == -1) {
+                    pgid = pids[i];
+                }
+                slot = addBackgroundProcess(bp, pids[i], pgid, bp->nextJobId,
+                                            commandText);
+                if (slot != -1) {
+                    bp->slots[slot].cgroupId = cgroupId;
+                }
+            }
+        }
+        if (pgid == -1 && cgroupId != -1) {
+            removeJobCgroup(cgroupId);
+        }
+        bp->nextJobId++;
+        free(commandText);
+    }
+}
+
+/*******************************************************************************
+*    Function: initReaper()
+*  Parameters: None.
+* Description: Blocks SIGCHLD and opens a signalfd through which it is
+*              received instead. The descriptor becomes readable whenever a
+*              child changes state, so finished background processes can be
+*              reaped as they exit rather than when the next line is entered.
+*     Returns: None.
+*******************************************************************************/
+
+void initReaper() {
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+
+    if ((REAPER_FD = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) {
+        perror("signalfd");
     }
 }
 
+/*******************************************************************************
+*    Function: _announceDone()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              int slot - The slot of a reaped background process.
+*              struct ForegroundStatus *status - The status of the process. Its
+*                                                wall time is filled in.
+* Description: Displays the exit value of a finished background process and
+*              removes it from the table.
+*     Returns: None.
+*******************************************************************************/
+
+void _announceDone(struct BackgroundProcesses *bp, int slot,
+                   struct ForegroundStatus *status) {
+    status->wallSeconds = elapsedSeconds(&bp->slots[slot].startTime);
+    fprintf(stdout, "background pid %d is done: ", bp->slots[slot].pid);
+    fflush(stdout);
+    executeStatus(NULL, status, NULL);
+    removeBackgroundProcess(bp, slot);
+}
+
+/*******************************************************************************
+*    Function: _reapFinished()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              int atPrompt - Set if a prompt is displayed and awaiting input.
+* Description: Reaps every child that has finished with nonblocking wait4()
+*              on any child, so the cost depends on the number of finished
+*              processes rather than the number of background processes. The
+*              exit value of each finished background process is displayed.
+*              If a prompt is awaiting input, the notices are placed on their
+*              own lines.
+*     Returns: The number of background processes reaped.
+*******************************************************************************/
+
+int _reapFinished(struct BackgroundProcesses *bp, int atPrompt) {
+    int slot;
+    int numReaped = 0;
+    pid_t pid;
+    struct signalfd_siginfo info;
+    struct ForegroundStatus status;
+
+    /* Drain the pending SIGCHLD notifications. Several exits may have been
+     * coalesced into one, so the notifications aren't counted.
+     */
+    if (REAPER_FD != -1) {
+        while (read(REAPER_FD, &info, sizeof(info)) == sizeof(info)) {
+            /* Do nothing... */
+        }
+    }
+
+    /* Reap each finished child. */
+    initForegroundStatus(&status);
+    while ((pid = waitChild(-1, WNOHANG, &status)) > 0) {
+        /* Find its entry in the table. */
+        if ((slot = findBackgroundProcess(bp, pid)) == -1) {
+            initForegroundStatus(&status);
+            continue;
+        }
+        if (atPrompt && numReaped == 0) {
+            fprintf(stdout, "\n");
+        }
+        _announceDone(bp, slot, &status);
+        initForegroundStatus(&status);
+        numReaped++;
+    }
+    return numReaped;
+}
+
+/*******************************************************************************
+*    Function: reapBackground()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              pid_t pid - The background process to wait for, or -1 for any.
+*              int *jobId - Receives the job ID of the reaped process.
+*              struct ForegroundStatus *status - Receives the status, resource
+*                                                usage and wall time of the
+*                                                reaped process.
+* Description: Blocks in wait4() until a background process terminates, then
+*              announces it and removes it from the table, as the reaper does.
+*     Returns: The reaped PID, or -1 with errno set to EINTR if a signal
+*              interrupted the wait, or ECHILD if there is no such child.
+*******************************************************************************/
+
+pid_t reapBackground(struct BackgroundProcesses *bp, pid_t pid, int *jobId,
+                     struct ForegroundStatus *status) {
+    pid_t reaped;
+    int slot;
+
+    /* Children missing from the table (whose addition failed) are skipped. */
+    do {
+        initForegroundStatus(status);
+        if ((reaped = waitChild(pid, 0, status)) == -1) {
+            return -1;
+        }
+    } while ((slot = findBackgroundProcess(bp, reaped)) == -1 && pid == -1);
+
+    *jobId = -1;
+    if (slot != -1) {
+        *jobId = bp->slots[slot].jobId;
+        _announceDone(bp, slot, status);
+    }
+    return reaped;
+}
+
 /*******************************************************************************
 *    Function: backgroundCleanup()
-*  Parameters: struct BackgroundProcesses *bp - A pointer to the background PID
-*                                               array.
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
 * Description: Attempts to clean up background processes with nonblocking
 *              waitpid().
 *     Returns: None.
 *******************************************************************************/
 
 void backgroundCleanup(struct BackgroundProcesses * bp) {
-    int i, status;
-    /* Use a ForegroundProcess struct to get the exit status of background
-     * processes that we can clean up.
+    _reapFinished(bp, 0);
+}
+
+/*******************************************************************************
+*    Function: _jobGroups()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              pid_t *pgids - Receives the process groups.
+* Description: Collects the process group of every background job. A group is
+*              taken from its leader's slot or, once the leader is gone, from
+*              the slots of the job's other processes, which are rare enough
+*              to be checked for duplicates one by one.
+*     Returns: The number of process groups.
+*******************************************************************************/
+
+int _jobGroups(struct BackgroundProcesses *bp, pid_t *pgids) {
+    struct BackgroundProcess *proc;
+    int slot, i, numGroups = 0;
+
+    for (slot = 0; slot < bp->capacity; slot++) {
+        proc = &bp->slots[slot];
+        if (proc->pid == -1 || (proc->pid != proc->pgid &&
+                                findBackgroundProcess(bp, proc->pgid) != -1)) {
+            continue;
+        }
+        for (i = 0; proc->pid != proc->pgid && i < numGroups &&
+                    pgids[i] != proc->pgid; i++) {
+            /* Do nothing... */
+        }
+        if (proc->pid == proc->pgid || i == numGroups) {
+            pgids[numGroups++] = proc->pgid;
+        }
+    }
+    return numGroups;
+}
+
+/*******************************************************************************
+*    Function: terminateBackground()
+*  Parameters: struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              int graceMs - How long to wait for the jobs to finish, in
+*                            milliseconds.
+* Description: Terminates every background job. SIGTERM is sent to all of the
+*              jobs' process groups together, followed by SIGCONT so that
+*              stopped processes can act on it. The processes are then waited
+*              for concurrently, by polling a pidfd for each (or the SIGCHLD
+*              descriptor where pidfds are unavailable), until they have all
+*              finished or the grace period has passed. Jobs with processes
+*              left are reported, and every group is then sent SIGKILL. Every
+*              process is announced as it is reaped.
+*     Returns: The number of jobs that had to be killed.
+*******************************************************************************/
+
+int terminateBackground(struct BackgroundProcesses *bp, int graceMs) {
+    struct BackgroundProcess *proc;
+    struct ForegroundStatus status;
+    struct timespec start;
+    int slot, i, jobId, numFDs = 0, numGroups, numKilled = 0, timeout;
+    int size = bp->size > 0 ? bp->size : 1;
+    pid_t pgids[size];
+    struct pollfd fds[size];
+
+    if (bp->size == 0) {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    numGroups = _jobGroups(bp, pgids);
+    for (i = 0; i < numGroups; i++) {
+        killpg(pgids[i], SIGTERM);
+        killpg(pgids[i], SIGCONT);
+    }
+
+    for (slot = 0; slot < bp->capacity; slot++) {
+        if (bp->slots[slot].pid != -1) {
+            fds[numFDs].fd = syscall(SYS_pidfd_open, bp->slots[slot].pid, 0);
+            if (fds[numFDs].fd == -1) {
+                fds[numFDs].fd = REAPER_FD;
+            }
+            fds[numFDs].events = POLLIN;
+            numFDs++;
+        }
+    }
+
+    /* Reap the processes as they finish. A pidfd stays readable once its
+     * process has finished, so it is closed and dropped from the set.
      */
-    struct ForegroundStatus processStat;
-    initForegroundStatus(&processStat);
-
-    /* Iterate through the array... */
-    for (i = 0; i < NUM_BACKGROUND_PIDS; i++) {
-        /* If we find a PID, call nonblocking waitpid(). */
-        if (bp->array[i] != -1) {
-            /* If it returns with a positive status, we have 
-             * terminated a process. In this case, print its exit value.
-             */
-            if (waitpid(bp->array[i], &status, WNOHANG) > 0) {
-                fprintf(stdout, "background pid %d is done: ", bp->array[i]);
+    _reapFinished(bp, 0);
+    while (bp->size > 0 &&
+           (timeout = graceMs - elapsedSeconds(&start) * 1000) > 0) {
+        if (poll(fds, numFDs, timeout) == -1 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        for (i = 0; i < numFDs; i++) {
+            if (fds[i].revents != 0 && fds[i].fd != REAPER_FD) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+            }
+        }
+        _reapFinished(bp, 0);
+    }
+    for (i = 0; i < numFDs; i++) {
+        if (fds[i].fd != -1 && fds[i].fd != REAPER_FD) {
+            close(fds[i].fd);
+        }
+    }
+
+    /* Jobs with processes left are reported. Every group is then killed,
+     * which also reaches processes the jobs started themselves.
+     */
+    for (slot = 0; slot < bp->capacity; slot++) {
+        proc = &bp->slots[slot];
+        if (proc->pid != -1 && (proc->pid == proc->pgid ||
+                                findBackgroundProcess(bp, proc->pgid) == -1)) {
+            fprintf(stderr, "Warning: Job %d didn't exit within %d ms, "
+                            "sending SIGKILL to process group %d\n",
+                    proc->jobId, graceMs, proc->pgid);
+            fflush(stderr);
+            numKilled++;
+        }
+    }
+    for (i = 0; i < numGroups; i++) {
+        killpg(pgids[i], SIGKILL);
+    }
+    while (bp->size > 0 && (reapBackground(bp, -1, &jobId, &status) != -1 ||
+                            errno == EINTR)) {
+        /* Do nothing... */
+    }
+    return numKilled;
+}
+
+/*******************************************************************************
+*    Function: waitForInput()
+*  Parameters: struct LineReader *reader - The reader of standard input.
+*              struct BackgroundProcesses *bp - A pointer to the background
+*                                               process table.
+*              char *prompt - The displayed prompt.
+* Description: Blocks in the event loop until input arrives. Background
+*              processes that finish in the meantime are reaped and announced
+*              immediately, after which the prompt is displayed again.
+*     Returns: 0 once input has arrived, -1 if interrupted by a signal.
+*******************************************************************************/
+
+int waitForInput(struct LineReader *reader, struct BackgroundProcesses *bp,
+                 char *prompt) {
+    int events;
+
+    while (1) {
+        if ((events = waitEvents(reader)) == -1) {
+            return -1;
+        }
+        if (events & EVENT_CHILD) {
+            if (_reapFinished(bp, 1) > 0) {
+                fprintf(stdout, "%s ", prompt);
                 fflush(stdout);
-                informStatus(bp->array[i], status, &processStat);
-                executeStatus(&processStat);
-                bp->array[i] = -1;
             }
         }
+        if (events & EVENT_INPUT) {
+            return 0;
+        }
     }
 }
 
@@ -279,11 +1139,13 @@ void informStatus(pid_t pid, int result, struct ForegroundStatus *status) {
 *    Function: catchSIGINT()
 *  Parameters: int signo - The signal number.
 * Description: The signal handler function for the shell process. Its primary
-*              purpose is to prevent the shell from terminating on SIGINT.
+*              purpose is to prevent the shell from terminating on SIGINT. It
+*              also sets INTERRUPT_FLAG, which stops a running loop.
 *     Returns: None.
 *******************************************************************************/
 
 void catchSIGINT(int signo) {
+    INTERRUPT_FLAG = 1;
     /* Output a newline */
     puts("");
 }
@@ -9,19 +9,47 @@
 #ifndef SIGNAL_PROC_H
 #define SIGNAL_PROC_H
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "cgroup.h"
+#include "event_loop.h"
 #include "input.h"
+#include "path_cache.h"
+#include "shell_stats.h"
+#include "variables.h"
+#include "spawn_proc.h"
+
+/* Initial number of slots in the background process table. The table doubles
+ * whenever it is full. Must be a power of two.
+ */
+#define BACKGROUND_INIT_SIZE 64
+
+/* Environment variable that sets how long exit waits, in milliseconds, for
+ * background jobs to finish after SIGTERM before sending them SIGKILL, and the
+ * default wait.
+ */
+#define EXIT_GRACE_ENV "SHELL_EXIT_GRACE"
+#define EXIT_GRACE_MS  1000
 
-/* Maximum number of background processes */
-#define NUM_BACKGROUND_PIDS 64
 /* Global foreground-only flag declaration. Necessary for SIGTSTP signal handler
  */
 extern int FOREGROUND_FLAG;
+/* Global pipefail flag declaration. Set with the set builtin. */
+extern int PIPEFAIL_FLAG;
+/* The signalfd through which SIGCHLD is received. */
+extern int REAPER_FD;
+/* Set when the shell receives SIGINT. */
+extern volatile sig_atomic_t INTERRUPT_FLAG;
 
 /* A struct to contain the status of the foreground process. Note that this struct
  * can be used to capture the status of any process, so its name is a candidate
@@ -30,26 +58,82 @@ extern int FOREGROUND_FLAG;
 struct ForegroundStatus {
     int statusNum;
     int isSignal;
+    /* Resources used by the process, summed over a pipeline's processes.
+     * They are only valid if hasUsage is set.
+     */
+    int    hasUsage;
+    double wallSeconds;
+    struct rusage usage;
+};
+
+/* A struct to hold one redirection file of a pipeline stage. fd receives the
+ * descriptor, or -1. A NULL path is skipped.
+ */
+struct FileOpen {
+    char  *path;
+    int    flags;
+    mode_t mode;
+    int    fd;
+};
+
+/* A struct to hold a single background process. A pipeline is one job, so
+ * all of its processes share a job ID, a process group, and the job cgroup
+ * identified by cgroupId, which is -1 if the job wasn't placed in one. While
+ * a slot is free, hashNext links it into the free list instead of a hash
+ * chain.
+ */
+struct BackgroundProcess {
+    pid_t pid;
+    pid_t pgid;
+    int   jobId;
+    int   cgroupId;
+    char *command;
+    struct timespec startTime;
+    int   hashNext;
 };
 
-/* A struct to hold background process IDs. When using it to add and wait for
- * processes, the entire array of processes must be iterated through because
- * there isn't a guarantee that a given process will terminate before another.
- * This struct is a candidate for refactoring because a linked list might
- * better represent the concept of the PID list. That is, additions can be
- * made in constant time, individual deletions occur in constant time, and
- * we only need to check the list nodes rather than all elements of an array.
+/* A struct to hold the background process table. Slots are taken from and
+ * returned to a free list, and a slot is found from its PID through a hash
+ * table of chains, so additions, lookups and removals take constant time
+ * regardless of the number of processes. A PID of -1 marks a free slot.
  */
 struct BackgroundProcesses {
-    pid_t array[NUM_BACKGROUND_PIDS];
-    int size;
+    struct BackgroundProcess *slots;
+    int  *buckets;
+    int   capacity;
+    int   size;
+    int   freeHead;
+    int   nextJobId;
 };
 
 void initBackgroundProcesses(struct BackgroundProcesses *);
+void freeBackgroundProcesses(struct BackgroundProcesses *);
+int addBackgroundProcess(struct BackgroundProcesses *, pid_t, pid_t, int,
+                         char *);
+int findBackgroundProcess(struct BackgroundProcesses *, pid_t);
+void removeBackgroundProcess(struct BackgroundProcesses *, int);
+int findJobProcess(struct BackgroundProcesses *, int);
 void initForegroundStatus(struct ForegroundStatus *);
+double elapsedSeconds(struct timespec *);
+int exitCode(struct ForegroundStatus *);
+void addUsage(struct ForegroundStatus *, struct rusage *);
+pid_t waitChild(pid_t, int, struct ForegroundStatus *);
+void launchPipeline(struct CommandInfo *, int, int, pid_t *,
+                    struct ForegroundStatus *, struct ForegroundStatus *,
+                    struct BackgroundProcesses *);
+void waitPipeline(int, pid_t *, struct ForegroundStatus *, struct timespec *,
+                  struct ForegroundStatus *);
 void handleNonBuiltIn(struct CommandInfo *, struct ForegroundStatus *,
                       struct BackgroundProcesses *);
+void initReaper();
 void backgroundCleanup(struct BackgroundProcesses *);
+int terminateBackground(struct BackgroundProcesses *, int);
+pid_t reapBackground(struct BackgroundProcesses *, pid_t, int *,
+                     struct ForegroundStatus *);
+int waitForInput(struct LineReader *, struct BackgroundProcesses *, char *);
+int openRedirects(struct CommandInfo *, int, int, int *, int *);
+pid_t startStage(struct CommandInfo *, int, int, struct FileOpen *, pid_t,
+                 int, struct ForegroundStatus *, struct BackgroundProcesses *);
 void informStatus(pid_t, int, struct ForegroundStatus *);
 
 void catchSIGINT(int);
@@ -59,6 +143,7 @@ void registerForegroundChildHandlers();
 void registerBackgroundChildHandlers();
 
 /* Forward declaration of the executeStatus() builtin function. */
-void executeStatus(struct ForegroundStatus *);
+int executeStatus(struct CommandInfo *, struct ForegroundStatus *,
+                  struct BackgroundProcesses *);
 
 #endif
@@ -0,0 +1,768 @@
+/*******************************************************************************
+*      Filename: spawn_proc.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the spawn engines used to launch non-builtin
+*                commands: a posix_spawn() path that expresses redirects and
+*                signal dispositions as file actions and spawn attributes, and
+*                the classic fork() path which is kept as a fallback, and a
+*                fork server which launches commands on the shell's behalf
+*                from a small helper process. Also contains per-engine spawn
+*                latency accounting.
+*******************************************************************************/
+
+#include "spawn_proc.h"
+
+/* Global spawn engine selection. */
+int SPAWN_MODE = SPAWN_POSIX;
+
+/* The shell's end of the fork server socket, or -1 if no server runs, and
+ * the process that started the server, whose children it creates.
+ */
+int SERVER_FD = -1;
+pid_t SERVER_OWNER = -1;
+
+/* Spawn latency accumulated for each engine. */
+struct SpawnStats SPAWN_STATS[NUM_SPAWN_MODES];
+
+/*******************************************************************************
+*    Function: _spawnPosix()
+*  Parameters: struct SpawnRequest *req - The process to be launched.
+* Description: Launches a process with posix_spawn(), or posix_spawnp() if
+*              the path hasn't been resolved. Redirects are expressed as dup2()
+*              file actions. The signal dispositions that the fork() path sets
+*              in the child are produced by temporarily ignoring the
+*              corresponding signals in the parent (ignored dispositions are
+*              inherited across exec(), handled ones are reset to default).
+*              SIGINT and SIGTSTP are blocked for that window so that the
+*              shell's own handlers never miss a signal. The process group is
+*              set with POSIX_SPAWN_SETPGROUP.
+*     Returns: The child PID on success, -1 on failure with errno set.
+*******************************************************************************/
+
+pid_t _spawnPosix(struct SpawnRequest *req) {
+    pid_t spawnPid = -1;
+    int err;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    struct sigaction ignoreAction = {0};
+    struct sigaction oldINT, oldTSTP;
+    sigset_t mask, oldMask, childMask, defaults;
+
+    /* Express the redirects as file actions. The source descriptors are
+     * close-on-exec, so only the dup2() targets survive in the child.
+     */
+    posix_spawn_file_actions_init(&actions);
+    if (req->inFD != -1) {
+        posix_spawn_file_actions_adddup2(&actions, req->inFD, 0);
+    }
+    if (req->outFD != -1) {
+        posix_spawn_file_actions_adddup2(&actions, req->outFD, 1);
+    }
+
+    /* Shield the shell from SIGINT and SIGTSTP while its dispositions are
+     * being altered for the child.
+     */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTSTP);
+    sigprocmask(SIG_BLOCK, &mask, &oldMask);
+
+    /* The child starts with the shell's original signal mask, except that
+     * SIGCHLD, which the shell keeps blocked for its signalfd, is unblocked.
+     * SIGINT is explicitly reset to its default action for foreground
+     * children.
+     */
+    childMask = oldMask;
+    sigdelset(&childMask, SIGCHLD);
+    sigemptyset(&defaults);
+    if (req->isForeground) {
+        sigaddset(&defaults, SIGINT);
+    }
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &childMask);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    if (req->pgid != -1) {
+        posix_spawnattr_setpgroup(&attr, req->pgid);
+    }
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK |
+                                    POSIX_SPAWN_SETSIGDEF |
+                                    (req->pgid != -1 ? POSIX_SPAWN_SETPGROUP :
+                                                       0));
+
+    /* Both foreground and background children ignore SIGTSTP. Background
+     * children also ignore SIGINT.
+     */
+    ignoreAction.sa_handler = SIG_IGN;
+    sigaction(SIGTSTP, &ignoreAction, &oldTSTP);
+    if (!req->isForeground) {
+        sigaction(SIGINT, &ignoreAction, &oldINT);
+    }
+
+    if (req->path != NULL) {
+        err = posix_spawn(&spawnPid, req->path, &actions, &attr, req->argv,
+                          environ);
+    } else {
+        err = posix_spawnp(&spawnPid, req->argv[0], &actions, &attr,
+                           req->argv, environ);
+    }
+
+    /* Restore the shell's handlers before any pending signal is delivered. */
+    sigaction(SIGTSTP, &oldTSTP, NULL);
+    if (!req->isForeground) {
+        sigaction(SIGINT, &oldINT, NULL);
+    }
+    sigprocmask(SIG_SETMASK, &oldMask, NULL);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return spawnPid;
+}
+
+/*******************************************************************************
+*    Function: _forkInto()
+*  Parameters: int cgroupFD - The directory of a cgroup, or -1.
+* Description: Creates a child process as fork() does. With a cgroup, the
+*              child is created in it by clone3(CLONE_INTO_CGROUP), so it is
+*              never counted against the shell's cgroup. Where clone3() lacks
+*              CLONE_INTO_CGROUP, the child moves itself into the cgroup by
+*              writing to cgroup.procs; if that fails, it stays in the
+*              shell's cgroup.
+*     Returns: As fork().
+*******************************************************************************/
+
+pid_t _forkInto(int cgroupFD) {
+    struct clone_args args;
+    pid_t spawnPid;
+    int procsFD;
+
+    if (cgroupFD == -1) {
+        return fork();
+    }
+    memset(&args, 0, sizeof(args));
+    args.flags = CLONE_INTO_CGROUP;
+    args.exit_signal = SIGCHLD;
+    args.cgroup = cgroupFD;
+    if ((spawnPid = syscall(SYS_clone3, &args, sizeof(args))) != -1 ||
+        (errno != ENOSYS && errno != EINVAL && errno != E2BIG)) {
+        return spawnPid;
+    }
+
+    if ((spawnPid = fork()) == 0) {
+        procsFD = openat(cgroupFD, "cgroup.procs", O_WRONLY | O_CLOEXEC);
+        if (procsFD == -1 || write(procsFD, "0", 1) == -1) {
+            perror("cgroup.procs");
+        }
+        if (procsFD != -1) {
+            close(procsFD);
+        }
+    }
+    return spawnPid;
+}
+
+/*******************************************************************************
+*    Function: _spawnFork()
+*  Parameters: struct SpawnRequest *req - The process to be launched.
+* Description: Launches a process with fork() and execv(), or execvp() if the
+*              path hasn't been resolved. All of the child's setup is performed
+*              in the child after the fork. The process group is set by both
+*              the child and the parent, so that it is in place before either
+*              of them continues. A child with a cgroup is created in it. A
+*              child that runs a function keeps SIGCHLD blocked, as the shell
+*              does, since it may wait for children of its own.
+*     Returns: The child PID on success, -1 if fork() failed.
+*******************************************************************************/
+
+pid_t _spawnFork(struct SpawnRequest *req) {
+    pid_t spawnPid = _forkInto(req->cgroupFD);
+    sigset_t mask;
+
+    /* If the PID is 0, we are in the child process. */
+    if (spawnPid == 0) {
+        /* Unblock SIGCHLD, which the shell keeps blocked for its signalfd. */
+        if (req->run == NULL) {
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGCHLD);
+            sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        }
+
+        if (req->pgid != -1 && setpgid(0, req->pgid) == -1) {
+            perror("setpgid");
+            exit(1);
+        }
+
+        /* Register child signal handlers depending on whether or not the
+         * command has been issued in the foreground.
+         */
+        if (req->isForeground) {
+            registerForegroundChildHandlers();
+        } else {
+            registerBackgroundChildHandlers();
+        }
+
+        /* Use dup2() to set the input and output redirection. */
+        if (req->inFD != -1 && dup2(req->inFD, 0) == -1) {
+            perror("dup2");
+            exit(1);
+        }
+        if (req->outFD != -1 && dup2(req->outFD, 1) == -1) {
+            perror("dup2");
+            exit(1);
+        }
+
+        if (req->run != NULL) {
+            _exit(req->run(req->runArg));
+        }
+
+        /* Attempt to exec() the argument list. If it fails, exit with an
+         * error.
+         */
+        if (req->path != NULL) {
+            execv(req->path, req->argv);
+        } else {
+            execvp(req->argv[0], req->argv);
+        }
+        perror(req->argv[0]);
+        exit(1);
+    }
+
+    /* The child may already have exec()ed, in which case the call fails
+     * harmlessly.
+     */
+    if (spawnPid > 0 && req->pgid != -1) {
+        setpgid(spawnPid, req->pgid == 0 ? spawnPid : req->pgid);
+    }
+    return spawnPid;
+}
+
+/*******************************************************************************
+*    Function: _startServer()
+*  Parameters: None.
+* Description: Starts the fork server: the shell's own executable, run afresh
+*              so that its memory holds none of the shell's state. It is
+*              connected to the shell by a SOCK_SEQPACKET socket pair on its
+*              standard input, and is started as a background process so that
+*              it ignores SIGINT and SIGTSTP.
+*     Returns: 0 on success, -1 on failure with errno set.
+*******************************************************************************/
+
+int _startServer() {
+    char *argv[] = {FORK_SERVER_EXE, FORK_SERVER_FLAG, NULL};
+    struct SpawnRequest req = {argv, FORK_SERVER_EXE, -1, -1, 0, -1, -1};
+    int fds[2], size = FORK_SERVER_MSG_MAX;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1) {
+        return -1;
+    }
+    /* Let requests up to the maximum size through, as far as the system
+     * allows.
+     */
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    req.inFD = fds[1];
+    if (_spawnPosix(&req) == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    close(fds[1]);
+    SERVER_FD = fds[0];
+    SERVER_OWNER = getpid();
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _stopServer()
+*  Parameters: None.
+* Description: Disconnects from the fork server, which exits once it reads the
+*              end of its input. It is reaped as any other child.
+*     Returns: None.
+*******************************************************************************/
+
+void _stopServer() {
+    if (SERVER_FD != -1) {
+        close(SERVER_FD);
+        SERVER_FD = -1;
+    }
+}
+
+/*******************************************************************************
+*    Function: _packStrings()
+*  Parameters: char *dest - The buffer, or NULL to only measure the strings.
+*              char **strings - A NULL-terminated array of strings.
+*              int *count - Receives the number of strings.
+* Description: Copies an array of strings into a buffer, one after the other,
+*              each with its terminating NUL.
+*     Returns: The number of bytes the strings occupy.
+*******************************************************************************/
+
+size_t _packStrings(char *dest, char **strings, int *count) {
+    size_t len, total = 0;
+    int i;
+
+    for (i = 0; strings[i] != NULL; i++) {
+        len = strlen(strings[i]) + 1;
+        if (dest != NULL) {
+            memcpy(dest + total, strings[i], len);
+        }
+        total += len;
+    }
+    *count = i;
+    return total;
+}
+
+/*******************************************************************************
+*    Function: _spawnServer()
+*  Parameters: struct SpawnRequest *req - The process to be launched.
+* Description: Launches a process through the fork server, starting the server
+*              first if needed. The request carries the working directory, the
+*              path, the arguments and the environment, with the process's
+*              standard input, output and error passed as SCM_RIGHTS. The
+*              server creates the process as a child of the shell, so it is
+*              waited for like any other. A forked copy of the shell can't use
+*              the server it inherited, whose processes would be children of
+*              the original shell.
+*     Returns: The child PID on success, -1 on failure with errno set. errno is
+*              ENOSYS if the server couldn't take the request, in which case
+*              nothing was launched.
+*******************************************************************************/
+
+pid_t _spawnServer(struct SpawnRequest *req) {
+    struct ServerRequest header;
+    struct ServerReply reply;
+    char cwd[PATH_MAX];
+    size_t cwdLen, pathLen = 0, size;
+    char *buffer, *c;
+    int fds[FORK_SERVER_NUM_FDS];
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov;
+    struct msghdr msg = {0};
+    struct cmsghdr *cmsg;
+    ssize_t result;
+
+    if ((SERVER_FD != -1 && SERVER_OWNER != getpid()) ||
+        (SERVER_FD == -1 && _startServer() == -1) ||
+        getcwd(cwd, sizeof(cwd)) == NULL) {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    /* Measure, then pack, the request. */
+    header.isForeground = req->isForeground;
+    header.pgid = req->pgid;
+    header.hasPath = req->path != NULL;
+    cwdLen = strlen(cwd) + 1;
+    if (req->path != NULL) {
+        pathLen = strlen(req->path) + 1;
+    }
+    size = sizeof(header) + cwdLen + pathLen +
+           _packStrings(NULL, req->argv, &header.numArgs) +
+           _packStrings(NULL, environ, &header.numEnv);
+    if (size > FORK_SERVER_MSG_MAX) {
+        errno = ENOSYS;
+        return -1;
+    }
+    if ((buffer = malloc(size)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(buffer, &header, sizeof(header));
+    c = buffer + sizeof(header);
+    memcpy(c, cwd, cwdLen);
+    c += cwdLen;
+    if (req->path != NULL) {
+        memcpy(c, req->path, pathLen);
+        c += pathLen;
+    }
+    c += _packStrings(c, req->argv, &header.numArgs);
+    _packStrings(c, environ, &header.numEnv);
+
+    /* Attach the standard streams of the process. Streams that aren't
+     * redirected are the shell's own.
+     */
+    fds[0] = req->inFD != -1 ? req->inFD : 0;
+    fds[1] = req->outFD != -1 ? req->outFD : 1;
+    fds[2] = 2;
+    iov.iov_base = buffer;
+    iov.iov_len = size;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    do {
+        result = sendmsg(SERVER_FD, &msg, MSG_NOSIGNAL);
+    } while (result == -1 && errno == EINTR);
+    free(buffer);
+    if (result == -1) {
+        /* The request wasn't delivered. A server that has gone away is
+         * restarted on the next request.
+         */
+        if (errno != EMSGSIZE) {
+            _stopServer();
+        }
+        errno = ENOSYS;
+        return -1;
+    }
+
+    /* Once the request is delivered, the process may exist, so a lost reply
+     * is an error rather than a reason to launch it again.
+     */
+    do {
+        result = recv(SERVER_FD, &reply, sizeof(reply), 0);
+    } while (result == -1 && errno == EINTR);
+    if (result != sizeof(reply)) {
+        _stopServer();
+        errno = EIO;
+        return -1;
+    }
+
+    if (reply.pid != -1 && reply.err != 0) {
+        waitpid(reply.pid, NULL, 0);
+    }
+    if (reply.err != 0) {
+        errno = reply.err;
+        return -1;
+    }
+    return reply.pid;
+}
+
+/*******************************************************************************
+*    Function: _execRequest()
+*  Parameters: struct ServerRequest *header - The fixed part of the request.
+*              char *cwd - The working directory.
+*              char *path - The resolved executable, or NULL.
+*              char **argv - The arguments.
+*              char **env - The environment.
+*              int *fds - The standard input, output and error.
+*              int errFD - The write end of the error pipe.
+* Description: Sets up a process created by the fork server and executes the
+*              command. Signal dispositions match those of the other engines:
+*              SIGTSTP stays ignored, as in the server, and SIGINT is reset to
+*              its default action for foreground processes. The process group
+*              is set before exec(), so it is in place by the time the shell
+*              receives the reply. If the command can't be executed, errno is
+*              written to the error pipe.
+*     Returns: Doesn't return.
+*******************************************************************************/
+
+void _execRequest(struct ServerRequest *header, char *cwd, char *path,
+                  char **argv, char **env, int *fds, int errFD) {
+    struct sigaction defaultAction = {0};
+    sigset_t mask;
+    int i, err;
+
+    if (header->isForeground) {
+        defaultAction.sa_handler = SIG_DFL;
+        sigaction(SIGINT, &defaultAction, NULL);
+    }
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+
+    if ((header->pgid == -1 || setpgid(0, header->pgid) == 0) &&
+        chdir(cwd) == 0) {
+        for (i = 0; i < FORK_SERVER_NUM_FDS && dup2(fds[i], i) != -1; i++) {
+            /* Do nothing... */
+        }
+        if (i == FORK_SERVER_NUM_FDS) {
+            environ = env;
+            if (path != NULL) {
+                execv(path, argv);
+            } else {
+                execvp(argv[0], argv);
+            }
+        }
+    }
+    err = errno;
+    write(errFD, &err, sizeof(err));
+    _exit(127);
+}
+
+/*******************************************************************************
+*    Function: _serveRequest()
+*  Parameters: char *buffer - A request received by the fork server.
+*              size_t size - The size of the request.
+*              int *fds - The standard input, output and error.
+* Description: Launches the process described by a request. It is created with
+*              clone(CLONE_PARENT), which makes it a child of the shell rather
+*              than of the server, so the shell collects its status and
+*              resource usage with wait4(). A close-on-exec pipe reports
+*              whether exec() succeeded.
+*     Returns: The reply to the request.
+*******************************************************************************/
+
+struct ServerReply _serveRequest(char *buffer, size_t size, int *fds) {
+    struct ServerRequest header;
+    struct ServerReply reply = {-1, EINVAL};
+    char *cwd = NULL, *path = NULL, *end = buffer + size, *c;
+    char **strings;
+    int i, numStrings, errPipe[2], err;
+
+    if (size < sizeof(header)) {
+        return reply;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    numStrings = header.numArgs + header.numEnv;
+    if (header.numArgs < 1 || header.numEnv < 0 ||
+        (strings = malloc((numStrings + 2) * sizeof(char *))) == NULL) {
+        return reply;
+    }
+
+    /* Unpack the strings, checking that each is within the request. */
+    c = buffer + sizeof(header);
+    for (i = -1 - header.hasPath; i < numStrings; i++) {
+        if (c >= end || memchr(c, '\0', end - c) == NULL) {
+            free(strings);
+            return reply;
+        }
+        if (i == -1 - header.hasPath) {
+            cwd = c;
+        } else if (i == -1) {
+            path = c;
+        } else {
+            strings[i + (i >= header.numArgs)] = c;
+        }
+        c += strlen(c) + 1;
+    }
+    strings[header.numArgs] = NULL;
+    strings[numStrings + 1] = NULL;
+
+    if (pipe2(errPipe, O_CLOEXEC) == -1) {
+        reply.err = errno;
+        free(strings);
+        return reply;
+    }
+    reply.pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+    if (reply.pid == 0) {
+        _execRequest(&header, cwd, path, strings,
+                     strings + header.numArgs + 1, fds, errPipe[1]);
+    }
+    reply.err = reply.pid == -1 ? errno : 0;
+    close(errPipe[1]);
+
+    /* The pipe reaches end of file when exec() succeeds. */
+    if (reply.pid != -1 &&
+        read(errPipe[0], &err, sizeof(err)) == sizeof(err)) {
+        reply.err = err;
+    }
+    close(errPipe[0]);
+    free(strings);
+    return reply;
+}
+
+/*******************************************************************************
+*    Function: runForkServer()
+*  Parameters: None.
+* Description: The main loop of the fork server. Each request received from
+*              the shell is launched and answered with a reply. The server
+*              exits when the shell closes its end of the socket, or dies.
+*     Returns: Exit status.
+*******************************************************************************/
+
+int runForkServer() {
+    char *buffer = malloc(FORK_SERVER_MSG_MAX);
+    int fds[FORK_SERVER_NUM_FDS];
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct ServerReply reply;
+    ssize_t size;
+    int i, numFDs;
+
+    if (buffer == NULL) {
+        perror("malloc");
+        return 1;
+    }
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+    while (1) {
+        iov.iov_base = buffer;
+        iov.iov_len = FORK_SERVER_MSG_MAX;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        size = recvmsg(FORK_SERVER_FD, &msg, MSG_CMSG_CLOEXEC);
+        if (size == -1 && errno == EINTR) {
+            continue;
+        } else if (size <= 0) {
+            break;
+        }
+
+        /* Take the descriptors, which are close-on-exec. */
+        numFDs = 0;
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_RIGHTS) {
+            numFDs = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(cmsg), numFDs * sizeof(int));
+        }
+
+        if (numFDs == FORK_SERVER_NUM_FDS &&
+            !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+            reply = _serveRequest(buffer, size, fds);
+        } else {
+            reply.pid = -1;
+            reply.err = EINVAL;
+        }
+        for (i = 0; i < numFDs; i++) {
+            close(fds[i]);
+        }
+
+        if (send(FORK_SERVER_FD, &reply, sizeof(reply), MSG_NOSIGNAL) == -1) {
+            break;
+        }
+    }
+    free(buffer);
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _recordSpawn()
+*  Parameters: int mode - The spawn engine used.
+*              struct timespec *start - The time the spawn began.
+*              struct timespec *end - The time the spawn returned.
+* Description: Adds a spawn latency sample to the engine's statistics.
+*     Returns: None.
+*******************************************************************************/
+
+void _recordSpawn(int mode, struct timespec *start, struct timespec *end) {
+    struct SpawnStats *stats = &SPAWN_STATS[mode];
+    long long ns = (end->tv_sec - start->tv_sec) * 1000000000LL +
+                   (end->tv_nsec - start->tv_nsec);
+
+    if (stats->count == 0 || ns < stats->minNs) {
+        stats->minNs = ns;
+    }
+    if (ns > stats->maxNs) {
+        stats->maxNs = ns;
+    }
+    stats->totalNs += ns;
+    stats->count++;
+}
+
+/*******************************************************************************
+*    Function: spawnCommand()
+*  Parameters: struct SpawnRequest *req - The process to be launched.
+* Description: Launches a process with the selected spawn engine and records
+*              its latency. If the fork server can't take the request, the
+*              posix_spawn() path is used instead, and if posix_spawn() is
+*              unsupported by the system, the fork() path is used. A process
+*              with a cgroup, or one that runs a function of the shell, always
+*              takes the fork() path, which alone can place it in the cgroup
+*              before it executes, or run the function.
+*     Returns: The child PID on success, -1 on failure with errno set. A
+*              failure of the posix_spawn() path includes exec() failures.
+*******************************************************************************/
+
+pid_t spawnCommand(struct SpawnRequest *req) {
+    pid_t spawnPid = -1;
+    int mode = SPAWN_MODE;
+    struct timespec start, end;
+
+    if (req->cgroupFD != -1 || req->run != NULL) {
+        mode = SPAWN_FORK;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (mode == SPAWN_SERVER) {
+        spawnPid = _spawnServer(req);
+        if (spawnPid == -1 && errno == ENOSYS) {
+            mode = SPAWN_POSIX;
+        }
+    }
+    if (mode == SPAWN_POSIX) {
+        spawnPid = _spawnPosix(req);
+        /* Fall back to fork() if the system can't spawn this way. */
+        if (spawnPid == -1 && errno == ENOSYS) {
+            mode = SPAWN_FORK;
+            spawnPid = _spawnFork(req);
+        }
+    } else if (mode == SPAWN_FORK) {
+        spawnPid = _spawnFork(req);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (spawnPid != -1) {
+        _recordSpawn(mode, &start, &end);
+    }
+    return spawnPid;
+}
+
+/*******************************************************************************
+*    Function: selectSpawnMode()
+*  Parameters: char *name - The name of a spawn engine.
+* Description: Selects the spawn engine used for later commands. Selecting the
+*              fork server starts it, if it isn't running.
+*     Returns: 0 on success, -1 on failure with errno set: EINVAL if there is
+*              no such engine.
+*******************************************************************************/
+
+int selectSpawnMode(char *name) {
+    char *modeNames[NUM_SPAWN_MODES] = SPAWN_MODE_NAMES_INIT;
+    int i;
+
+    for (i = 0; i < NUM_SPAWN_MODES; i++) {
+        if (strcmp(name, modeNames[i]) == 0) {
+            if (i == SPAWN_SERVER && SERVER_FD == -1 && _startServer() == -1) {
+                return -1;
+            }
+            SPAWN_MODE = i;
+            return 0;
+        }
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+/*******************************************************************************
+*    Function: detachSpawnEngine()
+*  Parameters: None.
+* Description: Drops the fork server connection inherited by a forked copy of
+*              the shell, without disturbing the server, which belongs to the
+*              shell that started it, and falls back to posix_spawn() if the
+*              fork server was selected.
+*     Returns: None.
+*******************************************************************************/
+
+void detachSpawnEngine() {
+    _stopServer();
+    if (SPAWN_MODE == SPAWN_SERVER) {
+        SPAWN_MODE = SPAWN_POSIX;
+    }
+}
+
+/*******************************************************************************
+*    Function: getSpawnStats()
+*  Parameters: int mode - The spawn engine.
+*              struct SpawnStats *stats - Receives a copy of the statistics.
+* Description: Retrieves the spawn latency statistics of an engine.
+*     Returns: None.
+*******************************************************************************/
+
+void getSpawnStats(int mode, struct SpawnStats *stats) {
+    *stats = SPAWN_STATS[mode];
+}
+
+/*******************************************************************************
+*    Function: resetSpawnStats()
+*  Parameters: None.
+* Description: Clears the spawn latency statistics of all engines.
+*     Returns: None.
+*******************************************************************************/
+
+void resetSpawnStats() {
+    memset(SPAWN_STATS, 0, sizeof(SPAWN_STATS));
+}
@@ -0,0 +1,140 @@
+/*******************************************************************************
+*      Filename: spawn_proc.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for spawn_proc.c. See spawn_proc.c for
+*                function descriptions.
+*******************************************************************************/
+
+#ifndef SPAWN_PROC_H
+#define SPAWN_PROC_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Spawn engine identifiers. SPAWN_POSIX uses posix_spawn(), which glibc
+ * implements with clone(CLONE_VM | CLONE_VFORK) and therefore never copies
+ * the page tables of the shell. SPAWN_FORK is the classic fork()/exec() path.
+ * SPAWN_SERVER hands each command to the fork server, a small helper process
+ * whose size doesn't grow with the shell's. The server creates each process
+ * with clone(CLONE_PARENT), which makes it a child of the process that
+ * started the server. A forked copy of the shell couldn't wait for processes
+ * launched through the server it inherited, so the server only takes requests
+ * from the process that started it; other processes fall back to
+ * posix_spawn().
+ */
+#define SPAWN_POSIX     0
+#define SPAWN_FORK      1
+#define SPAWN_SERVER    2
+#define NUM_SPAWN_MODES 3
+
+/* Names of the spawn engines, indexed by identifier. */
+#define SPAWN_MODE_NAMES_INIT {"posix", "fork", "server"}
+
+/* The environment variable that selects the spawn engine at start up. */
+#define SPAWN_MODE_ENV "SHELL_SPAWN"
+
+/* The fork server is the shell's own executable run with this argument. It
+ * receives requests on descriptor FORK_SERVER_FD, its standard input.
+ */
+#define FORK_SERVER_FLAG "--fork-server"
+#define FORK_SERVER_EXE  "/proc/self/exe"
+#define FORK_SERVER_FD   0
+/* Maximum size of a request: the strings of the working directory, the path,
+ * the arguments and the environment. Larger requests are spawned with
+ * posix_spawn() instead.
+ */
+#define FORK_SERVER_MSG_MAX (1 << 20)
+/* Number of descriptors passed with each request: the command's standard
+ * input, output and error.
+ */
+#define FORK_SERVER_NUM_FDS 3
+
+/* Global spawn engine selection. */
+extern int SPAWN_MODE;
+/* The environment passed to spawned processes. */
+extern char **environ;
+
+/* A struct describing a single process to be launched. The path is the
+ * resolved executable, or NULL to search PATH for argv[0]. File descriptors of
+ * -1 mean that the child inherits the corresponding stream of the shell.
+ * Descriptors other than -1 are expected to be opened with O_CLOEXEC so that
+ * the only copies which survive exec() are the ones placed on 0 and 1.
+ * A pgid of -1 leaves the child in the shell's process group, 0 makes it the
+ * leader of a new group, and any other value places it in that group. A
+ * cgroupFD other than -1 is the directory of the cgroup the child starts in.
+ * If run isn't NULL, the child is a copy of the shell that calls it with
+ * runArg instead of exec()ing, and exits with the status it returns.
+ */
+struct SpawnRequest {
+    char **argv;
+    char  *path;
+    int    inFD;
+    int    outFD;
+    int    isForeground;
+    pid_t  pgid;
+    int    cgroupFD;
+    int  (*run)(void *);
+    void  *runArg;
+};
+
+/* The fixed part of a fork server request. It is followed by the working
+ * directory, the path if hasPath is set, numArgs arguments, and numEnv
+ * environment strings, each NUL-terminated.
+ */
+struct ServerRequest {
+    int   isForeground;
+    pid_t pgid;
+    int   hasPath;
+    int   numArgs;
+    int   numEnv;
+};
+
+/* A fork server reply. A PID of -1 means that the process couldn't be
+ * created. Otherwise, an error means that it was created but failed before
+ * exec(), and has exited.
+ */
+struct ServerReply {
+    pid_t pid;
+    int   err;
+};
+
+/* A struct to accumulate the latency of one spawn engine. Latency is measured
+ * in the parent from the start of the spawn call until it returns.
+ */
+struct SpawnStats {
+    unsigned long count;
+    long long     totalNs;
+    long long     minNs;
+    long long     maxNs;
+};
+
+pid_t spawnCommand(struct SpawnRequest *);
+int selectSpawnMode(char *);
+void detachSpawnEngine();
+int runForkServer();
+void getSpawnStats(int, struct SpawnStats *);
+void resetSpawnStats();
+
+/* Forward declarations of the child handler registration functions in
+ * signal_proc.c, used by the fork() path.
+ */
+void registerForegroundChildHandlers();
+void registerBackgroundChildHandlers();
+
+#endif
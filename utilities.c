@@ -0,0 +1,726 @@
+/*******************************************************************************
+*      Filename: utilities.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains builtin versions of frequently used utilities (echo,
+*                printf, test and [, pwd, true and false), so that they are
+*                executed without spawning a process. Each one behaves like its
+*                external counterpart, and returns the exit status that the
+*                external command would have.
+*******************************************************************************/
+
+#include "utilities.h"
+
+/*******************************************************************************
+*    Function: _finishOutput()
+*  Parameters: char *name - The name of the utility.
+* Description: Flushes standard output and reports a write error, such as a
+*              full disk or a closed pipe.
+*     Returns: 0 on success, 1 on a write error.
+*******************************************************************************/
+
+int _finishOutput(char *name) {
+    if (fflush(stdout) != 0 || ferror(stdout)) {
+        perror(name);
+        clearerr(stdout);
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _escapeChar()
+*  Parameters: char **s - Points to the character following a backslash. It is
+*                         advanced past the escape sequence.
+*              int isFormat - Set for printf formats, in which octal escapes
+*                             are written \NNN rather than \0NNN.
+*              int *stop - Set if the sequence is \c, which ends the output.
+* Description: Decodes a backslash escape sequence. Unknown sequences stand for
+*              themselves, so the backslash is returned and *s isn't advanced.
+*     Returns: The decoded character, or -1 if there is none.
+*******************************************************************************/
+
+int _escapeChar(char **s, int isFormat, int *stop) {
+    char *p = *s;
+    int value = 0, digits = 0;
+
+    switch (*p) {
+    case 'a': value = '\a'; break;
+    case 'b': value = '\b'; break;
+    case 'e': value = 033; break;
+    case 'f': value = '\f'; break;
+    case 'n': value = '\n'; break;
+    case 'r': value = '\r'; break;
+    case 't': value = '\t'; break;
+    case 'v': value = '\v'; break;
+    case '\\': value = '\\'; break;
+    case 'c':
+        *stop = 1;
+        *s = p + 1;
+        return -1;
+    case 'x':
+        /* Up to two hexadecimal digits. */
+        for (p++; digits < 2 && isxdigit((unsigned char) *p); p++, digits++) {
+            value = value * 16 + (isdigit((unsigned char) *p) ? *p - '0' :
+                                  tolower((unsigned char) *p) - 'a' + 10);
+        }
+        if (digits == 0) {
+            return '\\';
+        }
+        *s = p;
+        return value;
+    default:
+        /* Up to three octal digits, following a 0 outside of formats. */
+        if (*p >= '0' && *p <= '7' && (isFormat || *p == '0')) {
+            if (!isFormat) {
+                p++;
+            }
+            for (; digits < 3 && *p >= '0' && *p <= '7'; p++, digits++) {
+                value = value * 8 + *p - '0';
+            }
+            *s = p;
+            return value & 0xff;
+        }
+        return '\\';
+    }
+    *s = p + 1;
+    return value;
+}
+
+/*******************************************************************************
+*    Function: executeEcho()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the echo builtin command. The arguments are written
+*              separated by spaces and followed by a newline. Leading options
+*              are accepted as by GNU echo: "-n" omits the newline, "-e"
+*              enables backslash escapes and "-E" disables them.
+*     Returns: 0 on success, 1 on a write error.
+*******************************************************************************/
+
+int executeEcho(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    int i = 1, isNewline = 1, isEscaped = 0, stop = 0, c;
+    char *p;
+
+    /* Parse the options. An argument containing anything but option letters
+     * is the first operand.
+     */
+    while (i < ci->numArgs && ci->args[i][0] == '-' &&
+           ci->args[i][1] != '\0' &&
+           strspn(ci->args[i] + 1, "neE") == strlen(ci->args[i] + 1)) {
+        for (p = ci->args[i] + 1; *p != '\0'; p++) {
+            if (*p == 'n') {
+                isNewline = 0;
+            } else {
+                isEscaped = (*p == 'e');
+            }
+        }
+        i++;
+    }
+
+    /* Write the operands. \c ends the output, including the newline. */
+    for (; i < ci->numArgs && !stop; i++) {
+        if (!isEscaped) {
+            fputs(ci->args[i], stdout);
+        } else {
+            for (p = ci->args[i]; *p != '\0' && !stop; ) {
+                if (*p++ != '\\') {
+                    putchar(p[-1]);
+                } else if ((c = _escapeChar(&p, 0, &stop)) != -1) {
+                    putchar(c);
+                }
+            }
+        }
+        if (i + 1 < ci->numArgs && !stop) {
+            putchar(' ');
+        }
+    }
+    if (isNewline && !stop) {
+        putchar('\n');
+    }
+    return _finishOutput("echo");
+}
+
+/*******************************************************************************
+*    Function: _parseInteger()
+*  Parameters: char *arg - The argument to be converted, or NULL.
+*              int *status - Set to 1 if the argument isn't a valid number.
+* Description: Converts a printf argument for an integer conversion. A leading
+*              quote yields the value of the following character.
+*     Returns: The value. A missing argument is 0.
+*******************************************************************************/
+
+long long _parseInteger(char *arg, int *status) {
+    char *end;
+    long long value;
+
+    if (arg == NULL) {
+        return 0;
+    }
+    if (*arg == '\'' || *arg == '"') {
+        return (unsigned char) arg[1];
+    }
+    errno = 0;
+    value = strtoll(arg, &end, 0);
+    if (end == arg || *end != '\0' || errno != 0) {
+        fprintf(stderr, "printf: %s: invalid number\n", arg);
+        fflush(stderr);
+        *status = 1;
+    }
+    return value;
+}
+
+/*******************************************************************************
+*    Function: _parseDouble()
+*  Parameters: char *arg - The argument to be converted, or NULL.
+*              int *status - Set to 1 if the argument isn't a valid number.
+* Description: Converts a printf argument for a floating point conversion.
+*     Returns: The value. A missing argument is 0.
+*******************************************************************************/
+
+double _parseDouble(char *arg, int *status) {
+    char *end;
+    double value;
+
+    if (arg == NULL) {
+        return 0;
+    }
+    if (*arg == '\'' || *arg == '"') {
+        return (unsigned char) arg[1];
+    }
+    errno = 0;
+    value = strtod(arg, &end);
+    if (end == arg || *end != '\0' || errno != 0) {
+        fprintf(stderr, "printf: %s: invalid number\n", arg);
+        fflush(stderr);
+        *status = 1;
+    }
+    return value;
+}
+
+/*******************************************************************************
+*    Function: _printFormat()
+*  Parameters: char *format - The printf format.
+*              char **args - The printf arguments.
+*              int numArgs - The number of arguments.
+*              int *argIndex - The index of the next argument to be consumed.
+*              int *status - Set to 1 on an error.
+* Description: Writes the format once, consuming an argument for each
+*              conversion. Conversions without an argument use an empty string
+*              or zero.
+*     Returns: 1 if the output was ended by \c or an invalid conversion, 0
+*              otherwise.
+*******************************************************************************/
+
+int _printFormat(char *format, char **args, int numArgs, int *argIndex,
+                 int *status) {
+    char spec[32];
+    char *p = format, *specStart, *arg, *expanded, *in, *out;
+    int c, stop = 0;
+    size_t specLen;
+
+    while (*p != '\0') {
+        /* Copy ordinary characters and escapes. */
+        if (*p == '\\') {
+            p++;
+            if ((c = _escapeChar(&p, 1, &stop)) != -1) {
+                putchar(c);
+            }
+            if (stop) {
+                return 1;
+            }
+            continue;
+        } else if (*p != '%') {
+            putchar(*p++);
+            continue;
+        } else if (p[1] == '%') {
+            putchar('%');
+            p += 2;
+            continue;
+        }
+
+        /* Copy the flags, width and precision of the conversion, which are
+         * passed on to the C library.
+         */
+        specStart = p++;
+        p += strspn(p, "-+ #0");
+        p += strspn(p, "0123456789");
+        if (*p == '.') {
+            p++;
+            p += strspn(p, "0123456789");
+        }
+        specLen = p - specStart;
+        if (*p == '\0' || specLen > sizeof(spec) - 4) {
+            fprintf(stderr, "printf: %s: invalid conversion\n", specStart);
+            fflush(stderr);
+            *status = 1;
+            return 1;
+        }
+        memcpy(spec, specStart, specLen);
+        arg = (*argIndex < numArgs) ? args[(*argIndex)++] : NULL;
+
+        switch (*p) {
+        case 'd':
+        case 'i':
+            sprintf(spec + specLen, "ll%c", *p);
+            printf(spec, _parseInteger(arg, status));
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            sprintf(spec + specLen, "ll%c", *p);
+            printf(spec, (unsigned long long) _parseInteger(arg, status));
+            break;
+        case 'a':
+        case 'A':
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+            sprintf(spec + specLen, "%c", *p);
+            printf(spec, _parseDouble(arg, status));
+            break;
+        case 'c':
+            sprintf(spec + specLen, "c");
+            if (arg != NULL && *arg != '\0') {
+                printf(spec, *arg);
+            }
+            break;
+        case 's':
+            sprintf(spec + specLen, "s");
+            printf(spec, arg ? arg : "");
+            break;
+        case 'b':
+            /* Expand the escapes of the argument. The expansion is never
+             * longer than the argument.
+             */
+            sprintf(spec + specLen, "s");
+            arg = arg ? arg : "";
+            if ((expanded = malloc(strlen(arg) + 1)) == NULL) {
+                perror("malloc");
+                exit(1);
+            }
+            for (in = arg, out = expanded; *in != '\0' && !stop; ) {
+                if (*in++ != '\\') {
+                    *out++ = in[-1];
+                } else if ((c = _escapeChar(&in, 0, &stop)) != -1) {
+                    *out++ = c;
+                }
+            }
+            *out = '\0';
+            printf(spec, expanded);
+            free(expanded);
+            if (stop) {
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "printf: %%%c: invalid conversion\n", *p);
+            fflush(stderr);
+            *status = 1;
+            return 1;
+        }
+        p++;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: executePrintf()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the printf builtin command. The format is reused until
+*              every argument has been consumed, as by POSIX printf.
+*     Returns: 0 on success, 1 on an invalid argument or a write error.
+*******************************************************************************/
+
+int executePrintf(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                  struct BackgroundProcesses *bp) {
+    int argIndex = 0, start, status = 0;
+    int numArgs = ci->numArgs - 2;
+
+    if (ci->numArgs < 2) {
+        fprintf(stderr, "Usage: printf format [argument ...]\n");
+        fflush(stderr);
+        return 1;
+    }
+
+    do {
+        start = argIndex;
+        if (_printFormat(ci->args[1], &ci->args[2], numArgs, &argIndex,
+                         &status) == 1) {
+            break;
+        }
+    } while (argIndex > start && argIndex < numArgs);
+
+    return _finishOutput("printf") || status;
+}
+
+/*******************************************************************************
+*    Function: _isUnaryTest()
+*  Parameters: char *op - The argument to be evaluated.
+* Description: Determines whether an argument is a unary test operator.
+*     Returns: 1 if it is, 0 otherwise.
+*******************************************************************************/
+
+int _isUnaryTest(char *op) {
+    return op[0] == '-' && op[1] != '\0' && op[2] == '\0' &&
+           strchr("bcdefghLnprsStuwxz", op[1]) != NULL;
+}
+
+/*******************************************************************************
+*    Function: _isBinaryTest()
+*  Parameters: char *op - The argument to be evaluated.
+* Description: Determines whether an argument is a binary test operator.
+*     Returns: 1 if it is, 0 otherwise.
+*******************************************************************************/
+
+int _isBinaryTest(char *op) {
+    char *ops[] = {"=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le",
+                   "-gt", "-ge", "-nt", "-ot", "-ef"};
+    int i;
+
+    for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (strcmp(op, ops[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: _testInteger()
+*  Parameters: struct TestContext *ctx - The parser state.
+*              char *arg - The argument to be converted.
+* Description: Converts an operand of an integer comparison.
+*     Returns: The value. On an invalid integer, the parser's error is set.
+*******************************************************************************/
+
+long long _testInteger(struct TestContext *ctx, char *arg) {
+    char *end;
+    long long value;
+
+    errno = 0;
+    value = strtoll(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno != 0) {
+        fprintf(stderr, "test: %s: integer expression expected\n", arg);
+        fflush(stderr);
+        ctx->isError = 1;
+    }
+    return value;
+}
+
+/*******************************************************************************
+*    Function: _testUnary()
+*  Parameters: struct TestContext *ctx - The parser state.
+*              char op - The letter of the operator.
+*              char *arg - The operand.
+* Description: Evaluates a unary test. File tests are false if the file can't
+*              be examined.
+*     Returns: The result of the test.
+*******************************************************************************/
+
+int _testUnary(struct TestContext *ctx, char op, char *arg) {
+    struct stat info;
+
+    switch (op) {
+    case 'n':
+        return arg[0] != '\0';
+    case 'z':
+        return arg[0] == '\0';
+    case 't':
+        return isatty((int) _testInteger(ctx, arg));
+    case 'r':
+        return access(arg, R_OK) == 0;
+    case 'w':
+        return access(arg, W_OK) == 0;
+    case 'x':
+        return access(arg, X_OK) == 0;
+    case 'h':
+    case 'L':
+        return lstat(arg, &info) == 0 && S_ISLNK(info.st_mode);
+    }
+
+    if (stat(arg, &info) != 0) {
+        return 0;
+    }
+    switch (op) {
+    case 'b':
+        return S_ISBLK(info.st_mode);
+    case 'c':
+        return S_ISCHR(info.st_mode);
+    case 'd':
+        return S_ISDIR(info.st_mode);
+    case 'f':
+        return S_ISREG(info.st_mode);
+    case 'g':
+        return (info.st_mode & S_ISGID) != 0;
+    case 'p':
+        return S_ISFIFO(info.st_mode);
+    case 's':
+        return info.st_size > 0;
+    case 'S':
+        return S_ISSOCK(info.st_mode);
+    case 'u':
+        return (info.st_mode & S_ISUID) != 0;
+    }
+    /* -e */
+    return 1;
+}
+
+/*******************************************************************************
+*    Function: _testBinary()
+*  Parameters: struct TestContext *ctx - The parser state.
+*              char *left - The left operand.
+*              char *op - The operator.
+*              char *right - The right operand.
+* Description: Evaluates a binary test.
+*     Returns: The result of the test.
+*******************************************************************************/
+
+int _testBinary(struct TestContext *ctx, char *left, char *op, char *right) {
+    struct stat leftInfo, rightInfo;
+    long long leftValue, rightValue;
+    int leftOK, rightOK;
+
+    /* String comparisons. */
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) {
+        return strcmp(left, right) == 0;
+    } else if (strcmp(op, "!=") == 0) {
+        return strcmp(left, right) != 0;
+    } else if (strcmp(op, "<") == 0) {
+        return strcmp(left, right) < 0;
+    } else if (strcmp(op, ">") == 0) {
+        return strcmp(left, right) > 0;
+    }
+
+    /* File comparisons. A file that doesn't exist is older than any other. */
+    if (strcmp(op, "-ot") == 0) {
+        return _testBinary(ctx, right, "-nt", left);
+    }
+    if (strcmp(op, "-nt") == 0 || strcmp(op, "-ef") == 0) {
+        leftOK = (stat(left, &leftInfo) == 0);
+        rightOK = (stat(right, &rightInfo) == 0);
+        if (op[1] == 'e') {
+            return leftOK && rightOK && leftInfo.st_dev == rightInfo.st_dev &&
+                   leftInfo.st_ino == rightInfo.st_ino;
+        }
+        if (!leftOK) {
+            return 0;
+        }
+        if (!rightOK) {
+            return 1;
+        }
+        return leftInfo.st_mtim.tv_sec > rightInfo.st_mtim.tv_sec ||
+               (leftInfo.st_mtim.tv_sec == rightInfo.st_mtim.tv_sec &&
+                leftInfo.st_mtim.tv_nsec > rightInfo.st_mtim.tv_nsec);
+    }
+
+    /* Integer comparisons. */
+    leftValue = _testInteger(ctx, left);
+    rightValue = _testInteger(ctx, right);
+    if (strcmp(op, "-eq") == 0) {
+        return leftValue == rightValue;
+    } else if (strcmp(op, "-ne") == 0) {
+        return leftValue != rightValue;
+    } else if (strcmp(op, "-lt") == 0) {
+        return leftValue < rightValue;
+    } else if (strcmp(op, "-le") == 0) {
+        return leftValue <= rightValue;
+    } else if (strcmp(op, "-gt") == 0) {
+        return leftValue > rightValue;
+    }
+    return leftValue >= rightValue;
+}
+
+int _testOr(struct TestContext *);
+
+/*******************************************************************************
+*    Function: _testPrimary()
+*  Parameters: struct TestContext *ctx - The parser state.
+* Description: Parses and evaluates a primary: a parenthesized expression, a
+*              binary or unary test, or a string, which is true if it is
+*              non-empty. A binary operator in the second position takes
+*              precedence, as in the POSIX rule for three arguments, and an
+*              operator without operands is an ordinary string.
+*     Returns: The result of the primary.
+*******************************************************************************/
+
+int _testPrimary(struct TestContext *ctx) {
+    char **args = ctx->args;
+    int pos = ctx->pos;
+    int result;
+
+    if (pos >= ctx->end) {
+        fprintf(stderr, "test: argument expected\n");
+        fflush(stderr);
+        ctx->isError = 1;
+        return 0;
+    }
+
+    if (pos + 2 < ctx->end && _isBinaryTest(args[pos + 1])) {
+        ctx->pos += 3;
+        return _testBinary(ctx, args[pos], args[pos + 1], args[pos + 2]);
+    }
+    if (strcmp(args[pos], "(") == 0 && pos + 1 < ctx->end) {
+        ctx->pos++;
+        result = _testOr(ctx);
+        if (ctx->pos >= ctx->end || strcmp(args[ctx->pos], ")") != 0) {
+            fprintf(stderr, "test: ')' expected\n");
+            fflush(stderr);
+            ctx->isError = 1;
+        } else {
+            ctx->pos++;
+        }
+        return result;
+    }
+    if (_isUnaryTest(args[pos]) && pos + 1 < ctx->end) {
+        ctx->pos += 2;
+        return _testUnary(ctx, args[pos][1], args[pos + 1]);
+    }
+    ctx->pos++;
+    return args[pos][0] != '\0';
+}
+
+/*******************************************************************************
+*    Function: _testNot()
+*  Parameters: struct TestContext *ctx - The parser state.
+* Description: Parses and evaluates a primary preceded by any number of "!".
+*     Returns: The result of the expression.
+*******************************************************************************/
+
+int _testNot(struct TestContext *ctx) {
+    if (ctx->pos + 1 < ctx->end && strcmp(ctx->args[ctx->pos], "!") == 0) {
+        ctx->pos++;
+        return !_testNot(ctx);
+    }
+    return _testPrimary(ctx);
+}
+
+/*******************************************************************************
+*    Function: _testAnd()
+*  Parameters: struct TestContext *ctx - The parser state.
+* Description: Parses and evaluates expressions joined by "-a".
+*     Returns: The result of the expression.
+*******************************************************************************/
+
+int _testAnd(struct TestContext *ctx) {
+    int result = _testNot(ctx);
+
+    while (ctx->pos < ctx->end && strcmp(ctx->args[ctx->pos], "-a") == 0) {
+        ctx->pos++;
+        result = _testNot(ctx) && result;
+    }
+    return result;
+}
+
+/*******************************************************************************
+*    Function: _testOr()
+*  Parameters: struct TestContext *ctx - The parser state.
+* Description: Parses and evaluates expressions joined by "-o", which binds
+*              less tightly than "-a".
+*     Returns: The result of the expression.
+*******************************************************************************/
+
+int _testOr(struct TestContext *ctx) {
+    int result = _testAnd(ctx);
+
+    while (ctx->pos < ctx->end && strcmp(ctx->args[ctx->pos], "-o") == 0) {
+        ctx->pos++;
+        result = _testAnd(ctx) || result;
+    }
+    return result;
+}
+
+/*******************************************************************************
+*    Function: executeTest()
+*  Parameters: struct CommandInfo *ci - A pointer to the CommandInfo struct.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the test and [ builtin commands, which evaluate a
+*              conditional expression. [ requires "]" as its last argument.
+*     Returns: 0 if the expression is true, 1 if it is false or empty, and 2
+*              on a syntax error.
+*******************************************************************************/
+
+int executeTest(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    struct TestContext ctx = {ci->args, 1, ci->numArgs, 0};
+    int result;
+
+    if (strcmp(ci->args[0], "[") == 0) {
+        if (strcmp(ci->args[ci->numArgs - 1], "]") != 0) {
+            fprintf(stderr, "[: missing ]\n");
+            fflush(stderr);
+            return 2;
+        }
+        ctx.end--;
+    }
+
+    if (ctx.pos == ctx.end) {
+        return 1;
+    }
+    result = _testOr(&ctx);
+    if (!ctx.isError && ctx.pos < ctx.end) {
+        fprintf(stderr, "test: %s: unexpected argument\n", ctx.args[ctx.pos]);
+        fflush(stderr);
+        ctx.isError = 1;
+    }
+    if (ctx.isError) {
+        return 2;
+    }
+    return !result;
+}
+
+/*******************************************************************************
+*    Function: executePwd()
+*  Parameters: struct CommandInfo *ci - Unused.
+*              struct ForegroundStatus *fs - Unused.
+*              struct BackgroundProcess *bp - Unused.
+* Description: Executes the pwd builtin command, which outputs the working
+*              directory.
+*     Returns: 0 on success, 1 on failure.
+*******************************************************************************/
+
+int executePwd(struct CommandInfo *ci, struct ForegroundStatus *fs,
+               struct BackgroundProcesses *bp) {
+    char *cwd = getcwd(NULL, 0);
+
+    if (cwd == NULL) {
+        perror("pwd");
+        return 1;
+    }
+    fprintf(stdout, "%s\n", cwd);
+    free(cwd);
+    return _finishOutput("pwd");
+}
+
+/*******************************************************************************
+*    Function: executeTrue()
+*  Parameters: Unused.
+* Description: Executes the true builtin command.
+*     Returns: 0.
+*******************************************************************************/
+
+int executeTrue(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                struct BackgroundProcesses *bp) {
+    return 0;
+}
+
+/*******************************************************************************
+*    Function: executeFalse()
+*  Parameters: Unused.
+* Description: Executes the false builtin command.
+*     Returns: 1.
+*******************************************************************************/
+
+int executeFalse(struct CommandInfo *ci, struct ForegroundStatus *fs,
+                 struct BackgroundProcesses *bp) {
+    return 1;
+}
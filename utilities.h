@@ -0,0 +1,46 @@
+/*******************************************************************************
+*      Filename: utilities.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for utilities.c. See utilities.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef UTILITIES_H
+#define UTILITIES_H
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "signal_proc.h"
+
+/* A struct to hold the state of the test builtin's expression parser. The
+ * arguments from pos up to end remain to be parsed.
+ */
+struct TestContext {
+    char **args;
+    int    pos;
+    int    end;
+    int    isError;
+};
+
+int executeEcho(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executePrintf(struct CommandInfo *, struct ForegroundStatus *,
+                  struct BackgroundProcesses *);
+int executeTest(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executePwd(struct CommandInfo *, struct ForegroundStatus *,
+               struct BackgroundProcesses *);
+int executeTrue(struct CommandInfo *, struct ForegroundStatus *,
+                struct BackgroundProcesses *);
+int executeFalse(struct CommandInfo *, struct ForegroundStatus *,
+                 struct BackgroundProcesses *);
+
+#endif
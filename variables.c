@@ -0,0 +1,487 @@
+/*******************************************************************************
+*      Filename: variables.c
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: Contains the shell variables, held in a hash table keyed by
+*                name, and the special parameters $?, $! and $$. The exported
+*                variables form a snapshot that serves as the environment of
+*                the shell and of every command it launches. The snapshot is
+*                rebuilt only after an exported variable changes, so
+*                launching a command never copies the environment.
+*******************************************************************************/
+
+#include "variables.h"
+
+/* Global variable table. */
+struct VariableTable VARIABLES = {0};
+
+/* The exit status of the last command, expanded by $?. */
+int LAST_STATUS = 0;
+/* The PID of the last background process, expanded by $!, or -1. */
+pid_t LAST_BACKGROUND = -1;
+/* Holds the expansion of a special parameter. */
+char SPECIAL_VALUE[SPECIAL_VALUE_LEN];
+
+/*******************************************************************************
+*    Function: _hashVariable()
+*  Parameters: char *name - The variable name.
+*              size_t len - The length of the name.
+* Description: Computes the FNV-1a hash of a variable name.
+*     Returns: The hash value.
+*******************************************************************************/
+
+unsigned int _hashVariable(char *name, size_t len) {
+    unsigned int hash = 2166136261u;
+
+    while (len-- > 0) {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*******************************************************************************
+*    Function: _findVariable()
+*  Parameters: char *name - The variable name, which needn't be terminated.
+*              size_t len - The length of the name.
+* Description: Finds the bucket of a variable name with linear probing.
+*     Returns: The bucket index holding the name, or the index of the empty
+*              bucket where it would be inserted.
+*******************************************************************************/
+
+int _findVariable(char *name, size_t len) {
+    int mask = VARIABLES.capacity - 1;
+    int i = _hashVariable(name, len) & mask;
+    char *bucketName;
+
+    while ((bucketName = VARIABLES.buckets[i].name) != NULL &&
+           (strncmp(bucketName, name, len) != 0 || bucketName[len] != '\0')) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*******************************************************************************
+*    Function: _removeVariable()
+*  Parameters: int i - The bucket index of the variable to be removed.
+* Description: Frees a variable and shifts the following variables of its
+*              probe sequence back so that no tombstones are needed.
+*     Returns: None.
+*******************************************************************************/
+
+void _removeVariable(int i) {
+    int mask = VARIABLES.capacity - 1;
+    int j = i;
+    int home;
+    char *name;
+
+    free(VARIABLES.buckets[i].name);
+    free(VARIABLES.buckets[i].entry);
+    VARIABLES.size--;
+
+    /* Move each later variable whose home bucket doesn't lie cyclically in
+     * (i, j] into the hole.
+     */
+    while (1) {
+        j = (j + 1) & mask;
+        if ((name = VARIABLES.buckets[j].name) == NULL) {
+            break;
+        }
+        home = _hashVariable(name, strlen(name)) & mask;
+        if ((j > i && (home <= i || home > j)) ||
+            (j < i && (home <= i && home > j))) {
+            VARIABLES.buckets[i] = VARIABLES.buckets[j];
+            i = j;
+        }
+    }
+    memset(&VARIABLES.buckets[i], 0, sizeof(struct Variable));
+}
+
+/*******************************************************************************
+*    Function: _growVariables()
+*  Parameters: None.
+* Description: Allocates the bucket array, or doubles it and rehashes all
+*              variables once the load factor would exceed 0.7.
+*     Returns: None.
+*******************************************************************************/
+
+void _growVariables() {
+    struct Variable *old = VARIABLES.buckets;
+    int oldCapacity = VARIABLES.capacity;
+    int i;
+
+    if (old != NULL && (VARIABLES.size + 1) * 10 <= oldCapacity * 7) {
+        return;
+    }
+
+    VARIABLES.capacity = old ? oldCapacity * 2 : VARIABLES_INIT_SIZE;
+    VARIABLES.buckets = calloc(VARIABLES.capacity, sizeof(struct Variable));
+    if (VARIABLES.buckets == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i].name != NULL) {
+            VARIABLES.buckets[_findVariable(old[i].name,
+                                            strlen(old[i].name))] = old[i];
+        }
+    }
+    free(old);
+}
+
+/*******************************************************************************
+*    Function: _changed()
+*  Parameters: struct Variable *var - A variable that was set or unset.
+* Description: Notes the change of a variable: the snapshot must be rebuilt if
+*              it is exported, and the path cache is discarded if it is PATH.
+*     Returns: None.
+*******************************************************************************/
+
+void _changed(struct Variable *var) {
+    if (var->isExported) {
+        VARIABLES.isDirty = 1;
+    }
+    if (strcmp(var->name, "PATH") == 0) {
+        clearPathCache();
+    }
+}
+
+/*******************************************************************************
+*    Function: initVariables()
+*  Parameters: None.
+* Description: Imports the environment of the shell as exported variables and
+*              makes the snapshot the environment.
+*     Returns: None.
+*******************************************************************************/
+
+void initVariables() {
+    char **env = environ;
+    char *equals, *name;
+    int i;
+
+    _growVariables();
+    for (i = 0; env != NULL && env[i] != NULL; i++) {
+        if ((equals = strchr(env[i], '=')) == NULL) {
+            continue;
+        }
+        name = strndup(env[i], equals - env[i]);
+        setVariable(name, equals + 1, 1);
+        free(name);
+    }
+    VARIABLES.isDirty = 1;
+    syncEnvironment();
+}
+
+/*******************************************************************************
+*    Function: isValidName()
+*  Parameters: char *name - The name, which needn't be terminated.
+*              size_t len - The length of the name.
+* Description: Checks that a name consists of letters, digits and underscores
+*              and doesn't begin with a digit.
+*     Returns: 1 if the name is valid, 0 otherwise.
+*******************************************************************************/
+
+int isValidName(char *name, size_t len) {
+    size_t i;
+
+    if (len == 0 || isdigit((unsigned char) name[0])) {
+        return 0;
+    }
+    for (i = 0; i < len; i++) {
+        if (!isalnum((unsigned char) name[i]) && name[i] != '_') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*    Function: getVariable()
+*  Parameters: char *name - The variable name.
+* Description: Looks up the value of a variable.
+*     Returns: The value, or NULL if the variable isn't set. The value remains
+*              valid until the variable changes.
+*******************************************************************************/
+
+char *getVariable(char *name) {
+    int i;
+
+    if (VARIABLES.buckets == NULL) {
+        return NULL;
+    }
+    i = _findVariable(name, strlen(name));
+    return VARIABLES.buckets[i].value;
+}
+
+/*******************************************************************************
+*    Function: setVariable()
+*  Parameters: char *name - The variable name, which must be valid.
+*              char *value - The new value.
+*              int isExported - Set to export the variable. Otherwise, the
+*                               variable keeps its export attribute.
+* Description: Sets a variable, creating it if needed.
+*     Returns: None.
+*******************************************************************************/
+
+void setVariable(char *name, char *value, int isExported) {
+    struct Variable *var;
+    size_t nameLen = strlen(name), valueLen = strlen(value);
+
+    _growVariables();
+    var = &VARIABLES.buckets[_findVariable(name, nameLen)];
+    if (var->name == NULL) {
+        var->name = strdup(name);
+        VARIABLES.size++;
+    }
+    free(var->entry);
+    if ((var->entry = malloc(nameLen + valueLen + 2)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(var->entry, name, nameLen);
+    var->entry[nameLen] = '=';
+    memcpy(var->entry + nameLen + 1, value, valueLen + 1);
+    var->value = var->entry + nameLen + 1;
+    var->isExported |= isExported;
+    _changed(var);
+}
+
+/*******************************************************************************
+*    Function: unsetVariable()
+*  Parameters: char *name - The variable name.
+* Description: Removes a variable, if it is set.
+*     Returns: None.
+*******************************************************************************/
+
+void unsetVariable(char *name) {
+    int i;
+
+    if (VARIABLES.buckets == NULL) {
+        return;
+    }
+    i = _findVariable(name, strlen(name));
+    if (VARIABLES.buckets[i].name != NULL) {
+        _changed(&VARIABLES.buckets[i]);
+        _removeVariable(i);
+    }
+}
+
+/*******************************************************************************
+*    Function: exportVariable()
+*  Parameters: char *name - The variable name.
+* Description: Gives a variable the export attribute, if it is set.
+*     Returns: None.
+*******************************************************************************/
+
+void exportVariable(char *name) {
+    struct Variable *var;
+
+    if (VARIABLES.buckets == NULL) {
+        return;
+    }
+    var = &VARIABLES.buckets[_findVariable(name, strlen(name))];
+    if (var->name != NULL && !var->isExported) {
+        var->isExported = 1;
+        _changed(var);
+    }
+}
+
+/*******************************************************************************
+*    Function: syncEnvironment()
+*  Parameters: None.
+* Description: Rebuilds the snapshot of exported variables if one has changed
+*              since it was last built, and makes it the environment. Callers
+*              that change variables call this once they are done.
+*     Returns: None.
+*******************************************************************************/
+
+void syncEnvironment() {
+    int i, n = 0;
+
+    if (!VARIABLES.isDirty) {
+        return;
+    }
+    if (VARIABLES.snapshotCapacity < VARIABLES.size + 1) {
+        while (VARIABLES.snapshotCapacity < VARIABLES.size + 1) {
+            VARIABLES.snapshotCapacity = VARIABLES.snapshotCapacity ?
+                VARIABLES.snapshotCapacity * 2 : ENVIRON_INIT_SIZE;
+        }
+        free(VARIABLES.snapshot);
+        VARIABLES.snapshot = malloc(VARIABLES.snapshotCapacity *
+                                    sizeof(char *));
+        if (VARIABLES.snapshot == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+    }
+    for (i = 0; i < VARIABLES.capacity; i++) {
+        if (VARIABLES.buckets[i].name != NULL &&
+            VARIABLES.buckets[i].isExported) {
+            VARIABLES.snapshot[n++] = VARIABLES.buckets[i].entry;
+        }
+    }
+    VARIABLES.snapshot[n] = NULL;
+    environ = VARIABLES.snapshot;
+    VARIABLES.isDirty = 0;
+}
+
+/*******************************************************************************
+*    Function: saveVariable()
+*  Parameters: char *name - The variable name.
+*              struct SavedVariable *saved - Receives a copy of its state.
+* Description: Saves the state of a variable before a temporary assignment.
+*     Returns: None.
+*******************************************************************************/
+
+void saveVariable(char *name, struct SavedVariable *saved) {
+    struct Variable *var;
+
+    saved->name = strdup(name);
+    saved->value = NULL;
+    saved->isExported = 0;
+    if (VARIABLES.buckets == NULL) {
+        return;
+    }
+    var = &VARIABLES.buckets[_findVariable(name, strlen(name))];
+    if (var->name != NULL) {
+        saved->value = strdup(var->value);
+        saved->isExported = var->isExported;
+    }
+}
+
+/*******************************************************************************
+*    Function: restoreVariable()
+*  Parameters: struct SavedVariable *saved - The saved state of a variable,
+*                                            which is released.
+* Description: Undoes a temporary assignment.
+*     Returns: None.
+*******************************************************************************/
+
+void restoreVariable(struct SavedVariable *saved) {
+    struct Variable *var;
+
+    if (saved->value == NULL) {
+        unsetVariable(saved->name);
+    } else {
+        setVariable(saved->name, saved->value, 0);
+        var = &VARIABLES.buckets[_findVariable(saved->name,
+                                               strlen(saved->name))];
+        if (var->isExported != saved->isExported) {
+            VARIABLES.isDirty = 1;
+            var->isExported = saved->isExported;
+        }
+    }
+    free(saved->name);
+    free(saved->value);
+}
+
+/*******************************************************************************
+*    Function: expandParameter()
+*  Parameters: char *name - The parameter name, which needn't be terminated.
+*              size_t len - The length of the name.
+* Description: Expands a parameter: a variable, or one of the special
+*              parameters "?" (the exit status of the last command), "!" (the
+*              PID of the last background process) and "$" (the PID of the
+*              shell).
+*     Returns: The value, which is empty if the parameter isn't set. The value
+*              remains valid until the parameter changes or another special
+*              parameter is expanded.
+*******************************************************************************/
+
+char *expandParameter(char *name, size_t len) {
+    int i;
+
+    if (len == 1 && name[0] == '?') {
+        snprintf(SPECIAL_VALUE, SPECIAL_VALUE_LEN, "%d", LAST_STATUS);
+        return SPECIAL_VALUE;
+    } else if (len == 1 && name[0] == '!') {
+        if (LAST_BACKGROUND == -1) {
+            return "";
+        }
+        snprintf(SPECIAL_VALUE, SPECIAL_VALUE_LEN, "%d", LAST_BACKGROUND);
+        return SPECIAL_VALUE;
+    } else if (len == 1 && name[0] == '$') {
+        snprintf(SPECIAL_VALUE, SPECIAL_VALUE_LEN, "%d", getpid());
+        return SPECIAL_VALUE;
+    }
+
+    if (VARIABLES.buckets == NULL) {
+        return "";
+    }
+    i = _findVariable(name, len);
+    return VARIABLES.buckets[i].name != NULL ? VARIABLES.buckets[i].value : "";
+}
+
+/*******************************************************************************
+*    Function: setLastStatus()
+*  Parameters: int status - The exit status of the last command.
+* Description: Sets the value of $?.
+*     Returns: None.
+*******************************************************************************/
+
+void setLastStatus(int status) {
+    LAST_STATUS = status;
+}
+
+/*******************************************************************************
+*    Function: setLastBackground()
+*  Parameters: pid_t pid - The PID of the last background process.
+* Description: Sets the value of $!.
+*     Returns: None.
+*******************************************************************************/
+
+void setLastBackground(pid_t pid) {
+    LAST_BACKGROUND = pid;
+}
+
+/*******************************************************************************
+*    Function: _compareNames()
+*  Parameters: const void *a, const void *b - Pointers to two variables.
+* Description: Orders variables by name, for qsort().
+*     Returns: The order of the names, as strcmp() returns.
+*******************************************************************************/
+
+int _compareNames(const void *a, const void *b) {
+    return strcmp((*(struct Variable **) a)->name,
+                  (*(struct Variable **) b)->name);
+}
+
+/*******************************************************************************
+*    Function: printExports()
+*  Parameters: FILE *out - The stream to print to.
+* Description: Prints every exported variable as an export command, ordered by
+*              name. Characters special inside double quotes are escaped so
+*              that the output can be read back by the shell.
+*     Returns: None.
+*******************************************************************************/
+
+void printExports(FILE *out) {
+    struct Variable **exported;
+    char *c;
+    int i, n = 0;
+
+    if ((exported = malloc((VARIABLES.size + 1) *
+                           sizeof(struct Variable *))) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < VARIABLES.capacity; i++) {
+        if (VARIABLES.buckets[i].name != NULL &&
+            VARIABLES.buckets[i].isExported) {
+            exported[n++] = &VARIABLES.buckets[i];
+        }
+    }
+    qsort(exported, n, sizeof(struct Variable *), _compareNames);
+
+    for (i = 0; i < n; i++) {
+        fprintf(out, "export %s=\"", exported[i]->name);
+        for (c = exported[i]->value; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\' || *c == '$') {
+                fputc('\\', out);
+            }
+            fputc(*c, out);
+        }
+        fprintf(out, "\"\n");
+    }
+    free(exported);
+}
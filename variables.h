@@ -0,0 +1,82 @@
+/*******************************************************************************
+*      Filename: variables.h
+*        Author: Maxwell Goldberg
+* Last Modified: 10.16.26
+*   Description: The header file for variables.c. See variables.c for function
+*                descriptions.
+*******************************************************************************/
+
+#ifndef VARIABLES_H
+#define VARIABLES_H
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "path_cache.h"
+
+/* Initial number of buckets in the variable table. Must be a power of two. */
+#define VARIABLES_INIT_SIZE  64
+/* Initial number of slots in the environment snapshot. */
+#define ENVIRON_INIT_SIZE    64
+/* Maximum length of the value of a special parameter such as $?. */
+#define SPECIAL_VALUE_LEN    16
+
+/* A struct to hold a shell variable. The entry holds "NAME=value" as it
+ * appears in the environment; name and value are copies and a slice of it.
+ */
+struct Variable {
+    char *name;
+    char *entry;
+    char *value;
+    int   isExported;
+};
+
+/* A struct to hold the shell variables in an open addressing hash table
+ * keyed by name. The exported variables are also held in a NULL-terminated
+ * snapshot, which becomes the environment of the shell and is rebuilt only
+ * when an exported variable has changed.
+ */
+struct VariableTable {
+    struct Variable *buckets;
+    int    capacity;
+    int    size;
+    char **snapshot;
+    int    snapshotCapacity;
+    int    isDirty;
+};
+
+/* A struct to hold the state of a variable, so that a temporary assignment
+ * can be undone.
+ */
+struct SavedVariable {
+    char *name;
+    char *value;
+    int   isExported;
+};
+
+/* The environment of the shell, which is the snapshot of exported variables
+ * once the table has been initialized.
+ */
+extern char **environ;
+/* The exit status of the last command, expanded by $?. */
+extern int LAST_STATUS;
+
+void initVariables();
+int isValidName(char *, size_t);
+char *getVariable(char *);
+void setVariable(char *, char *, int);
+void unsetVariable(char *);
+void exportVariable(char *);
+void syncEnvironment();
+void saveVariable(char *, struct SavedVariable *);
+void restoreVariable(struct SavedVariable *);
+char *expandParameter(char *, size_t);
+void setLastStatus(int);
+void setLastBackground(pid_t);
+void printExports(FILE *);
+
+#endif